@@ -0,0 +1,396 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Batch.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for the batch merge
+// declared in Batch.h. A batch runs in two passes over
+// one pool of threads. The first finds each job's
+// inputs and adds up their sizes; the second runs the
+// jobs as block copies, biggest first, so the longest
+// job isn't the last to start and left running alone
+// at the end. Each thread keeps its Writer buffers
+// (see keepBuffers) from one job to the next, and a job
+// that fails just records why - the others carry on.
+//
+// ******************************************************/
+
+#include "Batch.h"
+#include "Index.h"
+#include "Incremental.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// The threads to use: as asked, but no more than there are jobs.
+static unsigned threadCount(unsigned threads, std::size_t jobs);
+// Find a job's inputs.
+static bool loadInputs(mtf::BatchJob & job, mtf::InputSet & inputs);
+// Run one job, and add its file times to latency.
+static void runJob( mtf::BatchJob & job, const mtf::BatchOptions & options,
+                    mtf::LatencyHistogram * latency );
+// Run work(index) for every index below count on a pool of threads.
+template<typename Work>
+static void forEach(std::size_t count, unsigned threads, Work work);
+
+
+
+/* *************************************************
+// Reads a job file. Each line holds a job: the
+// output, the kind of source ("dir", "glob" or
+// "list") and the source, which runs to the end of
+// the line, e.g.
+//
+//   out/a.txt dir exports/a
+//   out/b.txt list lists/b.txt
+//
+// Blank lines and lines starting with # are
+// skipped.
+//
+// @param path: The job file.
+//
+// @param jobs: The jobs are appended, in order.
+//
+// @param bad_line: Set to the number of the first
+// line that isn't a job (0 if the file couldn't be
+// read).
+//
+// @return: false (with errno) if the file couldn't
+// be read or has a bad line.
+//
+// *************************************************/
+bool mtf::readJobs( const char * path, std::vector<BatchJob> & jobs,
+                    unsigned long & bad_line )
+{
+  std::ifstream in(path);
+  std::string line;
+  const char * const SPACE = " \t\r";
+
+  bad_line = 0;
+
+  if(!in) return false;
+
+  for(unsigned long number = 1; std::getline(in, line); ++number)
+  {
+    std::size_t start = line.find_first_not_of(SPACE);
+
+    if(start == std::string::npos || line[start] == '#') continue;
+
+    // The output and kind are single words; the source is the rest.
+    std::size_t output_end = line.find_first_of(SPACE, start),
+                kind_start = line.find_first_not_of(SPACE, output_end),
+                kind_end = line.find_first_of(SPACE, kind_start),
+                source_start = line.find_first_not_of(SPACE, kind_end),
+                source_end = line.find_last_not_of(SPACE);
+
+    if(source_start == std::string::npos)
+    {
+      bad_line = number;
+      errno = EINVAL;
+      return false;
+    }
+
+    BatchJob job = BatchJob();
+    std::string kind = line.substr(kind_start, kind_end - kind_start);
+
+    if(kind == "dir") job.kind = SOURCE_DIR;
+    else if(kind == "glob") job.kind = SOURCE_GLOB;
+    else if(kind == "list") job.kind = SOURCE_LIST;
+    else
+    {
+      bad_line = number;
+      errno = EINVAL;
+      return false;
+    }
+
+    job.line = number;
+    job.output = line.substr(start, output_end - start);
+    job.source = line.substr(source_start, source_end + 1 - source_start);
+
+    jobs.push_back(job);
+  }
+
+  return !in.bad();
+}
+
+
+
+/* *************************************************
+// Runs a batch of merges on one pool of threads.
+// Every job's inputs are found and measured first
+// (in parallel, since that's mostly stat calls),
+// then the jobs are run largest first. Jobs that
+// name an output already used by an earlier line
+// fail rather than race it.
+//
+// Each job is a block copy with options.block,
+// except that gzip gets one compressing thread per
+// job unless told otherwise, since the jobs
+// already keep the CPUs busy.
+//
+// @param jobs: The jobs, as read by readJobs; each
+// one's status and totals are filled in.
+//
+// @param options: The threads, how to merge and
+// whether to write indexes.
+//
+// @param report: Filled with the files, bytes and
+// time of the whole batch (and the file times, if
+// kept).
+//
+// @return: true if every job succeeded.
+//
+// *************************************************/
+bool mtf::runBatch( std::vector<BatchJob> & jobs, const BatchOptions & options,
+                    MergeReport & report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  const unsigned threads = threadCount(options.threads, jobs.size());
+
+  BatchOptions job_options = options;
+
+  if(job_options.block.gzip.enabled && job_options.block.gzip.threads == 0)
+    job_options.block.gzip.threads = 1;
+
+  // The first line to write each output.
+  std::map<std::string, unsigned long> outputs;
+
+  for(BatchJob & job : jobs)
+  {
+    job.ok = false;
+    job.error.clear();
+    job.size = job.files = job.bytes = 0;
+    job.seconds = 0;
+
+    std::pair<std::map<std::string, unsigned long>::iterator, bool> first
+      = outputs.insert(std::make_pair(job.output, job.line));
+
+    if(!first.second)
+      job.error = "same output as line " + std::to_string(first.first->second);
+  }
+
+  // Measure every job that's still to run.
+  forEach(jobs.size(), threads, [&](std::size_t index)
+  {
+    BatchJob & job = jobs[index];
+    InputSet inputs;
+
+    if(!job.error.empty() || !loadInputs(job, inputs)) return;
+
+    struct stat info;
+
+    for(unsigned long file = 0; file < inputs.size(); ++file)
+      if(inputs.stat(file, info)) job.size += info.st_size;
+  });
+
+  // Biggest first; equal sizes keep the order of the job file.
+  std::vector<std::size_t> order;
+
+  for(std::size_t index = 0; index < jobs.size(); ++index)
+    if(jobs[index].error.empty()) order.push_back(index);
+
+  std::stable_sort(order.begin(), order.end(), [&](std::size_t fst, std::size_t snd)
+  {
+    return jobs[fst].size > jobs[snd].size;
+  });
+
+  report.latency = LatencyHistogram();
+
+  bool timing = fileHistogram(report) != NULL;
+  std::mutex latency_lock;
+
+  // Run them, each thread holding on to its buffers between jobs.
+  forEach(order.size(), threads, [&](std::size_t at)
+  {
+    LatencyHistogram latency;
+
+    keepBuffers(true);
+    runJob(jobs[order[at]], job_options, timing ? &latency : NULL);
+
+    if(timing)
+    {
+      std::lock_guard<std::mutex> hold(latency_lock);
+      report.latency.merge(latency);
+    }
+  });
+
+  report.files = 0;
+  report.bytes = 0;
+
+  bool ok = true;
+
+  for(const BatchJob & job : jobs)
+  {
+    report.files += job.files;
+    report.bytes += job.bytes;
+    ok = ok && job.ok;
+  }
+
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Runs work(0)..work(count - 1) on a pool of
+// threads, each claiming the next index as it
+// finishes the last. The calling thread works too.
+// A thread's kept buffers are freed when it's done.
+//
+// *************************************************/
+template<typename Work>
+static void forEach(std::size_t count, unsigned threads, Work work)
+{
+  std::atomic<std::size_t> next_index(0);
+
+  auto worker = [&]()
+  {
+    std::size_t index = 0;
+
+    while((index = next_index++) < count)
+      work(index);
+
+    mtf::keepBuffers(false);
+  };
+
+  std::vector<std::thread> pool;
+
+  for(unsigned thread = 1; thread < threads; ++thread)
+    pool.push_back(std::thread(worker));
+
+  worker();
+
+  for(std::thread & thread : pool) thread.join();
+
+  return;
+}
+
+
+
+/* *************************************************
+// Finds the inputs of a job, leaving out its
+// output if that already exists.
+//
+// @param job: The job; its error is set on
+// failure.
+//
+// @param inputs: Filled with the job's files.
+//
+// @return: false if there's nothing to merge.
+//
+// *************************************************/
+static bool loadInputs(mtf::BatchJob & job, mtf::InputSet & inputs)
+{
+  struct stat out_info;
+
+  if(::stat(job.output.c_str(), &out_info) == 0)
+    inputs.exclude(out_info);
+
+  const char * source = job.source.c_str();
+  bool found = job.kind == mtf::SOURCE_DIR ? inputs.scanDirectory(source)
+             : job.kind == mtf::SOURCE_GLOB ? inputs.scanGlob(source)
+             : inputs.readList(source);
+
+  if(!found)
+    job.error = "could not read " + job.source + ": " + std::strerror(errno);
+  else if(inputs.size() == 0)
+    job.error = "no files to merge in " + job.source;
+
+  return job.error.empty();
+}
+
+
+
+/* *************************************************
+// Runs one job: a block copy of its inputs into
+// its output, and then its index. A full rewrite
+// also drops any incremental manifest beside the
+// output, as a single merge does.
+//
+// @param job: The job; its status and totals are
+// filled in.
+//
+// @param options: How to merge.
+//
+// @param latency: Gets the time of each file, or
+// NULL.
+//
+// *************************************************/
+static void runJob( mtf::BatchJob & job, const mtf::BatchOptions & options,
+                    mtf::LatencyHistogram * latency )
+{
+  mtf::InputSet inputs;
+
+  // The files may have changed since they were measured.
+  if(!loadInputs(job, inputs)) return;
+
+  int out_fd = mtf::openOutput(job.output.c_str());
+
+  if(out_fd < 0)
+  {
+    job.error = "could not open " + job.output + ": " + std::strerror(errno);
+    return;
+  }
+
+  mtf::MergeReport report = {};
+
+  bool ok = mtf::mergeBlocks(inputs, out_fd, options.block, report);
+
+  ok = (::close(out_fd) == 0) && ok;
+
+  if(!ok)
+  {
+    job.error = std::string("merge failed: ") + std::strerror(errno);
+    return;
+  }
+
+  std::remove(mtf::manifestPathFor(job.output.c_str()).c_str());
+
+  if( options.write_index
+      && !mtf::writeIndex( mtf::indexPathFor(job.output.c_str()).c_str(),
+                           report.sections, report.members ) )
+  {
+    job.error = std::string("could not write the index: ") + std::strerror(errno);
+    return;
+  }
+
+  if(latency) latency->merge(report.latency);
+
+  job.ok = true;
+  job.files = report.files;
+  job.bytes = report.bytes;
+  job.seconds = report.seconds;
+
+  return;
+}
+
+
+
+/* *************************************************
+// The threads to use: as asked (or one per CPU),
+// but at least one and no more than the jobs.
+//
+// *************************************************/
+static unsigned threadCount(unsigned threads, std::size_t jobs)
+{
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+  if(threads > jobs) threads = jobs;
+
+  return threads ? threads : 1;
+}
@@ -0,0 +1,72 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Batch.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for a batch of merges run in
+// one process. A job file lists many (inputs, output)
+// pairs; every job is measured, and then a single pool
+// of threads runs them largest first, each thread
+// reusing its buffers from one job to the next. Each
+// job ends with its own status. See Batch.cpp for more
+// information.
+//
+// ******************************************************/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include <vector>
+
+#include "Merge.h"
+
+
+namespace mtf
+{
+  // Where a job's inputs come from, as with --dir, --glob and --list.
+  enum SourceKind { SOURCE_DIR, SOURCE_GLOB, SOURCE_LIST };
+
+  // One merge in a batch, and how it went.
+  struct BatchJob
+  {
+    // The line of the job file it came from.
+    unsigned long line;
+    // Where the merge is written.
+    std::string output;
+    // Where the inputs are found.
+    SourceKind kind;
+    std::string source;
+    // The total size of the inputs, which sets the order jobs run in.
+    unsigned long long size;
+    // true once the merge (and its index) has been written..
+    bool ok;
+    // or else what went wrong.
+    std::string error;
+    // The totals of the merge.
+    unsigned long files;
+    unsigned long long bytes;
+    double seconds;
+  };
+
+  // Settings for a batch.
+  struct BatchOptions
+  {
+    // The threads that run jobs (0 for one per CPU).
+    unsigned threads;
+    // How each job is merged (see mergeBlocks).
+    BlockOptions block;
+    // false to write no section indexes.
+    bool write_index;
+  };
+
+  // Read a job file. On a bad line, bad_line is its number.
+  bool readJobs( const char * path, std::vector<BatchJob> & jobs,
+                 unsigned long & bad_line );
+
+  // Run every job; report gets the totals over all of them.
+  bool runBatch( std::vector<BatchJob> & jobs, const BatchOptions & options,
+                 MergeReport & report );
+};
+#endif // BATCH_H
@@ -0,0 +1,570 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Bench.cpp
+// Date:  October 17, 2026
+//
+// Overview: This program measures the merge routines on
+// synthetic corpora, so runs on the same hardware can
+// be compared from one change to the next. It writes
+// four corpora, the same bytes every time:
+//
+//   tiny   many files of a few hundred bytes
+//   huge   a few files of tens of megabytes
+//   long   files whose lines run to a megabyte
+//   crlf   files of short lines, all ending CR LF
+//
+// and merges each one with every copy strategy asked
+// for, with a cold page cache and then a warm one, and
+// prints the median MB/s and files/s of the runs. The
+// cache is emptied with /proc/sys/vm/drop_caches when
+// that's allowed (as root), and otherwise by telling
+// the kernel to drop each input's pages (posix_fadvise
+// DONTNEED), which works for any user.
+//
+// Options:
+//   --dir DIR      Where the corpora are kept (default
+//                  $TMPDIR/MergeBench, or /tmp). They
+//                  are made on the first run and
+//                  reused while --scale stays the same.
+//   --scale F      Make every corpus F times as big
+//                  (1 by default, about 250 MB in all).
+//   --corpus LIST  The corpora to run, comma separated
+//                  (all by default).
+//   --strategy LIST
+//                  The copies to run, comma separated:
+//                  block, kernel, parallel, uring, crlf
+//                  (the block copy with --crlf), read
+//                  and mmap (the block copy with
+//                  --mmap never and always).
+//                  block and kernel by default. Where
+//                  io_uring is unavailable, the uring
+//                  rows are kernel copies, and are
+//                  marked "uring*".
+//   --runs N       Runs of each, cold and warm (3).
+//   --warm-only    Skip the cold cache runs.
+//   --clean        Remove the corpora when done (and
+//                  --dir, if nothing else is in it).
+//
+// Build it with "make Bench" and run ./MergeBench, or
+// just "make bench".
+//
+// ******************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <thread>
+
+#include <getopt.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Merge.h"
+#include "Uring.h"
+
+
+// A corpus: its name and what its files look like.
+struct Corpus
+{
+  const char * name;
+  // The number of files, and the range of their sizes.
+  unsigned long files;
+  std::size_t min_size, max_size;
+  // The range of line lengths (without the line end).
+  std::size_t min_line, max_line;
+  // true to end every line with CR LF.
+  bool crlf;
+};
+
+// The corpora at scale 1.
+static const Corpus CORPORA[] =
+{
+  { "tiny", 20000,   16,             512,              8,       80,      false },
+  { "huge", 4,       24 << 20,       40 << 20,         20,      120,     false },
+  { "long", 24,      2 << 20,        4 << 20,          64 << 10, 1 << 20, false },
+  { "crlf", 160,     256 << 10,      768 << 10,        0,       60,      true  }
+};
+
+// The first corpus' seed (the others follow it), and the version of
+// the generator, which is bumped whenever the bytes it makes change.
+static const std::uint64_t CORPUS_SEED = 0x4d65726765ULL;
+static const int CORPUS_VERSION = 1;
+
+// The copy strategies that can be measured.
+static const char * const STRATEGIES[] = { "block", "kernel", "parallel", "uring", "crlf",
+                                           "read", "mmap" };
+
+// Fills a corpus' files with words from this list.
+static const char * const WORDS[] =
+{
+  "the", "merge", "of", "files", "and", "a", "page", "cache", "to", "in",
+  "buffer", "copy", "kernel", "section", "header", "line", "byte", "is",
+  "throughput", "0", "1970-01-01", "ERROR", "id=42", "\tvalue", "x"
+};
+
+
+/* ********************************************
+// A small, fast generator (splitmix64) that
+// gives the same numbers from the same seed on
+// every platform, unlike std::rand.
+//
+// ********************************************/
+class Random
+{
+  public:
+
+    explicit Random(std::uint64_t seed) : state(seed) {}
+
+    // The next 64 random bits.
+    std::uint64_t next(void)
+    {
+      std::uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+      return z ^ (z >> 31);
+    }
+
+    // A number from low to high, inclusive.
+    std::size_t between(std::size_t low, std::size_t high)
+    {
+      return low + next() % (high - low + 1);
+    }
+
+
+  private:
+
+    std::uint64_t state;
+};
+
+
+// Split a comma separated list.
+static std::vector<std::string> splitList(const char * text);
+// Make (or reuse) a corpus in dir.
+static bool makeCorpus(const Corpus & corpus, double scale, const std::string & dir);
+// Remove what makeCorpus made in dir.
+static void removeCorpus(const std::string & dir);
+// Empty the page cache of a corpus' inputs; true if drop_caches did it.
+static bool dropCaches(const mtf::InputSet & inputs);
+// Run one merge of inputs into out_name with a strategy.
+static bool runMerge( const std::string & strategy, const mtf::InputSet & inputs,
+                      const char * out_name, mtf::MergeReport & report,
+                      bool & fell_back );
+// The median of some numbers.
+static double median(std::vector<double> values);
+
+
+int main(int argc, char *argv[])
+{
+  const char * tmp = std::getenv("TMPDIR");
+  std::string dir = std::string(tmp && *tmp ? tmp : "/tmp") + "/MergeBench";
+  double scale = 1;
+  unsigned runs = 3;
+  bool cold = true, clean = false;
+  std::vector<std::string> corpora, strategies = { "block", "kernel" };
+
+  for(const Corpus & corpus : CORPORA) corpora.push_back(corpus.name);
+
+  // The options understood by this program.
+  const option long_opts[] =
+  {
+    { "dir",       required_argument, NULL, 'd' },
+    { "scale",     required_argument, NULL, 's' },
+    { "corpus",    required_argument, NULL, 'c' },
+    { "strategy",  required_argument, NULL, 'S' },
+    { "runs",      required_argument, NULL, 'r' },
+    { "warm-only", no_argument,       NULL, 'w' },
+    { "clean",     no_argument,       NULL, 'x' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt = 0;
+
+  while((opt = getopt_long(argc, argv, "", long_opts, NULL)) != -1)
+  {
+    switch(opt)
+    {
+      case 'd': dir = optarg; break;
+      case 's': scale = std::atof(optarg); break;
+      case 'c': corpora = splitList(optarg); break;
+      case 'S': strategies = splitList(optarg); break;
+      case 'r': runs = std::strtoul(optarg, NULL, 10); break;
+      case 'w': cold = false; break;
+      case 'x': clean = true; break;
+      default:  return 1;
+    }
+  }
+
+  // Check the lists against what we know how to run.
+  bool valid = scale > 0 && runs > 0 && !corpora.empty() && !strategies.empty();
+
+  for(const std::string & name : corpora)
+    valid = valid && std::any_of( std::begin(CORPORA), std::end(CORPORA),
+                                  [&](const Corpus & corpus) { return name == corpus.name; } );
+
+  for(const std::string & name : strategies)
+    valid = valid && std::find(std::begin(STRATEGIES), std::end(STRATEGIES), name)
+                     != std::end(STRATEGIES);
+
+  if(!valid)
+  {
+    std::cerr << "\nInvalid Argument!" << std::endl
+              << "Corpora are tiny, huge, long and crlf; strategies are block,"
+              << " kernel, parallel, uring, crlf, read and mmap; --scale and --runs must be"
+              << " positive.." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  if(::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST)
+  {
+    std::cerr << "\nCould not create " << dir << ": "
+              << std::strerror(errno) << std::endl << std::endl;
+
+    return 1;
+  }
+
+  const std::string out_name = dir + "/merged.out";
+  // Each cold run empties the cache one way or the other.
+  unsigned long dropped_runs = 0, advised_runs = 0;
+  bool ok = true, any_fallback = false;
+
+  std::cout << std::left << std::setw(8) << "corpus" << std::right
+            << std::setw(8) << "files" << std::setw(10) << "MB" << "  "
+            << std::left << std::setw(10) << "strategy" << std::setw(6) << "cache"
+            << std::right << std::setw(10) << "MB/s" << std::setw(12) << "files/s"
+            << std::endl;
+
+  for(const Corpus & corpus : CORPORA)
+  {
+    if(std::find(corpora.begin(), corpora.end(), corpus.name) == corpora.end())
+      continue;
+
+    std::string corpus_dir = dir + "/" + corpus.name;
+
+    if(!makeCorpus(corpus, scale, corpus_dir))
+    {
+      std::cerr << "\nCould not write " << corpus_dir << ": "
+                << std::strerror(errno) << std::endl << std::endl;
+
+      return 1;
+    }
+
+    mtf::InputSet inputs;
+
+    if(!inputs.scanDirectory(corpus_dir.c_str(), "*.txt"))
+    {
+      std::cerr << "\nCould not read " << corpus_dir << ": "
+                << std::strerror(errno) << std::endl << std::endl;
+
+      return 1;
+    }
+
+    for(const std::string & strategy : strategies)
+      for(int pass = cold ? 0 : 1; pass < 2; ++pass)
+      {
+        std::vector<double> mb_per_second, files_per_second;
+        mtf::MergeReport report = {};
+        bool merged = true, fell_back = false;
+        int failure = 0;
+
+        // The first warm run only fills the cache.
+        for(unsigned run = pass ? 0 : 1; run <= runs && merged; ++run)
+        {
+          // Let the last output's writeback finish before timing.
+          ::sync();
+
+          if(pass == 0)
+          {
+            if(dropCaches(inputs)) ++dropped_runs;
+            else ++advised_runs;
+          }
+
+          merged = runMerge(strategy, inputs, out_name.c_str(), report, fell_back);
+          failure = errno;
+
+          if(run == 0) continue;
+
+          mb_per_second.push_back(mtf::throughput(report));
+          files_per_second.push_back(report.seconds > 0 ? report.files / report.seconds : 0);
+        }
+
+        // A failed strategy skips its warm pass; the others still run.
+        if(!merged)
+        {
+          std::cerr << "\nMerge of " << corpus.name << " with " << strategy
+                    << " failed: " << std::strerror(failure) << std::endl;
+          ok = false;
+          break;
+        }
+
+        // A row run by another copy than its label says is marked.
+        any_fallback = any_fallback || fell_back;
+
+        std::cout << std::left << std::setw(8) << corpus.name << std::right
+                  << std::setw(8) << report.files << std::setw(10) << std::fixed
+                  << std::setprecision(1) << report.bytes / 1e6 << "  "
+                  << std::left << std::setw(10) << (strategy + (fell_back ? "*" : ""))
+                  << std::setw(6) << (pass ? "warm" : "cold") << std::right
+                  << std::setw(10) << median(mb_per_second)
+                  << std::setw(12) << std::setprecision(0) << median(files_per_second)
+                  << std::endl;
+      }
+  }
+
+  std::remove(out_name.c_str());
+
+  if(any_fallback)
+    std::cout << "\n* io_uring is unavailable, so these rows are kernel copies."
+              << std::endl;
+
+  if(dropped_runs + advised_runs > 0)
+    std::cout << "\nCold runs emptied the cache with "
+              << ( !advised_runs ? "drop_caches."
+                   : !dropped_runs ? "posix_fadvise (drop_caches isn't permitted)."
+                   : "drop_caches when permitted and posix_fadvise otherwise." )
+              << std::endl;
+
+  // Remove only what this program made: every corpus, and then the
+  // directory itself if that leaves it empty.
+  if(clean)
+  {
+    for(const Corpus & corpus : CORPORA)
+      removeCorpus(dir + "/" + corpus.name);
+
+    ::rmdir(dir.c_str());
+  }
+
+  return ok ? 0 : 1;
+}
+
+
+
+/* ********************************************
+// Splits "a,b,c" into its parts (empty ones are
+// dropped).
+//
+// ********************************************/
+static std::vector<std::string> splitList(const char * text)
+{
+  std::vector<std::string> parts;
+  std::istringstream in(text);
+  std::string part;
+
+  while(std::getline(in, part, ','))
+    if(!part.empty()) parts.push_back(part);
+
+  return parts;
+}
+
+
+
+/* ********************************************
+// Writes the files of a corpus into dir as
+// 1.txt..N.txt. The bytes depend only on the
+// corpus and the scale: every corpus has its
+// own seed. A stamp file records the scale
+// (and generator version), so a corpus already
+// made the same way is left as it is.
+//
+// @param corpus: The corpus.
+//
+// @param scale: How much to grow (or shrink)
+// the file sizes, or for tiny, the file count.
+//
+// @param dir: Where the files go.
+//
+// @return: false (with errno) if a file couldn't
+// be written.
+//
+// ********************************************/
+static bool makeCorpus(const Corpus & corpus, double scale, const std::string & dir)
+{
+  std::ostringstream stamp_text;
+  std::string stamp_path = dir + "/stamp", old_stamp;
+
+  stamp_text << corpus.name << " " << scale << " " << CORPUS_VERSION;
+
+  std::ifstream stamp_in(stamp_path);
+
+  if(std::getline(stamp_in, old_stamp) && old_stamp == stamp_text.str()) return true;
+
+  if(::mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+
+  // The tiny corpus grows in files, the others in bytes.
+  bool by_count = corpus.max_size < 4096;
+  unsigned long files = by_count ? std::max(1.0, corpus.files * scale) : corpus.files;
+  std::size_t min_size = by_count ? corpus.min_size : std::max(1.0, corpus.min_size * scale),
+              max_size = by_count ? corpus.max_size : std::max(1.0, corpus.max_size * scale);
+
+  Random random(CORPUS_SEED + (&corpus - CORPORA));
+  std::string body, line;
+
+  std::cout << "Making the " << corpus.name << " corpus.." << std::endl;
+
+  for(unsigned long index = 1; index <= files; ++index)
+  {
+    std::size_t size = random.between(min_size, max_size);
+
+    body.clear();
+
+    // Lines of words until the file is full.
+    while(body.size() < size)
+    {
+      std::size_t length = random.between(corpus.min_line, corpus.max_line);
+
+      line.clear();
+
+      while(line.size() < length)
+      {
+        if(!line.empty()) line += ' ';
+        line += WORDS[random.next() % (sizeof(WORDS) / sizeof(WORDS[0]))];
+      }
+
+      body += line;
+      body += corpus.crlf ? "\r\n" : "\n";
+    }
+
+    body.resize(size);
+
+    std::ofstream out(dir + "/" + std::to_string(index) + ".txt", std::ios::binary);
+
+    if(!out.write(body.data(), body.size()) || !out.flush()) return false;
+  }
+
+  // Files left over from a larger scale would be merged too.
+  for(unsigned long index = files + 1; ; ++index)
+    if(::unlink((dir + "/" + std::to_string(index) + ".txt").c_str()) != 0) break;
+
+  std::ofstream stamp_out(stamp_path);
+  stamp_out << stamp_text.str() << std::endl;
+
+  return static_cast<bool>(stamp_out.flush());
+}
+
+
+
+/* ********************************************
+// Removes a corpus made by makeCorpus: its
+// numbered files and stamp, and then its
+// directory, if nothing else was put there.
+//
+// ********************************************/
+static void removeCorpus(const std::string & dir)
+{
+  for(unsigned long index = 1; ; ++index)
+    if(::unlink((dir + "/" + std::to_string(index) + ".txt").c_str()) != 0) break;
+
+  ::unlink((dir + "/stamp").c_str());
+  ::rmdir(dir.c_str());
+}
+
+
+
+/* ********************************************
+// Empties the page cache before a cold run. As
+// root, /proc/sys/vm/drop_caches clears the
+// whole cache; otherwise each input's pages
+// are dropped with posix_fadvise, which the
+// kernel honours for clean pages.
+//
+// @param inputs: The corpus about to be read.
+//
+// @return: true if drop_caches was used.
+//
+// ********************************************/
+static bool dropCaches(const mtf::InputSet & inputs)
+{
+  int fd = ::open("/proc/sys/vm/drop_caches", O_WRONLY);
+  bool dropped = fd >= 0 && ::write(fd, "3", 1) == 1;
+
+  if(fd >= 0) ::close(fd);
+
+  if(dropped) return true;
+
+  for(unsigned long index = 0; index < inputs.size(); ++index)
+  {
+    int in_fd = inputs.open(index);
+
+    if(in_fd < 0) continue;
+
+    ::posix_fadvise(in_fd, 0, 0, POSIX_FADV_DONTNEED);
+    ::close(in_fd);
+  }
+
+  return false;
+}
+
+
+
+/* ********************************************
+// Merges inputs into a fresh out_name with one
+// of the strategies. fell_back is set if the
+// uring strategy had to use the kernel copy.
+//
+// ********************************************/
+static bool runMerge( const std::string & strategy, const mtf::InputSet & inputs,
+                      const char * out_name, mtf::MergeReport & report,
+                      bool & fell_back )
+{
+  int fd = mtf::openOutput(out_name);
+
+  if(fd < 0) return false;
+
+  mtf::BlockOptions options = mtf::BLOCK_DEFAULTS;
+  mtf::UringReport uring_report = {};
+  unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+  bool ok = false;
+
+  report = mtf::MergeReport();
+
+  if(strategy == "kernel")
+    ok = mtf::mergeKernel(inputs, fd, options.prefetch, report);
+  else if(strategy == "parallel")
+    ok = mtf::mergeParallel(inputs, fd, threads, report);
+  else if(strategy == "uring")
+  {
+    ok = mtf::mergeUring(inputs, fd, mtf::URING_DEFAULTS, report, uring_report);
+    fell_back = fell_back || (ok && !uring_report.used_ring);
+  }
+  else
+  {
+    options.transform.crlf = strategy == "crlf";
+
+    if(strategy == "read") options.map = mtf::MMAP_NEVER;
+    if(strategy == "mmap") options.map = mtf::MMAP_ALWAYS;
+    ok = mtf::mergeBlocks(inputs, fd, options, report);
+  }
+
+  return (::close(fd) == 0) && ok;
+}
+
+
+
+/* ********************************************
+// The middle value (the mean of the middle two
+// for an even count), or 0 for none.
+//
+// ********************************************/
+static double median(std::vector<double> values)
+{
+  if(values.empty()) return 0;
+
+  std::sort(values.begin(), values.end());
+
+  std::size_t middle = values.size() / 2;
+
+  return values.size() % 2 ? values[middle] : (values[middle - 1] + values[middle]) / 2;
+}
@@ -0,0 +1,137 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Dedup.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of DedupTable, declared in
+// Dedup.h. A matching size and XXH64 make a candidate;
+// the bytes of the two files are then compared before
+// anything is treated as a duplicate, so a hash
+// collision can never drop a body from the merge.
+//
+// ******************************************************/
+
+#include "Dedup.h"
+#include "Hash.h"
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <unistd.h>
+
+
+// Compare two open files from the start.
+static bool sameBodies(int fst_fd, int snd_fd);
+
+
+
+mtf::DedupTable::DedupTable(const InputSet & inputs)
+  : inputs(inputs)
+{ return; }
+
+
+
+/* *************************************************
+// Looks for an earlier input whose body is the
+// same as the file open on in_fd. If any earlier
+// body has the same size, in_fd is hashed first
+// (and then rewound), and every earlier body with
+// the same hash is compared with it byte by byte.
+//
+// @param in_fd: The input, at offset 0.
+//
+// @param size: Its size.
+//
+// @param hash: Set to its hash, if it was hashed.
+//
+// @param hashed: Set to true if it was hashed.
+//
+// @return: The index of the earlier input with the
+// same body, or -1. Either way, in_fd is left at
+// offset 0.
+//
+// *************************************************/
+long mtf::DedupTable::find( int in_fd, unsigned long long size,
+                            std::uint64_t & hash, bool & hashed )
+{
+  hashed = false;
+
+  auto candidates = bodies.find(size);
+
+  // If no earlier body is this size, this one is new.
+  if(candidates == bodies.end()) return -1;
+
+  hashed = hashFile(in_fd, hash);
+
+  if(!hashed || ::lseek(in_fd, 0, SEEK_SET) != 0) return -1;
+
+  for(const std::pair<unsigned long, std::uint64_t> & body : candidates->second)
+  {
+    if(body.second != hash) continue;
+
+    int earlier_fd = inputs.open(body.first);
+
+    if(earlier_fd < 0) continue;
+
+    bool same = sameBodies(in_fd, earlier_fd);
+
+    ::close(earlier_fd);
+
+    if(same) return body.first;
+  }
+
+  return -1;
+}
+
+
+
+/* *************************************************
+// Remembers a body that was copied into the merge.
+//
+// @param index: The (0 based) input.
+//
+// @param size: The size of its body.
+//
+// @param hash: The XXH64 of its body.
+//
+// *************************************************/
+void mtf::DedupTable::add(unsigned long index, unsigned long long size, std::uint64_t hash)
+{
+  bodies[size].push_back(std::make_pair(index, hash));
+
+  return;
+}
+
+
+
+/* *************************************************
+// Compares two files from their first byte to
+// their last with pread, so neither offset moves.
+//
+// @return: true if both could be read and hold the
+// same bytes.
+//
+// *************************************************/
+static bool sameBodies(int fst_fd, int snd_fd)
+{
+  const std::size_t BLOCK = 1 << 16;
+  std::unique_ptr<char[]> fst(new char[BLOCK]), snd(new char[BLOCK]);
+
+  for(off_t offset = 0; ; )
+  {
+    ssize_t fst_got = ::pread(fst_fd, fst.get(), BLOCK, offset),
+            snd_got = ::pread(snd_fd, snd.get(), BLOCK, offset);
+
+    if((fst_got < 0 || snd_got < 0) && errno == EINTR) continue;
+
+    // Short reads only happen at the end of a regular file.
+    if(fst_got < 0 || fst_got != snd_got) return false;
+    if(fst_got == 0) return true;
+
+    if(std::memcmp(fst.get(), snd.get(), fst_got) != 0) return false;
+
+    offset += fst_got;
+  }
+}
@@ -0,0 +1,61 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Dedup.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of DedupTable, which finds
+// inputs whose bodies are byte for byte the same as
+// one merged earlier, so the merge can write a short
+// "FILE #n = FILE #k" reference instead of a second
+// copy. See Dedup.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "Inputs.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+namespace mtf
+{
+  /* ************************************************
+  // The bodies merged so far, by size and hash.
+  // Only a file the same size as an earlier body
+  // can be a duplicate, so most files are never
+  // looked at twice: their hash is taken while they
+  // are copied, and the table only reads a file
+  // ahead of the copy when its size matches.
+  //
+  // ************************************************/
+  class DedupTable
+  {
+    public:
+
+      // A table for a merge of inputs.
+      explicit DedupTable(const InputSet & inputs);
+
+      // Find an earlier input with the same body as in_fd.
+      long find( int in_fd, unsigned long long size,
+                 std::uint64_t & hash, bool & hashed );
+
+      // Remember the body of input index.
+      void add(unsigned long index, unsigned long long size, std::uint64_t hash);
+
+
+    private:
+
+      const InputSet & inputs;
+
+      // For each body size, the inputs with that size and their hashes.
+      std::unordered_map< unsigned long long,
+                          std::vector<std::pair<unsigned long, std::uint64_t> > > bodies;
+  };
+};
+#endif // DEDUP_H
@@ -0,0 +1,97 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  ExtractFile.cpp
+// Date:  October 17, 2026
+//
+// Overview: This program pulls single files back out of
+// a merge made by MergeTextFiles, using the index that
+// was written beside it. Run it with the merged file
+// and the number of the file wanted, e.g.
+//
+//   ExtractFile AllFiles.txt 42
+//
+// and the body of file #42 (the original contents of
+// 42.txt) is written to standard output. An index other
+// than AllFiles.idx can be named as a third argument. A
+// compressed merge (AllFiles.txt.gz, with its index
+// AllFiles.txt.idx) works the same way; only the gzip
+// members holding the file are inflated.
+//
+// ******************************************************/
+
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+
+#include <unistd.h>
+
+#include "Index.h"
+
+
+int main(int argc, char *argv[])
+{
+  // If the merged file or file number is missing..
+  if(argc < 3)
+  {
+    // Print an alert for invalid argument list..
+    std::cerr << "\nInvalid Argument!" << std::endl
+              << "Usage: ExtractFile MERGED_FILE NUMBER [INDEX_FILE].."
+              << std::endl << std::endl;
+
+    // Return with error code 1.
+    return 1;
+  }
+
+  // The number of the file to extract.
+  unsigned long long number = std::strtoull(argv[2], NULL, 10);
+
+  // Use the given index, or the one beside the merged file.
+  std::string index_path = argc > 3 ? argv[3] : mtf::indexPathFor(argv[1]);
+
+  mtf::SectionReader reader;
+
+  // If the merge or its index can't be opened..
+  if(!reader.open(argv[1], index_path.c_str()))
+  {
+    std::cerr << "\nCould not open " << argv[1] << " with index "
+              << index_path << ": " << std::strerror(errno)
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  mtf::IndexEntry entry;
+
+  // If there's no such file in the merge..
+  if(!reader.locate(number, entry))
+  {
+    std::cerr << "\nThere is no file #" << argv[2] << " in " << argv[1]
+              << " (it holds " << reader.count() << " files).."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // If the file couldn't be read when it was merged..
+  if(entry.offset == mtf::NO_BODY)
+  {
+    std::cerr << "\nFile #" << number << " was not readable when "
+              << argv[1] << " was merged.." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // Write the body to standard output.
+  if(!reader.extract(number, STDOUT_FILENO))
+  {
+    std::cerr << "\nExtract failed: " << std::strerror(errno)
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,440 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  FileCopy.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for the low level copy
+// routines declared in FileCopy.h. copyKernel asks the
+// kernel to move the data with copy_file_range, then
+// sendfile, and only falls back to copyBlocks (plain
+// read & write with a large buffer) when neither of
+// those is supported for the given pair of files.
+//
+// ******************************************************/
+
+#include "FileCopy.h"
+#include "Stats.h"
+
+#include <cerrno>
+#include <memory>
+
+#include <poll.h>
+#include <unistd.h>
+#include <sys/sendfile.h>
+
+
+// Anything larger than this is split over several calls.
+static const std::size_t KERNEL_CHUNK = 1 << 30;
+
+
+/* *************************************************
+// Returns true if errno indicates that a kernel
+// copy primitive can't handle this pair of files,
+// in which case the next method should be tried.
+//
+// *************************************************/
+static bool unsupported(int err)
+{
+  return err == EINVAL || err == ENOSYS || err == EXDEV
+      || err == EOPNOTSUPP || err == EBADF;
+}
+
+
+
+// copy_file_range and sendfile, timed as copies.
+static ssize_t timedCopyRange(int in_fd, loff_t * in_off, int out_fd, loff_t * out_off, std::size_t len)
+{
+  mtf::CallTimer timer(mtf::CALL_COPY);
+
+  return ::copy_file_range(in_fd, in_off, out_fd, out_off, len, 0);
+}
+
+static ssize_t timedSendfile(int out_fd, int in_fd, std::size_t len)
+{
+  mtf::CallTimer timer(mtf::CALL_COPY);
+
+  return ::sendfile(out_fd, in_fd, NULL, len);
+}
+
+
+
+/* *************************************************
+// Waits until fd can take more data. This is how
+// a non-blocking pipe or socket pushes back on us
+// when its reader falls behind.
+//
+// @return: false if poll failed.
+//
+// *************************************************/
+bool mtf::waitWritable(int fd)
+{
+  pollfd waiting = { fd, POLLOUT, 0 };
+
+  for(;;)
+  {
+    int ready = ::poll(&waiting, 1, -1);
+
+    if(ready > 0) return true;
+    if(ready < 0 && errno != EINTR) return false;
+  }
+}
+
+
+
+/* *************************************************
+// Writes len bytes from data to fd. write may
+// write less than it was asked to, so keep going
+// until everything is out or a real error occurs.
+// If fd is non-blocking and full, wait for room.
+//
+// @param fd: The file descriptor to write to.
+//
+// @param data: The bytes to be written.
+//
+// @param len: The number of bytes to write.
+//
+// @param done: If not NULL, set to the number of
+// bytes written, so a caller can pick up where a
+// failed write stopped.
+//
+// @return: true if every byte was written.
+//
+// *************************************************/
+bool mtf::writeAll(int fd, const char * data, std::size_t len, std::size_t * done)
+{
+  if(done) *done = 0;
+
+  // While there are unwritten bytes..
+  while(len > 0)
+  {
+    ssize_t written;
+
+    {
+      CallTimer timer(CALL_WRITE);
+      written = ::write(fd, data, len);
+    }
+
+    // If the write was interrupted, try again.
+    if(written < 0 && errno == EINTR) continue;
+
+    // If the output is full, wait for the reader to catch up.
+    if(written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      if(!waitWritable(fd)) return false;
+      continue;
+    }
+
+    // Any other failure is fatal.
+    if(written <= 0) return false;
+
+    data += written;
+    len -= written;
+
+    if(done) *done += written;
+  }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Writes count buffers to fd, in order, with as
+// few writev calls as it takes. As with writeAll,
+// short writes carry on where they stopped.
+//
+// @param fd: The file descriptor to write to.
+//
+// @param vectors: The buffers; each is advanced
+// past what has been written of it.
+//
+// @param count: The number of buffers.
+//
+// @return: true if every byte was written.
+//
+// *************************************************/
+bool mtf::writevAll(int fd, struct iovec * vectors, int count)
+{
+  for(;;)
+  {
+    // Skip the buffers that are done.
+    while(count > 0 && vectors->iov_len == 0)
+    {
+      ++vectors;
+      --count;
+    }
+
+    if(count == 0) return true;
+
+    ssize_t written;
+
+    {
+      CallTimer timer(CALL_WRITE);
+      written = ::writev(fd, vectors, count);
+    }
+
+    // If the write was interrupted, try again.
+    if(written < 0 && errno == EINTR) continue;
+
+    // If the output is full, wait for the reader to catch up.
+    if(written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+    {
+      if(!waitWritable(fd)) return false;
+      continue;
+    }
+
+    // Any other failure is fatal.
+    if(written <= 0) return false;
+
+    // Move past what was written.
+    for(std::size_t left = written; left > 0; ++vectors, --count)
+    {
+      std::size_t part = left < vectors->iov_len ? left : vectors->iov_len;
+
+      vectors->iov_base = static_cast<char *>(vectors->iov_base) + part;
+      vectors->iov_len -= part;
+      left -= part;
+
+      if(vectors->iov_len > 0) break;
+    }
+  }
+}
+
+
+
+/* *************************************************
+// Copies everything from the current offset of
+// in_fd to the current offset of out_fd using
+// read and write with the given buffer.
+//
+// @param in_fd: The file descriptor to read from.
+//
+// @param out_fd: The file descriptor to write to.
+//
+// @param buffer: Scratch space for the copy.
+//
+// @param buffer_size: The size of buffer in bytes.
+//
+// @param copied: Incremented by the number of bytes
+// copied.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::copyBlocks( int in_fd, int out_fd,
+                      char * buffer, std::size_t buffer_size,
+                      unsigned long long & copied )
+{
+  for(;;)
+  {
+    ssize_t got;
+
+    {
+      CallTimer timer(CALL_READ);
+      got = ::read(in_fd, buffer, buffer_size);
+    }
+
+    // If the read was interrupted, try again.
+    if(got < 0 && errno == EINTR) continue;
+
+    // Stop on errors..
+    if(got < 0) return false;
+    // and at the end of the input.
+    if(got == 0) return true;
+
+    // Pass the block on to the output.
+    if(!writeAll(out_fd, buffer, got)) return false;
+
+    copied += got;
+  }
+}
+
+
+
+/* *************************************************
+// Copies everything from the current offset of
+// in_fd to the current offset of out_fd without
+// bringing the data into user space. Both
+// copy_file_range and sendfile advance the file
+// offsets they are given, so if one of them stops
+// being supported part way through, the next one
+// simply picks up where it left off.
+//
+// @param in_fd: The file descriptor to read from.
+//
+// @param out_fd: The file descriptor to write to.
+//
+// @param copied: Incremented by the number of bytes
+// copied.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::copyKernel(int in_fd, int out_fd, unsigned long long & copied)
+{
+  ssize_t moved = 0;
+
+  // First choice: copy_file_range (may even share extents).
+  while((moved = timedCopyRange(in_fd, NULL, out_fd, NULL, KERNEL_CHUNK)) != 0)
+  {
+    if(moved > 0) { copied += moved; continue; }
+    if(errno == EINTR) continue;
+
+    // If this pair of files isn't supported, try sendfile.
+    if(unsupported(errno)) break;
+
+    return false;
+  }
+
+  // If copy_file_range reached the end of the input, we're done.
+  if(moved == 0) return true;
+
+  // Second choice: sendfile.
+  while((moved = timedSendfile(out_fd, in_fd, KERNEL_CHUNK)) != 0)
+  {
+    if(moved > 0) { copied += moved; continue; }
+    if(errno == EINTR) continue;
+
+    // If the output is a full non-blocking pipe, wait for room.
+    if(errno == EAGAIN)
+    {
+      if(!waitWritable(out_fd)) return false;
+      continue;
+    }
+
+    // If this pair of files isn't supported, use read & write.
+    if(unsupported(errno)) break;
+
+    return false;
+  }
+
+  if(moved == 0) return true;
+
+  // Last resort: large block reads and writes.
+  std::unique_ptr<char[]> buffer(new char[COPY_BLOCK_SIZE]);
+
+  return copyBlocks(in_fd, out_fd, buffer.get(), COPY_BLOCK_SIZE, copied);
+}
+
+
+
+/* *************************************************
+// Writes len bytes from data to fd, starting at
+// offset. The file offset of fd is not changed, so
+// several threads may write different parts of
+// the same file at once.
+//
+// @param fd: The file descriptor to write to.
+//
+// @param data: The bytes to be written.
+//
+// @param len: The number of bytes to write.
+//
+// @param offset: Where in the file to write them.
+//
+// @return: true if every byte was written.
+//
+// *************************************************/
+bool mtf::pwriteAll(int fd, const char * data, std::size_t len, long long offset)
+{
+  // While there are unwritten bytes..
+  while(len > 0)
+  {
+    ssize_t written;
+
+    {
+      CallTimer timer(CALL_WRITE);
+      written = ::pwrite(fd, data, len, offset);
+    }
+
+    // If the write was interrupted, try again.
+    if(written < 0 && errno == EINTR) continue;
+
+    // Any other failure is fatal.
+    if(written <= 0) return false;
+
+    data += written;
+    len -= written;
+    offset += written;
+  }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Copies the first length bytes of in_fd into
+// out_fd at out_offset. Explicit offsets are
+// passed to copy_file_range, so neither file
+// offset moves. sendfile can't write at a given
+// offset, so if copy_file_range isn't supported
+// the fallback is pread & pwrite.
+//
+// @param in_fd: The file descriptor to read from.
+//
+// @param out_fd: The file descriptor to write to.
+//
+// @param out_offset: Where to write in out_fd.
+//
+// @param length: The number of bytes to copy.
+//
+// @return: false on error, or if in_fd holds fewer
+// than length bytes (with errno set to EIO).
+//
+// *************************************************/
+bool mtf::copyRange( int in_fd, int out_fd,
+                     long long out_offset, unsigned long long length )
+{
+  loff_t in_off = 0, out_off = out_offset;
+
+  // First choice: copy_file_range.
+  while(length > 0)
+  {
+    std::size_t want = length < KERNEL_CHUNK ? length : KERNEL_CHUNK;
+    ssize_t moved = timedCopyRange(in_fd, &in_off, out_fd, &out_off, want);
+
+    if(moved > 0) { length -= moved; continue; }
+
+    // If the input ended early, it changed since it was measured.
+    if(moved == 0) { errno = EIO; return false; }
+
+    if(errno == EINTR) continue;
+
+    // If this pair of files isn't supported, use pread & pwrite.
+    if(unsupported(errno)) break;
+
+    return false;
+  }
+
+  if(length == 0) return true;
+
+  std::unique_ptr<char[]> buffer(new char[COPY_BLOCK_SIZE]);
+
+  // Fallback: large block preads and pwrites.
+  while(length > 0)
+  {
+    std::size_t want = length < COPY_BLOCK_SIZE ? length : COPY_BLOCK_SIZE;
+    ssize_t got;
+
+    {
+      CallTimer timer(CALL_READ);
+      got = ::pread(in_fd, buffer.get(), want, in_off);
+    }
+
+    if(got < 0 && errno == EINTR) continue;
+    if(got < 0) return false;
+
+    // The input ended early, as above.
+    if(got == 0) { errno = EIO; return false; }
+
+    if(!pwriteAll(out_fd, buffer.get(), got, out_off)) return false;
+
+    in_off += got;
+    out_off += got;
+    length -= got;
+  }
+
+  return true;
+}
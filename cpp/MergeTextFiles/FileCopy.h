@@ -0,0 +1,57 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  FileCopy.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the low level copy
+// routines used by MergeTextFiles. These work on raw
+// file descriptors so that whole file bodies can be
+// moved by the kernel (copy_file_range / sendfile)
+// without passing through a user space buffer. See
+// FileCopy.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef FILE_COPY_H
+#define FILE_COPY_H
+
+#include <cstddef>
+
+#include <sys/uio.h>
+
+
+namespace mtf
+{
+  // The size of the blocks moved by the read/write fallback.
+  const std::size_t COPY_BLOCK_SIZE = 1 << 20;
+
+  // Block until fd (a pipe or socket) has room for more data.
+  bool waitWritable(int fd);
+
+  // Write len bytes from data to fd, retrying short writes. If done
+  // isn't NULL, it gets the number of bytes written, even on failure.
+  bool writeAll(int fd, const char * data, std::size_t len, std::size_t * done = NULL);
+
+  // Write every byte of count buffers to fd, retrying short writes.
+  // The buffers are used up as they are written.
+  bool writevAll(int fd, struct iovec * vectors, int count);
+
+  // Copy everything left in in_fd to out_fd using the kernel,
+  // falling back to large block reads and writes if needed.
+  bool copyKernel(int in_fd, int out_fd, unsigned long long & copied);
+
+  // Copy everything left in in_fd to out_fd with read & write.
+  bool copyBlocks( int in_fd, int out_fd,
+                   char * buffer, std::size_t buffer_size,
+                   unsigned long long & copied );
+
+  // Write len bytes from data to fd at offset, retrying short writes.
+  bool pwriteAll(int fd, const char * data, std::size_t len, long long offset);
+
+  // Copy length bytes from the start of in_fd to out_fd at out_offset
+  // without touching either file offset (safe to share out_fd).
+  bool copyRange( int in_fd, int out_fd,
+                  long long out_offset, unsigned long long length );
+};
+#endif // FILE_COPY_H
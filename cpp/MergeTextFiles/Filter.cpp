@@ -0,0 +1,488 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Filter.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of the filtered merge,
+// declared in Filter.h. Lines aren't looked at one by
+// one: the search runs over a whole buffer of lines
+// for the first literal, and only when it finds one
+// does the merge look back and forward for the line
+// around it, keep that line, and carry on after it. So
+// when few lines match, nearly all the time is spent
+// in the vector search, which moves 32 bytes a step.
+//
+// The search is after Teddy (from Hyperscan): each
+// literal is given one of 8 buckets, and for each of
+// its first three bytes, the bucket's bit is set in a
+// 16 entry table under that byte's low nibble and in
+// another under its high nibble. A shuffle looks up
+// every byte of a register in a table at once, so ANDing
+// the lookups for the low and high nibbles of each of
+// the three bytes leaves a bit set only where some
+// bucket's literals could start. Those few places are
+// then compared in full. The AVX2 and SSSE3 kernels
+// and the plain C++ one find the same matches.
+//
+// ******************************************************/
+
+#include "Filter.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MTF_X86 1
+#endif
+
+
+// The smallest buffer lines are read into.
+static const std::size_t MIN_BUFFER = 64 * 1024;
+
+
+
+/* *************************************************
+// Builds the search tables for a set of literals.
+//
+// @param options: The literals, and whether they
+// must start the line.
+//
+// @param kernel: How to search. The 128 bit kernel
+// needs SSSE3 for its shuffles; without it, or if
+// the CPU can't run kernel at all, the plain C++
+// search is used.
+//
+// *************************************************/
+mtf::LineFilter::LineFilter(const FilterOptions & options, TransformKernel kernel)
+  : literals(options.literals), prefix(options.prefix),
+    kernel(kernelSupported(kernel) ? kernel : KERNEL_SCALAR), width(3)
+{
+#ifdef MTF_X86
+  if(this->kernel == KERNEL_SSE2 && !__builtin_cpu_supports("ssse3"))
+    this->kernel = KERNEL_SCALAR;
+#endif
+
+  // The fingerprint can't be longer than the shortest literal.
+  for(const std::string & literal : literals)
+    width = std::min(width, literal.size());
+
+  if(literals.empty()) width = 0;
+
+  std::memset(low, 0, sizeof(low));
+  std::memset(high, 0, sizeof(high));
+
+  for(std::size_t index = 0; index < literals.size(); ++index)
+  {
+    unsigned bucket = index % 8;
+
+    buckets[bucket].push_back(index);
+
+    for(std::size_t at = 0; at < width; ++at)
+    {
+      unsigned char byte = literals[index][at];
+
+      low[at][byte & 0x0f] |= 1 << bucket;
+      high[at][byte >> 4] |= 1 << bucket;
+    }
+  }
+}
+
+
+
+/* *************************************************
+// Finds the first literal in part of a text.
+//
+// @param text: The text.
+//
+// @param from: Where to start looking.
+//
+// @param len: Where to stop; no match runs past it.
+//
+// @return: The offset of the first match, or len.
+//
+// *************************************************/
+std::size_t mtf::LineFilter::find(const char * text, std::size_t from, std::size_t len) const
+{
+  if(width == 0) return len;
+
+  switch(kernel)
+  {
+    case KERNEL_AVX2: return findAvx2(text, from, len);
+    case KERNEL_SSE2: return findSsse3(text, from, len);
+    default:          return findScalar(text, from, len);
+  }
+}
+
+
+
+/* *************************************************
+// Decides whether a line that holds a literal is
+// kept: always, unless only prefixes count.
+//
+// @param text: The line.
+//
+// @param len: Its length.
+//
+// @return: true if the line is kept.
+//
+// *************************************************/
+bool mtf::LineFilter::keeps(const char * text, std::size_t len) const
+{
+  if(!prefix) return find(text, 0, len) < len;
+
+  for(const std::string & literal : literals)
+    if(len >= literal.size() && std::memcmp(text, literal.data(), literal.size()) == 0)
+      return true;
+
+  return false;
+}
+
+
+
+/* *************************************************
+// Compares the literals of some buckets in full.
+//
+// @param bits: The buckets whose fingerprints
+// matched at text[at].
+//
+// @return: true if one of their literals is there.
+//
+// *************************************************/
+bool mtf::LineFilter::verify(const char * text, std::size_t at, std::size_t len, unsigned bits) const
+{
+  for(; bits; bits &= bits - 1)
+    for(std::size_t index : buckets[__builtin_ctz(bits)])
+    {
+      const std::string & literal = literals[index];
+
+      if( len - at >= literal.size()
+          && std::memcmp(text + at, literal.data(), literal.size()) == 0 )
+        return true;
+    }
+
+  return false;
+}
+
+
+
+/* *************************************************
+// The plain C++ search: the same tables, looked up
+// a byte at a time. Also finishes the vector
+// searches, whose loads would run past len.
+//
+// *************************************************/
+std::size_t mtf::LineFilter::findScalar(const char * text, std::size_t from, std::size_t len) const
+{
+  const unsigned char * bytes = reinterpret_cast<const unsigned char *>(text);
+
+  for(; from + width <= len; ++from)
+  {
+    unsigned bits = 0xff;
+
+    for(std::size_t at = 0; bits && at < width; ++at)
+      bits &= low[at][bytes[from + at] & 0x0f] & high[at][bytes[from + at] >> 4];
+
+    if(bits && verify(text, from, len, bits)) return from;
+  }
+
+  return len;
+}
+
+
+#ifdef MTF_X86
+
+/* *************************************************
+// SSSE3: 16 positions at a time. The load for the
+// second and third fingerprint bytes is simply
+// shifted along by one and two.
+//
+// *************************************************/
+__attribute__((target("ssse3")))
+std::size_t mtf::LineFilter::findSsse3(const char * text, std::size_t from, std::size_t len) const
+{
+  const __m128i nibble = _mm_set1_epi8(0x0f), zero = _mm_setzero_si128();
+  __m128i lows[3], highs[3];
+  alignas(16) unsigned char hits[16];
+
+  for(std::size_t at = 0; at < width; ++at)
+  {
+    lows[at] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(low[at]));
+    highs[at] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(high[at]));
+  }
+
+  for(; from + 16 + width - 1 <= len; from += 16)
+  {
+    __m128i found = _mm_set1_epi8(-1);
+
+    for(std::size_t at = 0; at < width; ++at)
+    {
+      __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(text + from + at));
+      __m128i lo = _mm_and_si128(block, nibble),
+              hi = _mm_and_si128(_mm_srli_epi16(block, 4), nibble);
+
+      found = _mm_and_si128(found, _mm_and_si128(_mm_shuffle_epi8(lows[at], lo),
+                                                 _mm_shuffle_epi8(highs[at], hi)));
+    }
+
+    unsigned mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(found, zero)) & 0xffff;
+
+    if(!mask) continue;
+
+    _mm_store_si128(reinterpret_cast<__m128i *>(hits), found);
+
+    for(; mask; mask &= mask - 1)
+    {
+      unsigned at = __builtin_ctz(mask);
+
+      if(verify(text, from + at, len, hits[at])) return from + at;
+    }
+  }
+
+  return findScalar(text, from, len);
+}
+
+
+
+/* *************************************************
+// AVX2: as findSsse3, 32 positions at a time. The
+// shuffle works within each 128 bit half, so the
+// tables are copied into both.
+//
+// *************************************************/
+__attribute__((target("avx2")))
+std::size_t mtf::LineFilter::findAvx2(const char * text, std::size_t from, std::size_t len) const
+{
+  const __m256i nibble = _mm256_set1_epi8(0x0f), zero = _mm256_setzero_si256();
+  __m256i lows[3], highs[3];
+  alignas(32) unsigned char hits[32];
+
+  for(std::size_t at = 0; at < width; ++at)
+  {
+    lows[at] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(low[at])));
+    highs[at] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(high[at])));
+  }
+
+  for(; from + 32 + width - 1 <= len; from += 32)
+  {
+    __m256i found = _mm256_set1_epi8(-1);
+
+    for(std::size_t at = 0; at < width; ++at)
+    {
+      __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(text + from + at));
+      __m256i lo = _mm256_and_si256(block, nibble),
+              hi = _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble);
+
+      found = _mm256_and_si256(found, _mm256_and_si256(_mm256_shuffle_epi8(lows[at], lo),
+                                                       _mm256_shuffle_epi8(highs[at], hi)));
+    }
+
+    unsigned mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(found, zero));
+
+    if(!mask) continue;
+
+    _mm256_store_si256(reinterpret_cast<__m256i *>(hits), found);
+
+    for(; mask; mask &= mask - 1)
+    {
+      unsigned at = __builtin_ctz(mask);
+
+      if(verify(text, from + at, len, hits[at])) return from + at;
+    }
+  }
+
+  return findScalar(text, from, len);
+}
+
+#else
+
+std::size_t mtf::LineFilter::findSsse3(const char * text, std::size_t from, std::size_t len) const
+{
+  return findScalar(text, from, len);
+}
+
+std::size_t mtf::LineFilter::findAvx2(const char * text, std::size_t from, std::size_t len) const
+{
+  return findScalar(text, from, len);
+}
+
+#endif // MTF_X86
+
+
+
+/* *************************************************
+// Merges only the lines that pass the filter. Each
+// input is read a buffer at a time; the whole lines
+// in it are searched, and the unfinished last line
+// is moved to the front to be completed by the next
+// read (the buffer grows if one line fills it). A
+// kept line that ends the file without a newline
+// gets one, so it doesn't run into the next.
+//
+// With headers, a file with kept lines gets its
+// "FILE #n" header, the lines as its body, and the
+// terminator and separator, just as in a full
+// merge; files with none are left out. Without, the
+// output is just the kept lines, as grep would
+// print them. Inputs that can't be opened, or
+// aren't regular files, are skipped and counted in
+// filter_report.unreadable.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output.
+//
+// @param options: The buffer size, prefetch depth
+// and how the output is written.
+//
+// @param filter_options: The literals, and whether
+// to match prefixes and write headers.
+//
+// @param report: Filled with totals for the merge.
+//
+// @param filter_report: Filled with the lines and
+// files kept, and the inputs skipped.
+//
+// @return: true if every input that was opened
+// could be read and the output written.
+//
+// *************************************************/
+bool mtf::mergeFiltered( const InputSet & inputs, int out_fd,
+                         const BlockOptions & options,
+                         const FilterOptions & filter_options,
+                         MergeReport & report, FilterReport & filter_report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+
+  Writer out(out_fd, options.chunk_size, 0, options.write);
+  Prefetcher ahead(inputs, 0, options.prefetch);
+  LineFilter filter(filter_options);
+  std::vector<char> buffer(std::max(options.chunk_size, MIN_BUFFER));
+
+  filter_report = FilterReport();
+  report.sections.clear();
+  report.latency = LatencyHistogram();
+
+  LatencyHistogram * latency = fileHistogram(report);
+  bool ok = true;
+
+  for(unsigned long index = 0; ok && index < count; ++index)
+  {
+    FileTimer timer(latency);
+
+    int in_fd = ahead.take();
+    struct stat info;
+
+    // Only regular files are read, as in the other merges; the rest are counted.
+    if(in_fd >= 0 && (::fstat(in_fd, &info) != 0 || !S_ISREG(info.st_mode)))
+    {
+      ::close(in_fd);
+      in_fd = -1;
+    }
+
+    if(in_fd < 0) ++filter_report.unreadable;
+
+    // The bytes of an unfinished line at the front of the buffer.
+    std::size_t held = 0;
+    bool matched = false, ended = in_fd < 0;
+
+    while(ok && !ended)
+    {
+      // A line longer than the buffer needs a bigger one.
+      if(held == buffer.size()) buffer.resize(2 * buffer.size());
+
+      ssize_t got;
+
+      {
+        CallTimer timer(CALL_READ);
+        got = ::read(in_fd, &buffer[held], buffer.size() - held);
+      }
+
+      // If the read was interrupted, try again.
+      if(got < 0 && errno == EINTR) continue;
+
+      if(got < 0)
+      {
+        ok = false;
+        break;
+      }
+
+      ended = got == 0;
+
+      const char * text = buffer.data();
+      std::size_t filled = held + got, end = filled, at = 0, hit = 0;
+
+      // Until the end, only search up to the last newline.
+      if(!ended)
+      {
+        const void * last = ::memrchr(text + held, '\n', got);
+        end = last ? static_cast<const char *>(last) - text + 1 : 0;
+      }
+
+      while(ok && (hit = filter.find(text, at, end)) < end)
+      {
+        // Find the line the literal is in.
+        const void * before = ::memrchr(text + at, '\n', hit - at),
+                   * after = std::memchr(text + hit, '\n', end - hit);
+        std::size_t line = before ? static_cast<const char *>(before) - text + 1 : at,
+                    next = after ? static_cast<const char *>(after) - text + 1 : end;
+
+        if(!filter_options.prefix || filter.keeps(text + line, next - line))
+        {
+          if(!matched && filter_options.headers)
+          {
+            std::string header = sectionHeader(index + 1);
+            ok = out.append(header.data(), header.size());
+          }
+
+          matched = true;
+          ++filter_report.kept;
+
+          ok = ok && out.append(text + line, next - line);
+          if(!after) ok = ok && out.append("\n", 1);
+        }
+
+        at = next;
+      }
+
+      // Keep the unfinished line for the next read.
+      held = filled - end;
+      std::memmove(&buffer[0], text + end, held);
+    }
+
+    // Close the input file.
+    if(in_fd >= 0) ::close(in_fd);
+
+    if(matched)
+    {
+      ++filter_report.matched;
+
+      // End the section as a full merge would.
+      if(filter_options.headers)
+        ok = ok && out.append(BODY_TERMINATOR, sizeof(BODY_TERMINATOR) - 1)
+                && out.append(SECTION_SEPARATOR, sizeof(SECTION_SEPARATOR) - 1);
+    }
+
+    timer.done();
+    stepProgress(index + 1, out.position());
+  }
+
+  // Write out whatever is still buffered.
+  ok = ok && out.flush();
+
+  report.files = count;
+  report.bytes = out.position();
+  report.writes = out.writes();
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
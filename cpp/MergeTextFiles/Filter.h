@@ -0,0 +1,112 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Filter.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the filtered merge, which
+// keeps only the lines of each input that contain (or
+// start with) one of a set of literals, so a merge
+// followed by a grep becomes one pass that writes only
+// what's wanted. The literals are searched for with a
+// Teddy style vector search; see Filter.cpp for more
+// information.
+//
+// ******************************************************/
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Merge.h"
+
+
+namespace mtf
+{
+  // Which lines a filtered merge keeps.
+  struct FilterOptions
+  {
+    // A line is kept if it contains any of these (none may be
+    // empty or hold a newline).
+    std::vector<std::string> literals;
+    // true to keep only lines that start with one of them.
+    bool prefix;
+    // true to put a "FILE #n" header and separator around the
+    // lines kept from each file (files with none are left out).
+    bool headers;
+  };
+
+  // Counts gathered over a filtered merge.
+  struct FilterReport
+  {
+    // The lines kept.
+    unsigned long long kept;
+    // The files with at least one line kept.
+    unsigned long matched;
+    // The inputs that couldn't be opened or weren't regular files.
+    unsigned long unreadable;
+  };
+
+
+  /* ************************************************
+  // Finds the first place any of a set of literals
+  // occurs. Each literal goes in one of 8 buckets,
+  // and the first (up to) 3 bytes of each are
+  // folded into nibble tables, so one register of
+  // text is checked against every literal with a
+  // few shuffles; only positions where some bucket
+  // survives all 3 bytes are compared in full.
+  //
+  // ************************************************/
+  class LineFilter
+  {
+    public:
+
+      // Search for options.literals, scanning with kernel.
+      LineFilter( const FilterOptions & options,
+                  TransformKernel kernel = bestKernel() );
+
+      // The offset of the first literal in text[from, len), or len.
+      std::size_t find(const char * text, std::size_t from, std::size_t len) const;
+
+      // true if the line text[0, len) is to be kept.
+      bool keeps(const char * text, std::size_t len) const;
+
+
+    private:
+
+      // Compare the literals in bucket bits with text[at, len).
+      bool verify(const char * text, std::size_t at, std::size_t len, unsigned bits) const;
+
+      // find, a byte at a time.
+      std::size_t findScalar(const char * text, std::size_t from, std::size_t len) const;
+
+      // find, 16 and 32 bytes at a time.
+      std::size_t findSsse3(const char * text, std::size_t from, std::size_t len) const;
+      std::size_t findAvx2(const char * text, std::size_t from, std::size_t len) const;
+
+      std::vector<std::string> literals;
+      bool prefix;
+      TransformKernel kernel;
+
+      // The bytes of each literal in the fingerprint (1 to 3).
+      std::size_t width;
+
+      // The literals in each bucket.
+      std::vector<std::size_t> buckets[8];
+
+      // For each fingerprint byte, the buckets whose literals
+      // allow each low and high nibble there.
+      unsigned char low[3][16], high[3][16];
+  };
+
+  // Merge the lines that pass the filter.
+  bool mergeFiltered( const InputSet & inputs, int out_fd,
+                      const BlockOptions & options,
+                      const FilterOptions & filter_options,
+                      MergeReport & report, FilterReport & filter_report );
+};
+#endif // FILTER_H
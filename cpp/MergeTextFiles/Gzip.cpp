@@ -0,0 +1,286 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Gzip.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of GzipStream, declared in
+// Gzip.h. Each block is deflated on its own, with its
+// own gzip header and trailer, so no member depends on
+// the one before it: the threads never wait on each
+// other, and a reader can start at any member. The
+// cost is a fresh dictionary every block_size bytes,
+// which at the default of 1M is a fraction of a
+// percent.
+//
+// ******************************************************/
+
+#include "Gzip.h"
+#include "FileCopy.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <zlib.h>
+
+
+// A block is cut mid section once it is this many times block_size.
+static const std::size_t FORCED_CUT = 4;
+
+// The largest block_size, so a block fits zlib's 32 bit counts.
+static const std::size_t MAX_BLOCK = 1 << 28;
+
+
+
+/* *************************************************
+// Starts the compressing threads.
+//
+// @param out_fd: Where the members go.
+//
+// @param options: The level, threads and block
+// size.
+//
+// *************************************************/
+mtf::GzipStream::GzipStream(int out_fd, const GzipOptions & options)
+  : out_fd(out_fd), options(options), current(new Block()), added(0),
+    stopping(false), compressed(0), write_count(0)
+{
+  unsigned cpus = std::thread::hardware_concurrency(),
+           threads = options.threads ? options.threads : cpus;
+
+  // Compression is bound by the CPUs, so more threads would only wait.
+  if(cpus && threads > cpus) threads = cpus;
+
+  this->options.threads = threads ? threads : 1;
+
+  if(this->options.block_size == 0) this->options.block_size = GZIP_OFF.block_size;
+  if(this->options.block_size > MAX_BLOCK) this->options.block_size = MAX_BLOCK;
+
+  current->start = 0;
+
+  for(unsigned index = 0; index < this->options.threads; ++index)
+    workers.push_back(std::thread(&GzipStream::work, this));
+}
+
+
+
+mtf::GzipStream::~GzipStream(void)
+{
+  {
+    std::lock_guard<std::mutex> hold(lock);
+    stopping = true;
+  }
+
+  changed.notify_all();
+
+  for(std::thread & worker : workers) worker.join();
+}
+
+
+
+/* *************************************************
+// Adds bytes to the current block, cutting it
+// wherever it reaches the forced size, so a huge
+// section is still spread over the threads.
+//
+// @return: true if every member so far was written.
+//
+// *************************************************/
+bool mtf::GzipStream::add(const char * data, std::size_t len)
+{
+  const std::size_t limit = FORCED_CUT * options.block_size;
+
+  while(len > 0)
+  {
+    std::size_t part = std::min(len, limit - current->input.size());
+
+    current->input.append(data, part);
+    added += part;
+    data += part;
+    len -= part;
+
+    if(current->input.size() == limit && !cut()) return false;
+  }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Called where a section starts: the block is cut
+// here if it has reached block_size, so members
+// begin with a section header whenever they can.
+//
+// @return: true if every member so far was written.
+//
+// *************************************************/
+bool mtf::GzipStream::boundary(void)
+{
+  if(current->input.size() < options.block_size) return true;
+
+  return cut();
+}
+
+
+
+/* *************************************************
+// Cuts the last block and writes every member.
+//
+// @return: true if every member was written.
+//
+// *************************************************/
+bool mtf::GzipStream::finish(void)
+{
+  // An empty merge still gets one (empty) member.
+  if((!current->input.empty() || (written.empty() && pending.empty())) && !cut())
+    return false;
+
+  return settle(0);
+}
+
+
+
+/* *************************************************
+// Queues the current block for compression and
+// starts a new one, then writes out whatever has
+// finished, waiting if too many blocks are in
+// flight.
+//
+// *************************************************/
+bool mtf::GzipStream::cut(void)
+{
+  Block * block = current.get();
+
+  block->done = block->ok = false;
+
+  {
+    std::lock_guard<std::mutex> hold(lock);
+
+    pending.push_back(std::move(current));
+    jobs.push_back(block);
+  }
+
+  changed.notify_all();
+
+  current.reset(new Block());
+  current->start = added;
+
+  return settle(2 * options.threads);
+}
+
+
+
+/* *************************************************
+// Writes finished members from the front of the
+// queue, in order.
+//
+// @param limit: Wait until no more than this many
+// blocks are still queued.
+//
+// @return: true if every member so far compressed
+// and was written.
+//
+// *************************************************/
+bool mtf::GzipStream::settle(std::size_t limit)
+{
+  for(;;)
+  {
+    std::unique_ptr<Block> block;
+
+    {
+      std::unique_lock<std::mutex> hold(lock);
+
+      if(pending.empty()) return true;
+
+      // Only wait if there are too many blocks in flight.
+      if(!pending.front()->done)
+      {
+        if(pending.size() <= limit) return true;
+
+        changed.wait(hold, [this] { return pending.front()->done; });
+      }
+
+      block = std::move(pending.front());
+      pending.pop_front();
+    }
+
+    if(!block->ok) { errno = ENOMEM; return false; }
+
+    GzipMember member = { block->start, compressed };
+
+    ++write_count;
+    if(!writeAll(out_fd, block->output.data(), block->output.size())) return false;
+
+    written.push_back(member);
+    compressed += block->output.size();
+  }
+}
+
+
+
+/* *************************************************
+// A compressing thread: takes the oldest block no
+// one has started, deflates it outside the lock,
+// and marks it done.
+//
+// *************************************************/
+void mtf::GzipStream::work(void)
+{
+  std::unique_lock<std::mutex> hold(lock);
+
+  for(;;)
+  {
+    changed.wait(hold, [this] { return !jobs.empty() || stopping; });
+
+    if(jobs.empty()) return;
+
+    Block * block = jobs.front();
+    jobs.pop_front();
+
+    hold.unlock();
+    bool ok = compress(*block);
+    hold.lock();
+
+    block->ok = ok;
+    block->done = true;
+    changed.notify_all();
+  }
+}
+
+
+
+/* *************************************************
+// Deflates a block into a complete gzip member in
+// one call, into an output sized by deflateBound.
+// The input is released as soon as it's done with.
+//
+// @param block: Its input is compressed into its
+// output.
+//
+// @return: true if zlib succeeded.
+//
+// *************************************************/
+bool mtf::GzipStream::compress(Block & block) const
+{
+  z_stream stream = z_stream();
+
+  // A window of 15 bits, plus 16 for a gzip wrapper.
+  if(deflateInit2(&stream, options.level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+    return false;
+
+  block.output.resize(deflateBound(&stream, block.input.size()));
+
+  stream.next_in = reinterpret_cast<Bytef *>(&block.input[0]);
+  stream.avail_in = block.input.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&block.output[0]);
+  stream.avail_out = block.output.size();
+
+  bool ok = deflate(&stream, Z_FINISH) == Z_STREAM_END;
+
+  block.output.resize(stream.total_out);
+  deflateEnd(&stream);
+
+  std::string().swap(block.input);
+
+  return ok;
+}
@@ -0,0 +1,146 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Gzip.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of GzipStream, which compresses
+// a merge as it's written. The output is a series of
+// independent gzip members (which gzip -d reads as one
+// stream), cut where sections begin, and compressed by
+// a pool of threads. The index records which member
+// each section starts in, so one file can be pulled
+// out by inflating only its own members. See Gzip.cpp
+// for more information.
+//
+// ******************************************************/
+
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <cstddef>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace mtf
+{
+  // Settings for compressed output.
+  struct GzipOptions
+  {
+    // true to write gzip instead of plain text.
+    bool enabled;
+    // The zlib level, 0 (store) to 9 (smallest).
+    int level;
+    // The number of compressing threads (0 for one per CPU, and
+    // never more than one per CPU).
+    unsigned threads;
+    // Members are cut at the first section start after this many
+    // bytes, and cut regardless at four times this many.
+    std::size_t block_size;
+  };
+
+  // Plain, uncompressed output.
+  const GzipOptions GZIP_OFF = { false, 6, 0, 1 << 20 };
+
+  // Where one gzip member sits.
+  struct GzipMember
+  {
+    // The offset of its first byte in the uncompressed merge.
+    unsigned long long start;
+    // Its offset in the compressed file.
+    unsigned long long offset;
+  };
+
+
+  /* ************************************************
+  // Compresses a stream into gzip members. Bytes
+  // are gathered into a block until a section
+  // boundary comes after block_size bytes; each
+  // block is then compressed by the next free
+  // thread, and members are written in order as
+  // they finish. At most two blocks per thread are
+  // in flight, which bounds the memory used.
+  //
+  // ************************************************/
+  class GzipStream
+  {
+    public:
+
+      // Compress into out_fd, which must be at offset 0.
+      GzipStream(int out_fd, const GzipOptions & options);
+
+      // Stops the threads. Blocks not yet finished are lost.
+      ~GzipStream(void);
+
+      // Add len bytes of the merge.
+      bool add(const char * data, std::size_t len);
+
+      // Mark a section start: cut a member here if the block is full.
+      bool boundary(void);
+
+      // Compress and write everything added so far.
+      bool finish(void);
+
+      // The members written, in order.
+      const std::vector<GzipMember> & members(void) const { return written; }
+
+      // The compressed bytes written so far.
+      unsigned long long size(void) const { return compressed; }
+
+      // The write calls issued so far.
+      unsigned long writes(void) const { return write_count; }
+
+
+    private:
+
+      // One member: its text, and its compressed bytes once done.
+      struct Block
+      {
+        unsigned long long start;
+        std::string input, output;
+        bool done, ok;
+      };
+
+      GzipStream(const GzipStream &);
+      GzipStream & operator=(const GzipStream &);
+
+      // Send the current block off to be compressed.
+      bool cut(void);
+
+      // Write out finished blocks, waiting until at most limit are left.
+      bool settle(std::size_t limit);
+
+      // A compressing thread.
+      void work(void);
+
+      // Compress block into a gzip member.
+      bool compress(Block & block) const;
+
+      int out_fd;
+      GzipOptions options;
+
+      // The block being gathered, and the uncompressed bytes before it.
+      std::unique_ptr<Block> current;
+      unsigned long long added;
+
+      // Blocks in output order, and those not yet picked up by a thread.
+      std::deque<std::unique_ptr<Block> > pending;
+      std::deque<Block *> jobs;
+
+      std::vector<std::thread> workers;
+      std::mutex lock;
+      std::condition_variable changed;
+      bool stopping;
+
+      std::vector<GzipMember> written;
+      unsigned long long compressed;
+      unsigned long write_count;
+  };
+};
+#endif // GZIP_H
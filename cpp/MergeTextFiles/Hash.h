@@ -0,0 +1,67 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Hash.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of Hash64, a streaming 64 bit
+// content hash (XXH64). It is fed the bytes of a file
+// as they are copied, so fingerprinting a file costs
+// no extra pass over its data. See Hash.cpp for more
+// information.
+//
+// ******************************************************/
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace mtf
+{
+  /* ************************************************
+  // Streaming XXH64. Feed it any number of blocks
+  // with update, then read the hash with digest.
+  // The result matches the reference XXH64 of all
+  // the bytes fed in, however they were split up.
+  //
+  // ************************************************/
+  class Hash64
+  {
+    public:
+
+      // Start a new hash.
+      Hash64(std::uint64_t seed = 0);
+
+      // Forget everything and start again.
+      void reset(std::uint64_t seed = 0);
+
+      // Feed len more bytes into the hash.
+      void update(const void * data, std::size_t len);
+
+      // The hash of everything fed in so far.
+      std::uint64_t digest(void) const;
+
+
+    private:
+
+      // The four lanes of the hash.
+      std::uint64_t lanes[4];
+
+      // Bytes waiting for a full 32 byte stripe.
+      unsigned char pending[32];
+      std::size_t pending_len;
+
+      // The total number of bytes fed in.
+      std::uint64_t total_len;
+
+      // The seed the hash started with.
+      std::uint64_t seed;
+  };
+
+  // Hash everything left in fd.
+  bool hashFile(int fd, std::uint64_t & hash);
+};
+#endif // HASH_H
@@ -0,0 +1,419 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Incremental.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for incremental merging,
+// declared in Incremental.h. A file counts as
+// unchanged if it has the same name and size as last
+// time and either the same mtime or, failing that,
+// the same content hash - so touching a file costs a
+// read of it, but not a rewrite of the output. Bodies
+// are hashed while they are copied, through
+// Writer::copyFrom, so a full merge reads every file
+// just once.
+//
+// ******************************************************/
+
+#include "Incremental.h"
+#include "Writer.h"
+#include "Hash.h"
+
+#include <fstream>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// The first word of every manifest.
+static const char MANIFEST_MAGIC[] = "MTFMANIFEST";
+
+// The version of the manifest layout.
+static const unsigned MANIFEST_VERSION = 1;
+
+
+// Check a kept file against what the manifest remembers.
+static bool unchanged( const mtf::InputSet & inputs, unsigned long index,
+                       mtf::ManifestEntry & entry,
+                       mtf::IncrementalReport & incremental );
+
+
+// Seconds elapsed since start.
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+
+/* *************************************************
+// Works out the manifest path for a merged output
+// - AllFiles.txt gets AllFiles.manifest.
+//
+// @param outname: The name of the merged output.
+//
+// @return: The name of its manifest.
+//
+// *************************************************/
+std::string mtf::manifestPathFor(const char * outname)
+{
+  return siblingPath(outname, ".manifest");
+}
+
+
+
+/* *************************************************
+// Reads a manifest. Anything that doesn't parse,
+// or sections that aren't in order inside the
+// output, make the whole manifest unusable.
+//
+// @param path: The manifest to read.
+//
+// @param manifest: Filled with its contents.
+//
+// @return: true if the manifest could be used.
+//
+// *************************************************/
+bool mtf::loadManifest(const char * path, Manifest & manifest)
+{
+  std::ifstream in(path);
+  std::string line;
+  char magic[16] = "";
+  unsigned version = 0;
+  unsigned long long files = 0;
+
+  manifest.entries.clear();
+
+  // Check the first line.
+  if(!std::getline(in, line)
+     || std::sscanf(line.c_str(), "%15s %u %llu %llu", magic, &version,
+                    &files, &manifest.total) != 4
+     || std::strcmp(magic, MANIFEST_MAGIC) != 0
+     || version != MANIFEST_VERSION)
+    return false;
+
+  unsigned long long next_section = 0;
+
+  while(manifest.entries.size() < files && std::getline(in, line))
+  {
+    ManifestEntry entry;
+    char body_offset[24] = "";
+    unsigned long long hash = 0;
+    int name_start = -1;
+
+    if(std::sscanf( line.c_str(), "%llu %23s %llu %lld.%lld %llx %n",
+                    &entry.section, body_offset, &entry.body.length,
+                    &entry.mtime_sec, &entry.mtime_nsec, &hash,
+                    &name_start ) < 6 || name_start < 0)
+      return false;
+
+    entry.hash = hash;
+    entry.name = line.substr(name_start);
+    entry.body.offset = std::strcmp(body_offset, "-") == 0
+                      ? NO_BODY : std::strtoull(body_offset, NULL, 10);
+
+    // Sections must follow one another through the output.
+    if(entry.section < next_section || entry.section > manifest.total)
+      return false;
+
+    next_section = entry.section;
+    manifest.entries.push_back(entry);
+  }
+
+  return manifest.entries.size() == files;
+}
+
+
+
+/* *************************************************
+// Writes a manifest. It goes to a temporary file
+// that is renamed over the old one, so a crash
+// never leaves half a manifest behind.
+//
+// @param path: Where the manifest goes.
+//
+// @param manifest: What to write.
+//
+// @return: true if the manifest was written.
+//
+// *************************************************/
+bool mtf::saveManifest(const char * path, const Manifest & manifest)
+{
+  std::string temp_path = std::string(path) + ".tmp";
+  int fd = ::open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if(fd < 0) return false;
+
+  Writer out(fd, 1 << 16);
+  char line[64];
+
+  int len = std::snprintf( line, sizeof(line), "%s %u %lu %llu\n",
+                           MANIFEST_MAGIC, MANIFEST_VERSION,
+                           static_cast<unsigned long>(manifest.entries.size()),
+                           manifest.total );
+
+  bool ok = out.append(line, len);
+
+  for(std::size_t index = 0; ok && index < manifest.entries.size(); ++index)
+  {
+    const ManifestEntry & entry = manifest.entries[index];
+    std::string body_offset = entry.body.offset == NO_BODY
+                            ? "-" : std::to_string(entry.body.offset);
+
+    std::string fields = std::to_string(entry.section) + " " + body_offset + " "
+                       + std::to_string(entry.body.length) + " ";
+
+    len = std::snprintf( line, sizeof(line), "%lld.%09lld %016llx ",
+                         entry.mtime_sec, entry.mtime_nsec,
+                         static_cast<unsigned long long>(entry.hash) );
+
+    ok = out.append(fields.data(), fields.size())
+      && out.append(line, len)
+      && out.append(entry.name.data(), entry.name.size())
+      && out.append("\n", 1);
+  }
+
+  ok = out.flush() && ok;
+  ok = (::close(fd) == 0) && ok;
+
+  // Swap the new manifest in, or throw it away.
+  if(ok) ok = std::rename(temp_path.c_str(), path) == 0;
+  else std::remove(temp_path.c_str());
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Brings the merge in out_fd up to date with
+// inputs. The sections of every file before the
+// first one that was added, removed or changed are
+// kept as they are; the output is truncated at the
+// first changed section and everything from there
+// on is merged again with the block copy. Without
+// a usable manifest - or if the output isn't the
+// size the manifest says - the whole output is
+// rebuilt. The manifest is removed while the
+// output is being changed, so an interrupted run
+// just rebuilds next time.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output, a regular file opened
+// without truncating it.
+//
+// @param chunk_size: The size of the copy buffer.
+//
+// @param prefetch: The number of inputs to open
+// and read ahead of the copy (see Prefetcher).
+//
+// @param manifest_path: Where the manifest lives.
+//
+// @param report: Filled with totals for the bytes
+// written by this run, and with every section.
+//
+// @param incremental: Filled with what was reused.
+//
+// @return: true if the output and manifest were
+// both brought up to date.
+//
+// *************************************************/
+bool mtf::mergeIncremental( const InputSet & inputs, int out_fd,
+                            std::size_t chunk_size, unsigned prefetch,
+                            const char * manifest_path,
+                            MergeReport & report,
+                            IncrementalReport & incremental )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+
+  Manifest manifest = {};
+  struct stat out_info;
+
+  if(::fstat(out_fd, &out_info) != 0) return false;
+
+  // The manifest only describes the output if nothing else touched it.
+  bool usable = loadManifest(manifest_path, manifest)
+             && static_cast<unsigned long long>(out_info.st_size) == manifest.total;
+
+  if(!usable)
+  {
+    manifest.entries.clear();
+    manifest.total = 0;
+  }
+
+  incremental.rebuilt = !usable;
+  incremental.rehashed = 0;
+
+  // Keep every section up to the first file that changed.
+  std::size_t keep = 0;
+
+  while( keep < manifest.entries.size() && keep < count
+         && unchanged(inputs, keep, manifest.entries[keep], incremental) )
+    ++keep;
+
+  unsigned long long kept_bytes = keep < manifest.entries.size()
+                                ? manifest.entries[keep].section : manifest.total;
+
+  incremental.kept = keep;
+  incremental.kept_bytes = kept_bytes;
+
+  // From here the old manifest no longer describes the output.
+  if(::unlink(manifest_path) != 0 && errno != ENOENT) return false;
+
+  if( ::ftruncate(out_fd, kept_bytes) != 0
+      || ::lseek(out_fd, kept_bytes, SEEK_SET) < 0 )
+    return false;
+
+  manifest.entries.resize(count);
+
+  Writer out(out_fd, chunk_size, kept_bytes, WRITE_BACKGROUND);
+  Prefetcher ahead(inputs, keep, prefetch);
+  bool ok = true;
+
+  report.latency = LatencyHistogram();
+
+  LatencyHistogram * latency = fileHistogram(report);
+
+  for(unsigned long index = keep; ok && index < count; ++index)
+  {
+    FileTimer timer(latency);
+
+    ManifestEntry & entry = manifest.entries[index];
+
+    entry.name = inputs.name(index);
+    entry.section = out.position();
+    entry.body.offset = NO_BODY;
+    entry.body.length = 0;
+    entry.mtime_sec = entry.mtime_nsec = 0;
+    entry.hash = 0;
+
+    // Write the section number.
+    std::string header = sectionHeader(index + 1);
+    ok = out.append(header.data(), header.size());
+
+    // Open next input file; only regular files have a body.
+    struct stat info;
+    int in_fd = ahead.take();
+
+    if(in_fd >= 0 && (::fstat(in_fd, &info) != 0 || !S_ISREG(info.st_mode)))
+    {
+      ::close(in_fd);
+      in_fd = -1;
+    }
+
+    // If the file can be read, copy and hash its body.
+    if(ok && in_fd >= 0)
+    {
+      Hash64 hash;
+
+      // The mtime is taken before the copy, so a write during it is seen next time.
+      entry.mtime_sec = info.st_mtim.tv_sec;
+      entry.mtime_nsec = info.st_mtim.tv_nsec;
+
+      entry.body.offset = out.position();
+      ok = ok && out.copyFrom(in_fd, &hash);
+      entry.body.length = out.position() - entry.body.offset;
+      entry.hash = hash.digest();
+
+      ok = ok && out.append(BODY_TERMINATOR, sizeof(BODY_TERMINATOR) - 1);
+    }
+
+    // Close the input file.
+    if(in_fd >= 0) ::close(in_fd);
+
+    // Write some whitespace to the file between chapters.
+    ok = ok && out.append(SECTION_SEPARATOR, sizeof(SECTION_SEPARATOR) - 1);
+
+    timer.done();
+    stepProgress(index + 1, out.position() - kept_bytes);
+  }
+
+  // Write out whatever is still buffered.
+  ok = ok && out.flush();
+
+  manifest.total = out.position();
+
+  // The index covers every section, old and new.
+  report.sections.resize(count);
+
+  for(unsigned long index = 0; index < count; ++index)
+    report.sections[index] = manifest.entries[index].body;
+
+  report.files = count - keep;
+  report.bytes = manifest.total - kept_bytes;
+  report.writes = out.writes();
+  report.seconds = secondsSince(start);
+
+  // Only a complete merge gets a manifest.
+  return ok && saveManifest(manifest_path, manifest);
+}
+
+
+
+/* *************************************************
+// Decides whether a file whose section is already
+// in the output can keep it. Same name and size
+// are required; then a matching mtime is trusted,
+// and otherwise the file is hashed and compared.
+// When only the mtime moved, the entry is updated
+// so the next run won't hash the file again.
+//
+// @param inputs: The files being merged.
+//
+// @param index: The (0 based) input to check.
+//
+// @param entry: What the manifest remembers.
+//
+// @param incremental: Counts the files rehashed.
+//
+// @return: true if the old section is still right.
+//
+// *************************************************/
+static bool unchanged( const mtf::InputSet & inputs, unsigned long index,
+                       mtf::ManifestEntry & entry,
+                       mtf::IncrementalReport & incremental )
+{
+  if(entry.name != inputs.name(index)) return false;
+
+  struct stat info;
+
+  // A file that had no body last time must still have none.
+  if(!inputs.stat(index, info) || !S_ISREG(info.st_mode))
+    return entry.body.offset == mtf::NO_BODY;
+
+  if( entry.body.offset == mtf::NO_BODY
+      || static_cast<unsigned long long>(info.st_size) != entry.body.length )
+    return false;
+
+  if( info.st_mtim.tv_sec == entry.mtime_sec
+      && info.st_mtim.tv_nsec == entry.mtime_nsec )
+    return true;
+
+  // The file was touched; see if its contents really changed.
+  int fd = inputs.open(index);
+
+  if(fd < 0) return false;
+
+  std::uint64_t hash = 0;
+  bool same = mtf::hashFile(fd, hash) && hash == entry.hash;
+
+  ::close(fd);
+  ++incremental.rehashed;
+
+  if(same)
+  {
+    entry.mtime_sec = info.st_mtim.tv_sec;
+    entry.mtime_nsec = info.st_mtim.tv_nsec;
+  }
+
+  return same;
+}
@@ -0,0 +1,96 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Incremental.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for incremental merging. A
+// manifest written beside the output (AllFiles.manifest
+// beside AllFiles.txt) remembers the size, mtime and
+// content hash of every file merged, and where its
+// section starts. The next run keeps every section up
+// to the first file that changed, truncates the output
+// there and merges only the rest.
+//
+// The manifest is plain text. The first line is
+//
+//   MTFMANIFEST 1 <files> <output size>
+//
+// and each file has a line of
+//
+//   <section> <body offset> <body length> <mtime> <hash> <name>
+//
+// where the body offset is "-" for a file that could
+// not be read, the mtime is seconds.nanoseconds and
+// the hash is the XXH64 of the body in hex. See
+// Incremental.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include "Merge.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+
+namespace mtf
+{
+  // What the manifest remembers about one merged file.
+  struct ManifestEntry
+  {
+    // The name the file was merged from.
+    std::string name;
+    // Offset of the file's section header in the output.
+    unsigned long long section;
+    // Where its body went (offset NO_BODY if it had none).
+    IndexEntry body;
+    // The file's mtime when it was merged.
+    long long mtime_sec, mtime_nsec;
+    // XXH64 of the body.
+    std::uint64_t hash;
+  };
+
+  // Everything needed to pick up a merge where it left off.
+  struct Manifest
+  {
+    // The size of the output the manifest describes.
+    unsigned long long total;
+    // One entry per merged file, in file order.
+    std::vector<ManifestEntry> entries;
+  };
+
+  // Counts gathered over an incremental merge.
+  struct IncrementalReport
+  {
+    // The number of sections kept from the last merge.
+    unsigned long kept;
+    // The number of bytes of output kept.
+    unsigned long long kept_bytes;
+    // The number of kept files whose mtime changed, so
+    // their contents had to be hashed again.
+    unsigned long rehashed;
+    // true if there was no usable manifest.
+    bool rebuilt;
+  };
+
+  // The manifest that goes with a merged output name.
+  std::string manifestPathFor(const char * outname);
+
+  // Read a manifest (false if it's missing or damaged).
+  bool loadManifest(const char * path, Manifest & manifest);
+
+  // Write a manifest, replacing any old one in one step.
+  bool saveManifest(const char * path, const Manifest & manifest);
+
+  // Bring out_fd up to date with inputs, reusing the old merge.
+  bool mergeIncremental( const InputSet & inputs, int out_fd,
+                         std::size_t chunk_size, unsigned prefetch,
+                         const char * manifest_path,
+                         MergeReport & report,
+                         IncrementalReport & incremental );
+};
+#endif // INCREMENTAL_H
@@ -0,0 +1,446 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Index.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for the section index and
+// SectionReader, declared in Index.h. Lookups read a
+// single entry out of the mapped index. Bodies are
+// then fetched with one pread, or, for large bodies,
+// by mapping just that range of the merged file and
+// writing it straight from the mapping. Compressed
+// bodies are inflated from the start of their gzip
+// member, carrying on into the following members for
+// a body that spans several.
+//
+// ******************************************************/
+
+#include "Index.h"
+#include "FileCopy.h"
+#include "Writer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <zlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// The magic bytes at the start of every index.
+static const char INDEX_MAGIC[6] = { 'M', 'T', 'F', 'I', 'D', 'X' };
+
+// The versions of the index layout, plain and gzip.
+static const unsigned short INDEX_VERSION = 1, GZIP_INDEX_VERSION = 2;
+
+// The sizes of the index header and of each entry (in each version).
+static const std::size_t HEADER_SIZE = 16, ENTRY_SIZE = 16, GZIP_ENTRY_SIZE = 32;
+
+// Compressed bytes read at a time when inflating a body.
+static const std::size_t INFLATE_CHUNK = 1 << 16;
+
+// Bodies at least this large are extracted through mmap.
+static const unsigned long long MMAP_MIN = 1 << 20;
+
+
+// Store value as little endian bytes.
+static void putLittle(unsigned char * bytes, unsigned long long value, int size)
+{
+  for(int byte = 0; byte < size; ++byte, value >>= 8)
+    bytes[byte] = value & 0xff;
+}
+
+
+// Load little endian bytes.
+static unsigned long long getLittle(const unsigned char * bytes, int size)
+{
+  unsigned long long value = 0;
+
+  for(int byte = size - 1; byte >= 0; --byte)
+    value = (value << 8) | bytes[byte];
+
+  return value;
+}
+
+
+
+/* *************************************************
+// Works out the index path for a merged output by
+// swapping the output's extension for ".idx" - so
+// AllFiles.txt gets AllFiles.idx.
+//
+// @param outname: The name of the merged output.
+//
+// @return: The name of its index.
+//
+// *************************************************/
+std::string mtf::indexPathFor(const char * outname)
+{
+  return siblingPath(outname, ".idx");
+}
+
+
+
+/* *************************************************
+// Writes the index for a merge.
+//
+// @param path: Where to write the index.
+//
+// @param sections: One entry per merged file.
+//
+// @param members: The gzip members of a compressed
+// merge, in order, or empty for plain text.
+//
+// @return: true if the whole index was written.
+//
+// *************************************************/
+bool mtf::writeIndex( const char * path, const std::vector<IndexEntry> & sections,
+                      const std::vector<GzipMember> & members )
+{
+  int fd = ::open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+
+  if(fd < 0) return false;
+
+  Writer out(fd, 1 << 16);
+  unsigned char header[HEADER_SIZE], entry[GZIP_ENTRY_SIZE];
+  const bool gzip = !members.empty();
+  const std::size_t entry_size = gzip ? GZIP_ENTRY_SIZE : ENTRY_SIZE;
+
+  std::memcpy(header, INDEX_MAGIC, sizeof(INDEX_MAGIC));
+  putLittle(header + 6, gzip ? GZIP_INDEX_VERSION : INDEX_VERSION, 2);
+  putLittle(header + 8, sections.size(), 8);
+
+  bool ok = out.append(reinterpret_cast<char *>(header), HEADER_SIZE);
+
+  for(std::size_t index = 0; ok && index < sections.size(); ++index)
+  {
+    putLittle(entry, sections[index].offset, 8);
+    putLittle(entry + 8, sections[index].length, 8);
+
+    // Find the last member starting at or before the body.
+    if(gzip)
+    {
+      GzipMember member = { 0, 0 };
+
+      if(sections[index].offset != NO_BODY)
+        member = *(std::upper_bound( members.begin(), members.end(), sections[index].offset,
+                                     [](unsigned long long offset, const GzipMember & next)
+                                     { return offset < next.start; } ) - 1);
+
+      putLittle(entry + 16, member.offset, 8);
+      putLittle(entry + 24, member.start, 8);
+    }
+
+    ok = out.append(reinterpret_cast<char *>(entry), entry_size);
+  }
+
+  ok = ok && out.flush();
+
+  return (::close(fd) == 0) && ok;
+}
+
+
+
+mtf::SectionReader::SectionReader(void)
+  : merged_fd(-1), merged_size(0), index(NULL), index_len(0), entries(0), version(0)
+{ return; }
+
+
+
+mtf::SectionReader::~SectionReader(void)
+{
+  if(index) ::munmap(const_cast<unsigned char *>(index), index_len);
+  if(merged_fd >= 0) ::close(merged_fd);
+
+  return;
+}
+
+
+
+/* *************************************************
+// Opens a merged file and maps its index. Only
+// the index header is checked here; each entry is
+// checked against the merged file when it's used,
+// so opening stays cheap for huge merges.
+//
+// @param merged_path: The merged output.
+//
+// @param index_path: Its index.
+//
+// @return: true if both files are usable.
+//
+// *************************************************/
+bool mtf::SectionReader::open(const char * merged_path, const char * index_path)
+{
+  struct stat merged_info, index_info;
+
+  merged_fd = ::open(merged_path, O_RDONLY);
+  int index_fd = ::open(index_path, O_RDONLY);
+
+  bool ok = merged_fd >= 0 && index_fd >= 0
+         && ::fstat(merged_fd, &merged_info) == 0
+         && ::fstat(index_fd, &index_info) == 0
+         && index_info.st_size >= static_cast<off_t>(HEADER_SIZE);
+
+  if(ok)
+  {
+    index_len = index_info.st_size;
+
+    void * mapped = ::mmap(NULL, index_len, PROT_READ, MAP_SHARED, index_fd, 0);
+
+    if(mapped == MAP_FAILED) ok = false;
+    else index = static_cast<const unsigned char *>(mapped);
+  }
+
+  if(index_fd >= 0) ::close(index_fd);
+
+  // Check the header and that every entry is present.
+  if(ok)
+  {
+    entries = getLittle(index + 8, 8);
+    version = getLittle(index + 6, 2);
+
+    ok = std::memcmp(index, INDEX_MAGIC, sizeof(INDEX_MAGIC)) == 0
+      && (version == INDEX_VERSION || version == GZIP_INDEX_VERSION)
+      && entries <= (index_len - HEADER_SIZE)
+                    / (version == GZIP_INDEX_VERSION ? GZIP_ENTRY_SIZE : ENTRY_SIZE);
+  }
+
+  if(ok) merged_size = merged_info.st_size;
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Looks up where the body of file number k is.
+//
+// @param k: The (1 based) number of the file.
+//
+// @param entry: Filled with the body's offset and
+// length.
+//
+// @return: false if there's no file number k, or
+// the index doesn't fit the merged file.
+//
+// *************************************************/
+bool mtf::SectionReader::locate(unsigned long long k, IndexEntry & entry) const
+{
+  GzipMember member;
+
+  return locate(k, entry, member);
+}
+
+
+
+/* *************************************************
+// Looks up where the body of file number k is,
+// and for a compressed merge, the gzip member it
+// starts in (which is all zeros otherwise).
+//
+// @param k: The (1 based) number of the file.
+//
+// @param entry: Filled with the body's offset and
+// length.
+//
+// @param member: Filled with the member's offsets.
+//
+// @return: false if there's no file number k, or
+// the index doesn't fit the merged file.
+//
+// *************************************************/
+bool mtf::SectionReader::locate( unsigned long long k, IndexEntry & entry,
+                                 GzipMember & member ) const
+{
+  if(k < 1 || k > entries) return false;
+
+  const std::size_t entry_size = compressed() ? GZIP_ENTRY_SIZE : ENTRY_SIZE;
+  const unsigned char * bytes = index + HEADER_SIZE + (k - 1) * entry_size;
+
+  entry.offset = getLittle(bytes, 8);
+  entry.length = getLittle(bytes + 8, 8);
+
+  member.offset = compressed() ? getLittle(bytes + 16, 8) : 0;
+  member.start = compressed() ? getLittle(bytes + 24, 8) : 0;
+
+  if(entry.offset == NO_BODY) return true;
+
+  // A member outside the compressed file means the index is stale.
+  if(compressed())
+    return member.offset < merged_size && member.start <= entry.offset;
+
+  // So does a body outside the merged file.
+  return entry.offset <= merged_size && entry.length <= merged_size - entry.offset;
+}
+
+
+
+/* *************************************************
+// Reads the body of file number k with a single
+// pread (retried if it comes up short).
+//
+// @param k: The (1 based) number of the file.
+//
+// @param body: Replaced with the body.
+//
+// @return: false if there's no such file, it had
+// no body, or it couldn't be read.
+//
+// *************************************************/
+bool mtf::SectionReader::read(unsigned long long k, std::string & body) const
+{
+  IndexEntry entry;
+  GzipMember member;
+
+  if(!locate(k, entry, member) || entry.offset == NO_BODY) return false;
+
+  if(compressed()) return inflateBody(entry, member, body);
+
+  body.resize(entry.length);
+
+  for(unsigned long long got = 0; got < entry.length; )
+  {
+    ssize_t more = ::pread(merged_fd, &body[got], entry.length - got, entry.offset + got);
+
+    if(more < 0 && errno == EINTR) continue;
+    if(more <= 0) return false;
+
+    got += more;
+  }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Writes the body of file number k to out_fd.
+// Small bodies are read with pread. Large ones are
+// mapped (from the page holding their first byte)
+// and written straight from the page cache.
+//
+// @param k: The (1 based) number of the file.
+//
+// @param out_fd: Where to write the body.
+//
+// @return: false if there's no such file, it had
+// no body, or it couldn't be copied.
+//
+// *************************************************/
+bool mtf::SectionReader::extract(unsigned long long k, int out_fd) const
+{
+  IndexEntry entry;
+
+  if(!locate(k, entry) || entry.offset == NO_BODY) return false;
+
+  // Small and compressed bodies: read, then write.
+  if(entry.length < MMAP_MIN || compressed())
+  {
+    std::string body;
+
+    return read(k, body) && writeAll(out_fd, body.data(), body.size());
+  }
+
+  // Large bodies: map the range instead of copying it into a buffer.
+  unsigned long long page = ::sysconf(_SC_PAGESIZE),
+                     start = entry.offset & ~(page - 1),
+                     lead = entry.offset - start;
+
+  void * mapped = ::mmap(NULL, lead + entry.length, PROT_READ, MAP_SHARED, merged_fd, start);
+
+  if(mapped == MAP_FAILED) return false;
+
+  ::madvise(mapped, lead + entry.length, MADV_SEQUENTIAL);
+
+  bool ok = writeAll(out_fd, static_cast<char *>(mapped) + lead, entry.length);
+
+  ::munmap(mapped, lead + entry.length);
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Inflates a body out of a compressed merge. The
+// members from the one the body starts in are
+// read in chunks and inflated one after another;
+// the text before the body is thrown away and
+// inflating stops once the body is complete.
+//
+// @param entry: Where the body is in the
+// uncompressed text.
+//
+// @param member: The member it starts in.
+//
+// @param body: Replaced with the body.
+//
+// @return: false if the members are damaged or end
+// before the body does.
+//
+// *************************************************/
+bool mtf::SectionReader::inflateBody( const IndexEntry & entry, const GzipMember & member,
+                                      std::string & body ) const
+{
+  z_stream stream = z_stream();
+
+  // A window of 15 bits, plus 16 to expect a gzip wrapper.
+  if(inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+
+  std::unique_ptr<unsigned char[]> input(new unsigned char[INFLATE_CHUNK]),
+                                   output(new unsigned char[INFLATE_CHUNK]);
+
+  unsigned long long offset = member.offset,
+  // The bytes still to skip before the body starts.
+                     skip = entry.offset - member.start;
+  bool ok = true;
+
+  body.clear();
+  body.reserve(entry.length);
+
+  while(ok && body.size() < entry.length)
+  {
+    // Read more of the compressed file when zlib has used it all.
+    if(stream.avail_in == 0)
+    {
+      ssize_t got = ::pread(merged_fd, input.get(), INFLATE_CHUNK, offset);
+
+      if(got < 0 && errno == EINTR) continue;
+      if(got <= 0) { ok = false; break; }
+
+      offset += got;
+      stream.next_in = input.get();
+      stream.avail_in = got;
+    }
+
+    stream.next_out = output.get();
+    stream.avail_out = INFLATE_CHUNK;
+
+    int status = ::inflate(&stream, Z_NO_FLUSH);
+
+    // Running out of input is fine; anything else is damage.
+    if( status != Z_OK && status != Z_STREAM_END
+        && !(status == Z_BUF_ERROR && stream.avail_in == 0) )
+      ok = false;
+
+    // Keep what's past the skip, up to the end of the body.
+    unsigned long long made = INFLATE_CHUNK - stream.avail_out, used = std::min(made, skip);
+
+    skip -= used;
+    body.append( reinterpret_cast<char *>(output.get()) + used,
+                 std::min<unsigned long long>(made - used, entry.length - body.size()) );
+
+    // The body goes on in the next member.
+    if(ok && status == Z_STREAM_END) ok = ::inflateReset(&stream) == Z_OK;
+  }
+
+  ::inflateEnd(&stream);
+
+  return ok;
+}
@@ -0,0 +1,112 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Index.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the section index written
+// next to a merged file (AllFiles.idx beside
+// AllFiles.txt), and for SectionReader, which uses it
+// to pull a single file back out of the merge with one
+// seek instead of a scan for "FILE #n" markers.
+//
+// The index is a 16 byte header - the magic bytes
+// "MTFIDX" followed by a 16 bit version, and the 64
+// bit number of entries - and then one 16 byte entry
+// per file: the 64 bit offset of its body (NO_BODY if
+// it had none) and the 64 bit length of its body. All
+// numbers are little endian.
+//
+// A gzip merge gets a version 2 index, whose entries
+// are 32 bytes: the same two numbers (still offsets in
+// the uncompressed text), then the offset in the
+// compressed file of the gzip member the body starts
+// in, and that member's offset in the uncompressed
+// text. See Index.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef INDEX_H
+#define INDEX_H
+
+#include "Merge.h"
+
+#include <string>
+#include <vector>
+
+
+namespace mtf
+{
+  // The index that goes with a merged output name.
+  std::string indexPathFor(const char * outname);
+
+  // Write the index for a merge, and the gzip members it was written
+  // in if it was compressed.
+  bool writeIndex( const char * path, const std::vector<IndexEntry> & sections,
+                   const std::vector<GzipMember> & members = std::vector<GzipMember>() );
+
+
+  /* ************************************************
+  // Random access to the files inside a merged
+  // output. The index is mapped rather than read,
+  // so opening a reader costs the same for ten
+  // files or ten million. A compressed merge is
+  // read by inflating from the member a body
+  // starts in.
+  //
+  // ************************************************/
+  class SectionReader
+  {
+    public:
+
+      SectionReader(void);
+
+      // Unmaps the index and closes the merged file.
+      ~SectionReader(void);
+
+      // Open a merged file and its index.
+      bool open(const char * merged_path, const char * index_path);
+
+      // The number of files in the merge.
+      unsigned long long count(void) const { return entries; }
+
+      // true if the merge is gzip compressed.
+      bool compressed(void) const { return version == 2; }
+
+      // Look up where the body of file number k (1 based) is.
+      bool locate(unsigned long long k, IndexEntry & entry) const;
+
+      // As locate, also giving the gzip member the body starts in.
+      bool locate(unsigned long long k, IndexEntry & entry, GzipMember & member) const;
+
+      // Read the body of file number k into body.
+      bool read(unsigned long long k, std::string & body) const;
+
+      // Write the body of file number k to out_fd.
+      bool extract(unsigned long long k, int out_fd) const;
+
+
+    private:
+
+      // Readers own a mapping, so they can't be copied.
+      SectionReader(const SectionReader &);
+      SectionReader & operator=(const SectionReader &);
+
+      // The merged file, and its size.
+      int merged_fd;
+      unsigned long long merged_size;
+
+      // The mapped index, and its size.
+      const unsigned char * index;
+      std::size_t index_len;
+
+      // Read a body out of the gzip members, starting at member.
+      bool inflateBody( const IndexEntry & entry, const GzipMember & member,
+                        std::string & body ) const;
+
+      // The number of entries in the index, and the index version.
+      unsigned long long entries;
+      unsigned version;
+  };
+};
+#endif // INDEX_H
@@ -0,0 +1,617 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Inputs.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for InputSet and
+// Prefetcher, declared in Inputs.h. Directories are
+// read with getdents64 directly, rather than through
+// readdir, so a directory of a million files takes
+// a few dozen system calls to list.
+//
+// ******************************************************/
+
+#include "Inputs.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/syscall.h>
+
+
+// A directory entry as returned by getdents64.
+struct Dirent64
+{
+  unsigned long long d_ino;
+  long long d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+// The size of the buffer directory entries are read into.
+static const std::size_t DIRENT_BLOCK = 1 << 20;
+
+
+
+mtf::InputSet::InputSet(void)
+  : count(0), numbered(true), dir_fd(AT_FDCWD), own_dir(false), skipping(false)
+{ return; }
+
+
+
+/* *************************************************
+// Sets up the numbered inputs 1.txt..count.txt.
+// No names are stored; each is built on demand.
+//
+// @param count: The number of files.
+//
+// *************************************************/
+mtf::InputSet::InputSet(unsigned long count)
+  : count(0), numbered(true), dir_fd(AT_FDCWD), own_dir(false), skipping(false)
+{
+  setNumbered(count);
+}
+
+
+
+/* *************************************************
+// Sets up an explicit list of inputs.
+//
+// @param names: The files, in merge order.
+//
+// *************************************************/
+mtf::InputSet::InputSet(const std::vector<std::string> & names)
+  : count(0), numbered(true), dir_fd(AT_FDCWD), own_dir(false), skipping(false)
+{
+  setList(names);
+}
+
+
+
+mtf::InputSet::~InputSet(void)
+{
+  clear();
+}
+
+
+
+/* *************************************************
+// Drops the current files and closes any scanned
+// directory.
+//
+// *************************************************/
+void mtf::InputSet::clear(void)
+{
+  if(own_dir) ::close(dir_fd);
+
+  dir_fd = AT_FDCWD;
+  own_dir = false;
+  numbered = false;
+  count = 0;
+
+  names.clear();
+  starts.clear();
+
+  return;
+}
+
+
+
+/* *************************************************
+// Appends a name to a listed set.
+//
+// @param name: The name (need not end in a NUL).
+//
+// @param len: Its length.
+//
+// *************************************************/
+void mtf::InputSet::add(const char * name, std::size_t len)
+{
+  starts.push_back(names.size());
+  names.append(name, len);
+  names.push_back('\0');
+
+  ++count;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Switches to the numbered inputs 1.txt..count.txt
+// in the working directory.
+//
+// @param count: The number of files.
+//
+// *************************************************/
+void mtf::InputSet::setNumbered(unsigned long count)
+{
+  clear();
+
+  numbered = true;
+  this->count = count;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Switches to an explicit list of inputs, taken as
+// they are (relative to the working directory).
+//
+// @param names: The files, in merge order.
+//
+// *************************************************/
+void mtf::InputSet::setList(const std::vector<std::string> & names)
+{
+  clear();
+
+  for(const std::string & name : names)
+    add(name.data(), name.size());
+
+  return;
+}
+
+
+
+/* *************************************************
+// Marks a file that later scans must leave out -
+// the merge's own output, if it lives inside the
+// directory being merged.
+//
+// @param info: The file's stat.
+//
+// *************************************************/
+void mtf::InputSet::exclude(const struct stat & info)
+{
+  skipping = true;
+  skip_dev = info.st_dev;
+  skip_ino = info.st_ino;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Reads a directory with getdents64, a megabyte of
+// entries per call, and keeps every regular file
+// whose name matches pattern. Hidden files are
+// skipped. The type in each entry is trusted, so
+// only symlinks and filesystems that don't report
+// types cost a stat. The names are then put into
+// natural order, and the directory stays open so
+// the files can be opened relative to it.
+//
+// @param path: The directory.
+//
+// @param pattern: An fnmatch pattern names must
+// match, or NULL for every file.
+//
+// @return: true if the whole directory was read.
+//
+// *************************************************/
+bool mtf::InputSet::scanDirectory(const char * path, const char * pattern)
+{
+  clear();
+
+  int fd = ::open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+  if(fd < 0) return false;
+
+  dir_fd = fd;
+  own_dir = true;
+
+  struct stat dir_info;
+
+  if(::fstat(fd, &dir_info) != 0) return false;
+
+  std::unique_ptr<char[]> block(new char[DIRENT_BLOCK]);
+
+  for(;;)
+  {
+    long got = ::syscall(SYS_getdents64, fd, block.get(), DIRENT_BLOCK);
+
+    if(got < 0 && errno == EINTR) continue;
+    if(got < 0) return false;
+    if(got == 0) break;
+
+    for(long offset = 0; offset < got; )
+    {
+      const Dirent64 * entry = reinterpret_cast<const Dirent64 *>(block.get() + offset);
+      const char * name = entry->d_name;
+
+      offset += entry->d_reclen;
+
+      // Skip ".", ".." and hidden files, and anything not matching.
+      if(name[0] == '.') continue;
+      if(pattern && ::fnmatch(pattern, name, FNM_PERIOD) != 0) continue;
+
+      dev_t dev = dir_info.st_dev;
+      ino_t ino = entry->d_ino;
+
+      // Look through symlinks and unknown types.
+      if(entry->d_type == DT_LNK || entry->d_type == DT_UNKNOWN)
+      {
+        struct stat info;
+
+        if(::fstatat(fd, name, &info, 0) != 0 || !S_ISREG(info.st_mode)) continue;
+
+        dev = info.st_dev;
+        ino = info.st_ino;
+      }
+      else if(entry->d_type != DT_REG) continue;
+
+      // Never merge the output into itself.
+      if(skipping && dev == skip_dev && ino == skip_ino) continue;
+
+      add(name, std::strlen(name));
+    }
+  }
+
+  // Put the names in natural order.
+  const char * base = names.data();
+
+  std::sort( starts.begin(), starts.end(),
+             [base](std::size_t fst, std::size_t snd)
+             { return naturalLess(base + fst, base + snd); } );
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Finds the files matching a glob. Only the last
+// part of the path may hold wildcards (say, every
+// .txt file in one directory), so a glob is just
+// a single directory scan.
+//
+// @param glob: The pattern.
+//
+// @return: false (with errno EINVAL) if the
+// directory part has wildcards, or if the
+// directory can't be read.
+//
+// *************************************************/
+bool mtf::InputSet::scanGlob(const char * glob)
+{
+  std::string text(glob), directory = ".";
+  std::size_t slash = text.rfind('/');
+
+  if(slash != std::string::npos)
+  {
+    directory = slash == 0 ? "/" : text.substr(0, slash);
+    text.erase(0, slash + 1);
+  }
+
+  if(text.empty() || directory.find_first_of("*?[") != std::string::npos)
+  {
+    clear();
+    errno = EINVAL;
+    return false;
+  }
+
+  return scanDirectory(directory.c_str(), text.c_str());
+}
+
+
+
+/* *************************************************
+// Reads the names of the inputs from a file, one
+// per line, and keeps them in that order. Blank
+// lines are skipped and CRLF line ends are
+// accepted. Names are relative to the working
+// directory.
+//
+// @param path: The list file.
+//
+// @return: true if the list could be read.
+//
+// *************************************************/
+bool mtf::InputSet::readList(const char * path)
+{
+  clear();
+
+  std::ifstream list(path);
+
+  if(!list) return false;
+
+  std::string line;
+
+  while(std::getline(list, line))
+  {
+    if(!line.empty() && line[line.size() - 1] == '\r')
+      line.erase(line.size() - 1);
+
+    if(!line.empty()) add(line.data(), line.size());
+  }
+
+  return list.eof();
+}
+
+
+
+/* *************************************************
+// Gives the name of an input, either straight out
+// of the packed names or built in scratch.
+//
+// *************************************************/
+const char * mtf::InputSet::path(unsigned long index, std::string & scratch) const
+{
+  if(!numbered) return names.data() + starts[index];
+
+  scratch = std::to_string(index + 1) + ".txt";
+
+  return scratch.c_str();
+}
+
+
+
+/* *************************************************
+// Gives the name of an input. Numbered names fit
+// in a std::string's own storage, so this doesn't
+// allocate for them.
+//
+// @param index: The (0 based) input.
+//
+// @return: Its name.
+//
+// *************************************************/
+std::string mtf::InputSet::name(unsigned long index) const
+{
+  std::string scratch;
+
+  return path(index, scratch);
+}
+
+
+
+/* *************************************************
+// Opens an input for reading.
+//
+// @param index: The (0 based) input.
+//
+// @return: The descriptor, or -1 with errno set.
+//
+// *************************************************/
+int mtf::InputSet::open(unsigned long index) const
+{
+  std::string scratch;
+  const char * name = path(index, scratch);
+  CallTimer timer(CALL_OPEN);
+
+  return ::openat(dir_fd, name, O_RDONLY);
+}
+
+
+
+/* *************************************************
+// Gets the status of an input.
+//
+// @param index: The (0 based) input.
+//
+// @param info: Filled in by stat.
+//
+// @return: true if stat succeeded.
+//
+// *************************************************/
+bool mtf::InputSet::stat(unsigned long index, struct stat & info) const
+{
+  std::string scratch;
+
+  return ::fstatat(dir_fd, path(index, scratch), &info, 0) == 0;
+}
+
+
+
+/* *************************************************
+// Checks whether an input may be read.
+//
+// @param index: The (0 based) input.
+//
+// *************************************************/
+bool mtf::InputSet::readable(unsigned long index) const
+{
+  std::string scratch;
+
+  return ::faccessat(dir_fd, path(index, scratch), R_OK, 0) == 0;
+}
+
+
+
+/* *************************************************
+// Compares two names in natural order. Runs of
+// digits are compared as numbers (ignoring leading
+// zeros), everything else byte by byte. Names that
+// are equal that way, such as "a01" and "a1", fall
+// back to plain byte order so the sort is total.
+//
+// @param fst: The first name.
+//
+// @param snd: The second name.
+//
+// @return: true if fst sorts before snd.
+//
+// *************************************************/
+bool mtf::naturalLess(const char * fst, const char * snd)
+{
+  const char * a = fst, * b = snd;
+
+  while(*a && *b)
+  {
+    bool a_digit = std::isdigit(static_cast<unsigned char>(*a)),
+         b_digit = std::isdigit(static_cast<unsigned char>(*b));
+
+    if(a_digit && b_digit)
+    {
+      // Skip leading zeros, then the longer number is the larger.
+      while(*a == '0') ++a;
+      while(*b == '0') ++b;
+
+      const char * a_end = a, * b_end = b;
+
+      while(std::isdigit(static_cast<unsigned char>(*a_end))) ++a_end;
+      while(std::isdigit(static_cast<unsigned char>(*b_end))) ++b_end;
+
+      if(a_end - a != b_end - b) return a_end - a < b_end - b;
+
+      // Same length: the first differing digit decides.
+      for(; a < a_end; ++a, ++b)
+        if(*a != *b) return *a < *b;
+
+      b = b_end;
+      continue;
+    }
+
+    if(*a != *b)
+      return static_cast<unsigned char>(*a) < static_cast<unsigned char>(*b);
+
+    ++a;
+    ++b;
+  }
+
+  if(*a || *b) return *b != '\0';
+
+  return std::strcmp(fst, snd) < 0;
+}
+
+
+
+/* *************************************************
+// Starts prefetching. With a depth of zero there
+// is no thread, and take just opens each file.
+//
+// @param inputs: The files of the merge.
+//
+// @param first: The first input that will be taken.
+//
+// @param depth: How many inputs to keep open ahead.
+//
+// *************************************************/
+mtf::Prefetcher::Prefetcher(const InputSet & inputs, unsigned long first, unsigned depth)
+  : inputs(inputs), next_taken(first), next_opened(first),
+    depth(depth), stopping(false)
+{
+  if(depth > 0 && first < inputs.size())
+    worker = std::thread(&Prefetcher::run, this);
+
+  return;
+}
+
+
+
+/* *************************************************
+// Stops the thread and closes any inputs it
+// opened that were never taken.
+//
+// *************************************************/
+mtf::Prefetcher::~Prefetcher(void)
+{
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    stopping = true;
+  }
+
+  changed.notify_all();
+
+  if(worker.joinable()) worker.join();
+
+  for(int fd : ready)
+    if(fd >= 0) ::close(fd);
+
+  return;
+}
+
+
+
+/* *************************************************
+// Hands over the next input, waiting for the
+// thread to open it if it hasn't yet.
+//
+// @return: The open descriptor, or -1 if the
+// input couldn't be opened.
+//
+// *************************************************/
+int mtf::Prefetcher::take(void)
+{
+  // Without a thread, just open the file.
+  if(!worker.joinable()) return openAhead(next_taken++);
+
+  std::unique_lock<std::mutex> guard(lock);
+
+  changed.wait(guard, [this]() { return !ready.empty(); });
+
+  int fd = ready.front();
+  ready.pop_front();
+  ++next_taken;
+
+  // There's room for the thread to open another.
+  changed.notify_all();
+
+  return fd;
+}
+
+
+
+/* *************************************************
+// Opens an input and asks the kernel to start
+// reading all of it in the background.
+//
+// @param index: The (0 based) input.
+//
+// @return: The descriptor, or -1.
+//
+// *************************************************/
+int mtf::Prefetcher::openAhead(unsigned long index)
+{
+  int fd = inputs.open(index);
+
+  if(fd >= 0) ::posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+
+  return fd;
+}
+
+
+
+/* *************************************************
+// The prefetch thread: opens inputs in order,
+// never holding more than depth untaken.
+//
+// *************************************************/
+void mtf::Prefetcher::run(void)
+{
+  std::unique_lock<std::mutex> guard(lock);
+
+  while(next_opened < inputs.size())
+  {
+    changed.wait(guard, [this]() { return stopping || ready.size() < depth; });
+
+    if(stopping) return;
+
+    unsigned long index = next_opened++;
+
+    // Don't hold the lock across the (possibly slow) open.
+    guard.unlock();
+    int fd = openAhead(index);
+    guard.lock();
+
+    ready.push_back(fd);
+    changed.notify_all();
+  }
+
+  return;
+}
@@ -0,0 +1,203 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Inputs.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for InputSet, the list of
+// files a merge reads, and Prefetcher, which opens
+// them ahead of the copy. A numbered set (1.txt up to
+// N.txt) makes each name when it's asked for, so it
+// costs the same memory for ten files or ten million.
+// A set can also be read from a directory (in one
+// getdents64 pass), a glob or a list file. See
+// Inputs.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef INPUTS_H
+#define INPUTS_H
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include <sys/stat.h>
+
+
+namespace mtf
+{
+  // The number of inputs opened ahead of the copy by default.
+  const unsigned DEFAULT_PREFETCH = 8;
+
+
+  /* ************************************************
+  // The files to be merged, in merge order. Input
+  // index (0 based) becomes section number
+  // index + 1 in the output. A set is either
+  // numbered (1.txt..N.txt, names made on demand),
+  // an explicit list, or the files of a directory.
+  // Listed and scanned names are packed end to end
+  // in one buffer, and scanned files are opened
+  // relative to their directory's descriptor, so
+  // the directory's path is resolved only once.
+  //
+  // ************************************************/
+  class InputSet
+  {
+    public:
+
+      // An empty set.
+      InputSet(void);
+
+      // The files 1.txt..count.txt in the working directory.
+      explicit InputSet(unsigned long count);
+
+      // Exactly the files in names, in that order.
+      explicit InputSet(const std::vector<std::string> & names);
+
+      // Closes the scanned directory.
+      ~InputSet(void);
+
+      // Use the files 1.txt..count.txt in the working directory.
+      void setNumbered(unsigned long count);
+
+      // Use exactly the files in names, in that order.
+      void setList(const std::vector<std::string> & names);
+
+      // Use the regular files in a directory (matching pattern,
+      // if given) in natural order.
+      bool scanDirectory(const char * path, const char * pattern = NULL);
+
+      // Use the files matching a glob such as exports/*.txt.
+      bool scanGlob(const char * glob);
+
+      // Use the files named one per line in a list file.
+      bool readList(const char * path);
+
+      // Leave this file out of later scans (the merge's own output).
+      void exclude(const struct stat & info);
+
+      // The number of files.
+      unsigned long size(void) const { return count; }
+
+      // The directory names are relative to (AT_FDCWD for the
+      // working directory).
+      int directory(void) const { return dir_fd; }
+
+      // The name of input index.
+      std::string name(unsigned long index) const;
+
+      // Open input index for reading (-1 and errno on failure).
+      int open(unsigned long index) const;
+
+      // stat input index.
+      bool stat(unsigned long index, struct stat & info) const;
+
+      // true if input index may be read.
+      bool readable(unsigned long index) const;
+
+
+    private:
+
+      // Sets own a directory descriptor, so they can't be copied.
+      InputSet(const InputSet &);
+      InputSet & operator=(const InputSet &);
+
+      // Forget the current files.
+      void clear(void);
+
+      // Add a name to the end of a listed set.
+      void add(const char * name, std::size_t len);
+
+      // The name of input index, built in scratch if need be.
+      const char * path(unsigned long index, std::string & scratch) const;
+
+      // The number of files.
+      unsigned long count;
+
+      // true for 1.txt..count.txt.
+      bool numbered;
+
+      // The directory names are relative to, and whether we opened it.
+      int dir_fd;
+      bool own_dir;
+
+      // Every listed name, each followed by a NUL..
+      std::string names;
+      // and where each one starts.
+      std::vector<std::size_t> starts;
+
+      // A file scans must skip.
+      bool skipping;
+      dev_t skip_dev;
+      ino_t skip_ino;
+  };
+
+  // Natural order: runs of digits compare as numbers, so
+  // "part9" sorts before "part10".
+  bool naturalLess(const char * fst, const char * snd);
+
+
+  /* ************************************************
+  // Opens the inputs of a merge, in order, on a
+  // background thread that stays up to depth files
+  // ahead of the copy, and asks the kernel to start
+  // reading each one (posix_fadvise WILLNEED) as
+  // soon as it's open. Slow opens and cold reads
+  // then overlap the copy of the files before them.
+  // At most depth + 1 inputs are open at once.
+  //
+  // ************************************************/
+  class Prefetcher
+  {
+    public:
+
+      // Prefetch inputs from first on, up to depth files ahead.
+      Prefetcher(const InputSet & inputs, unsigned long first, unsigned depth);
+
+      // Stops the prefetch and closes anything not taken.
+      ~Prefetcher(void);
+
+      // The descriptor for the next input (-1 if it couldn't be
+      // opened). The caller closes it.
+      int take(void);
+
+
+    private:
+
+      // Prefetchers own a thread, so they can't be copied.
+      Prefetcher(const Prefetcher &);
+      Prefetcher & operator=(const Prefetcher &);
+
+      // Open and advise one input.
+      int openAhead(unsigned long index);
+
+      // The body of the prefetch thread.
+      void run(void);
+
+      const InputSet & inputs;
+
+      // The next input take will return.
+      unsigned long next_taken;
+      // The next input the thread will open.
+      unsigned long next_opened;
+
+      // The number of inputs kept open ahead of take.
+      unsigned depth;
+
+      // Descriptors opened and not yet taken, in order.
+      std::deque<int> ready;
+
+      // Set to stop the thread early.
+      bool stopping;
+
+      std::mutex lock;
+      std::condition_variable changed;
+      std::thread worker;
+  };
+};
+#endif // INPUTS_H
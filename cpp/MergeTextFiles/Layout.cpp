@@ -0,0 +1,62 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Layout.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of planLayout, declared in
+// Layout.h. A section is the header, the body, the
+// body terminator and the separator, in that order,
+// so its length follows directly from the size of the
+// input file.
+//
+// ******************************************************/
+
+#include "Layout.h"
+#include "Merge.h"
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+/* *************************************************
+// Stats every input file and records where its
+// section will be written. Files that can't be read
+// get a header and separator only, just as the
+// serial merge writes them.
+//
+// @param inputs: The files to merge.
+//
+// @param sections: Filled with one Section per file.
+//
+// @return: The total size of the merged output.
+//
+// *************************************************/
+unsigned long long mtf::planLayout( const InputSet & inputs,
+                                    std::vector<Section> & sections )
+{
+  unsigned long long offset = 0;
+
+  sections.assign(inputs.size(), Section());
+
+  for(unsigned long index = 0; index < inputs.size(); ++index)
+  {
+    Section & section = sections[index];
+    struct stat info;
+
+    section.header_offset = offset;
+    section.body_offset = offset + sectionHeader(index + 1).size();
+
+    // A file is only copied if it's a regular file we're allowed to read.
+    section.readable = inputs.stat(index, info)
+                    && S_ISREG(info.st_mode)
+                    && inputs.readable(index);
+    section.body_size = section.readable ? info.st_size : 0;
+
+    offset = section.body_offset + section.body_size
+           + (section.readable ? sizeof(BODY_TERMINATOR) - 1 : 0)
+           + sizeof(SECTION_SEPARATOR) - 1;
+  }
+
+  return offset;
+}
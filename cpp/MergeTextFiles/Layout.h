@@ -0,0 +1,43 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Layout.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for planning the layout of a
+// merged file before anything is written. Once every
+// input has been measured, the position of each file's
+// section in the output is known, so the sections can
+// be written independently and in any order. See
+// Layout.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef LAYOUT_H
+#define LAYOUT_H
+
+#include <vector>
+
+#include "Inputs.h"
+
+
+namespace mtf
+{
+  // Where one input file lands in the merged output.
+  struct Section
+  {
+    // Offset of the "FILE #n" header.
+    unsigned long long header_offset;
+    // Offset of the first byte of the body.
+    unsigned long long body_offset;
+    // Size of the body (the input file) in bytes.
+    unsigned long long body_size;
+    // false if the input couldn't be opened, so it has no body.
+    bool readable;
+  };
+
+  // Measure every input and work out where its section goes.
+  unsigned long long planLayout( const InputSet & inputs,
+                                 std::vector<Section> & sections );
+};
+#endif // LAYOUT_H
@@ -0,0 +1,522 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Merge.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for the merge routines
+// declared in Merge.h. mergeBlocks copies each file
+// through a large user space buffer in fixed size
+// blocks, so it never looks at line boundaries.
+// mergeKernel writes only the section headers from
+// user space and lets the kernel move each body
+// straight from the input file to the output file.
+//
+// ******************************************************/
+
+#include "Merge.h"
+#include "FileCopy.h"
+#include "Writer.h"
+#include "Dedup.h"
+
+#include <fstream>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+
+// Bodies at least this large are spliced into pipes.
+static const off_t SPLICE_MIN = 64 * 1024;
+
+// Seconds elapsed since start.
+static double secondsSince(std::chrono::steady_clock::time_point start)
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Keeps in_fd only if it's a regular file, as planLayout does, so
+// directories and devices get a header but no body on every path.
+static int regularOnly(int in_fd, struct stat & info)
+{
+  if(in_fd >= 0 && (::fstat(in_fd, &info) != 0 || !S_ISREG(info.st_mode)))
+  {
+    ::close(in_fd);
+    return -1;
+  }
+
+  return in_fd;
+}
+
+
+
+/* *************************************************
+// Opens the output of a merge. The name "-" means
+// standard output, which is duplicated so that the
+// caller can close whatever it gets back.
+//
+// @param outname: The name of the output file.
+//
+// @param truncate: false to keep what's already in
+// the file, for an incremental merge.
+//
+// @return: The open descriptor, or -1.
+//
+// *************************************************/
+int mtf::openOutput(const char * outname, bool truncate)
+{
+  if(std::strcmp(outname, STDOUT_NAME) == 0)
+    return ::dup(STDOUT_FILENO);
+
+  // Create/open (and truncate) the output file.
+  return ::open(outname, O_WRONLY | O_CREAT | (truncate ? O_TRUNC : 0), 0644);
+}
+
+
+
+/* *************************************************
+// Checks whether fd is a pipe or FIFO.
+//
+// *************************************************/
+bool mtf::isPipe(int fd)
+{
+  struct stat info;
+
+  return ::fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+
+
+/* *************************************************
+// Checks whether fd is a regular file, which the
+// parallel merges need since they write sections
+// at arbitrary offsets.
+//
+// *************************************************/
+bool mtf::isSeekable(int fd)
+{
+  struct stat info;
+
+  return ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode);
+}
+
+
+
+/* *************************************************
+// Works out the name of a file that goes with a
+// merged output by swapping the output's extension
+// - so AllFiles.txt and ".idx" give AllFiles.idx.
+//
+// @param outname: The name of the merged output.
+//
+// @param extension: The new extension, with its dot.
+//
+// @return: The name of the companion file.
+//
+// *************************************************/
+std::string mtf::siblingPath(const char * outname, const char * extension)
+{
+  std::string path(outname);
+  std::size_t slash = path.rfind('/'), dot = path.rfind('.');
+
+  // Only strip an extension that belongs to the file name itself.
+  if(dot != std::string::npos && dot != 0
+     && (slash == std::string::npos || dot > slash + 1))
+    path.erase(dot);
+
+  return path + extension;
+}
+
+
+
+/* *************************************************
+// Builds the header written before the body of
+// file number n - "\nFILE #n" followed by three
+// newlines.
+//
+// @param number: The (1 based) number of the file.
+//
+// @return: The header text.
+//
+// *************************************************/
+std::string mtf::sectionHeader(unsigned long number)
+{
+  return "\nFILE #" + std::to_string(number) + "\n\n\n";
+}
+
+
+
+/* *************************************************
+// Builds the line written in place of the section
+// for file number n when its body is the same as
+// that of the earlier file number k -
+// "\nFILE #n = FILE #k" and a newline.
+//
+// @param number: The (1 based) number of the file.
+//
+// @param original: The number of the earlier file.
+//
+// @return: The reference text.
+//
+// *************************************************/
+std::string mtf::referenceHeader(unsigned long number, unsigned long original)
+{
+  return "\nFILE #" + std::to_string(number) + " = FILE #"
+       + std::to_string(original) + "\n";
+}
+
+
+
+/* *************************************************
+// Copies the files in inputs into out_fd in
+// large blocks. Each body is read straight into
+// the Writer's buffer (see Writer::copyFrom), so
+// line length makes no difference and the input
+// bytes are passed through untouched. Files that
+// can't be opened or aren't regular files get a
+// header and separator but no body, as they do in
+// planLayout. When the output is a pipe, large bodies
+// are spliced into it instead.
+//
+// With dedup on, every body is hashed as it's
+// copied, and a file whose bytes match an earlier
+// body (see DedupTable) is written as a reference
+// to it instead - as long as that's shorter. Its
+// index entry points at the earlier body.
+//
+// With gzip on, the output is compressed in
+// members that start at section boundaries (see
+// GzipStream); the index entries still give
+// offsets in the uncompressed text.
+//
+// Regular files from the map threshold up (or all
+// of them, or none, as options.map says) are
+// mapped and written straight from the mapping
+// with writev (see Writer::mapFrom) instead of
+// being read into the buffer. Pipes still get
+// splice, which is cheaper yet.
+//
+// With a transform on, every body goes through it
+// (see Writer::transformFrom) rather than being
+// spliced, and files that fail the UTF-8 check are
+// listed in the report. Dedup still compares the
+// bytes as they were read.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output, which may be a file,
+// pipe, FIFO or socket.
+//
+// @param options: The chunk size, prefetch depth,
+// whether to deduplicate, the transform, how the
+// output is written, whether to compress it, and
+// which inputs to map.
+//
+// @param report: Filled with totals for the merge.
+//
+// @return: true if every byte could be written.
+//
+// *************************************************/
+bool mtf::mergeBlocks( const InputSet & inputs, int out_fd,
+                       const BlockOptions & options,
+                       MergeReport & report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+
+  // Compressed output goes through a GzipStream, which has its own threads.
+  std::unique_ptr<GzipStream> gzip;
+
+  if(options.gzip.enabled) gzip.reset(new GzipStream(out_fd, options.gzip));
+
+  Writer out(out_fd, options.chunk_size, 0, gzip ? WRITE_PLAIN : options.write);
+
+  out.compressTo(gzip.get());
+  Prefetcher ahead(inputs, 0, options.prefetch);
+  DedupTable bodies(inputs);
+  Transform transform(options.transform);
+
+  report.sections.assign(count, IndexEntry());
+  report.duplicates = 0;
+  report.saved = 0;
+  report.invalid_utf8.clear();
+  report.members.clear();
+  report.compressed = 0;
+  report.latency = LatencyHistogram();
+
+  LatencyHistogram * latency = fileHistogram(report);
+
+  bool ok = true,
+  // Large bodies are spliced when the output is a pipe..
+       to_pipe = !gzip && isPipe(out_fd),
+  // unless they have to be transformed.
+       transforming = transform.active();
+
+  for(unsigned long index = 0; ok && index < count; ++index)
+  {
+    FileTimer timer(latency);
+
+    // Open next input file.
+    int in_fd = ahead.take();
+
+    IndexEntry & entry = report.sections[index];
+    entry.offset = NO_BODY;
+
+    // Let a gzip member start here.
+    ok = out.section();
+
+    // Only regular files have a body.
+    struct stat info;
+    in_fd = regularOnly(in_fd, info);
+    bool regular = in_fd >= 0;
+
+    // Big files (or every file, if asked) are mapped rather than read.
+    bool mapped = regular && info.st_size > 0
+               && ( options.map == MMAP_ALWAYS
+                    || (options.map == MMAP_AUTO
+                        && (unsigned long long) info.st_size >= options.map_threshold) );
+
+    std::string header = sectionHeader(index + 1);
+    std::uint64_t body_hash = 0;
+    bool hashed = false;
+    long original = -1;
+
+    // Look for an earlier copy of this body.
+    if(options.dedup && regular)
+      original = bodies.find(in_fd, info.st_size, body_hash, hashed);
+
+    if(original >= 0)
+    {
+      std::string reference = referenceHeader(index + 1, original + 1);
+
+      // A copy would be as long as the earlier body as it was written.
+      unsigned long long full = header.size() + report.sections[original].length
+                              + sizeof(BODY_TERMINATOR) - 1;
+
+      // Only use the reference if it's shorter than the copy.
+      if(reference.size() < full)
+      {
+        ok = ok && out.append(reference.data(), reference.size());
+
+        entry = report.sections[original];
+        ++report.duplicates;
+        report.saved += full - reference.size();
+      }
+      else original = -1;
+    }
+
+    // If the file can be read, copy its body and terminating newline.
+    if(original < 0)
+    {
+      // Write the section number.
+      ok = ok && out.append(header.data(), header.size());
+
+      if(ok && in_fd >= 0)
+      {
+        Hash64 hasher;
+
+        entry.offset = out.position();
+
+        // Big files can go straight into a pipe; small ones share the buffer.
+        if(transforming)
+        {
+          transform.reset();
+          ok = out.transformFrom(in_fd, options.dedup && !hashed ? &hasher : NULL, transform);
+
+          if(ok && !transform.valid()) report.invalid_utf8.push_back(index + 1);
+        }
+        else if(!options.dedup && to_pipe && regular && info.st_size >= SPLICE_MIN)
+          ok = out.spliceFrom(in_fd);
+        else if(mapped)
+          ok = out.mapFrom(in_fd, info.st_size, options.dedup && !hashed ? &hasher : NULL);
+        else
+          ok = out.copyFrom(in_fd, options.dedup && !hashed ? &hasher : NULL);
+
+        entry.length = out.position() - entry.offset;
+        ok = ok && out.append(BODY_TERMINATOR, sizeof(BODY_TERMINATOR) - 1);
+
+        // Remember the body (as read) for the files after it.
+        if(ok && options.dedup && regular)
+          bodies.add(index, info.st_size, hashed ? body_hash : hasher.digest());
+      }
+    }
+
+    // Close the input file.
+    if(in_fd >= 0) ::close(in_fd);
+
+    // Write some whitespace to the file between chapters.
+    ok = ok && out.append(SECTION_SEPARATOR, sizeof(SECTION_SEPARATOR) - 1);
+
+    timer.done();
+    stepProgress(index + 1, out.position());
+  }
+
+  // Write out whatever is still buffered.
+  ok = ok && out.flush();
+
+  report.files = count;
+  report.bytes = out.position();
+  report.writes = out.writes();
+
+  // Compress the last members, and note where they all went.
+  if(gzip)
+  {
+    ok = ok && gzip->finish();
+
+    report.members = gzip->members();
+    report.compressed = gzip->size();
+    report.writes = gzip->writes();
+  }
+
+  report.seconds = secondsSince(start);
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Copies the files in inputs into out_fd. The
+// headers and separators are written with write,
+// while the bodies are moved by copyKernel, so no
+// file data is copied into this process unless the
+// kernel can't do it. Files that can't be opened
+// or aren't regular files get a header and
+// separator but no body, just as in mergeBlocks.
+// sendfile can feed a pipe, so this works for
+// streamed output as well.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output.
+//
+// @param prefetch: The number of inputs to open
+// and read ahead of the copy (see Prefetcher).
+//
+// @param report: Filled with totals for the merge.
+//
+// @return: true if every byte could be written.
+//
+// *************************************************/
+bool mtf::mergeKernel( const InputSet & inputs, int out_fd,
+                       unsigned prefetch, MergeReport & report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+  unsigned long long written = 0;
+  bool ok = true;
+
+  Prefetcher ahead(inputs, 0, prefetch);
+  report.sections.assign(count, IndexEntry());
+  report.latency = LatencyHistogram();
+
+  LatencyHistogram * latency = fileHistogram(report);
+
+  for(unsigned long index = 0; ok && index < count; ++index)
+  {
+    FileTimer timer(latency);
+
+    // Write the section number.
+    std::string header = sectionHeader(index + 1);
+    ok = writeAll(out_fd, header.data(), header.size());
+    written += header.size();
+
+    // Open next input file; only regular files have a body.
+    struct stat info;
+    int in_fd = regularOnly(ahead.take(), info);
+
+    IndexEntry & entry = report.sections[index];
+    entry.offset = NO_BODY;
+
+    // If the file can be read, copy its body and terminating newline.
+    if(ok && in_fd >= 0)
+    {
+      entry.offset = written;
+      ok = copyKernel(in_fd, out_fd, written);
+      entry.length = written - entry.offset;
+
+      ok = ok && writeAll(out_fd, BODY_TERMINATOR, sizeof(BODY_TERMINATOR) - 1);
+      written += sizeof(BODY_TERMINATOR) - 1;
+    }
+
+    // Close the input file.
+    if(in_fd >= 0) ::close(in_fd);
+
+    // Write some whitespace to the file between chapters.
+    ok = ok && writeAll(out_fd, SECTION_SEPARATOR, sizeof(SECTION_SEPARATOR) - 1);
+    written += sizeof(SECTION_SEPARATOR) - 1;
+
+    timer.done();
+    stepProgress(index + 1, written);
+  }
+
+  report.files = count;
+  report.bytes = written;
+  report.seconds = secondsSince(start);
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Compares two files byte by byte.
+//
+// @param fst_name: The name of the first file.
+//
+// @param snd_name: The name of the second file.
+//
+// @return: true if both files could be read and
+// hold exactly the same bytes.
+//
+// *************************************************/
+bool mtf::sameContents(const char * fst_name, const char * snd_name)
+{
+  std::ifstream fst(fst_name, std::ios::binary),
+                snd(snd_name, std::ios::binary);
+
+  // If either file can't be read, they aren't the same.
+  if(!fst || !snd) return false;
+
+  char fst_block[1 << 16], snd_block[1 << 16];
+
+  // Compare the files one block at a time.
+  while(fst && snd)
+  {
+    fst.read(fst_block, sizeof(fst_block));
+    snd.read(snd_block, sizeof(snd_block));
+
+    // If the blocks differ in length or content..
+    if(fst.gcount() != snd.gcount()
+       || std::memcmp(fst_block, snd_block, fst.gcount()) != 0)
+      // The files differ.
+      return false;
+  }
+
+  // Both files must have ended at the same time.
+  return !fst && !snd;
+}
+
+
+
+/* *************************************************
+// Computes the throughput of a merge.
+//
+// @param report: The totals of the merge.
+//
+// @return: Megabytes written per second.
+//
+// *************************************************/
+double mtf::throughput(const MergeReport & report)
+{
+  // Guard against a merge too quick to measure.
+  if(report.seconds <= 0) return 0;
+
+  return report.bytes / report.seconds / 1e6;
+}
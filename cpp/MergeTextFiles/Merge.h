@@ -0,0 +1,164 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Merge.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the merge routines used by
+// MergeTextFiles. Every merge writes the same layout:
+// for file number n, the header "\nFILE #n\n\n\n", the
+// body of the file followed by a newline, and then
+// the separator "\n\n\n". A file that is a copy of an
+// earlier file k may instead be written as the line
+// "\nFILE #n = FILE #k\n" and the separator. See
+// Merge.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef MERGE_H
+#define MERGE_H
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+#include "Inputs.h"
+#include "Writer.h"
+#include "Transform.h"
+#include "Gzip.h"
+#include "Stats.h"
+
+
+namespace mtf
+{
+  // The name of the output file.
+  const char OUTFILENAME[] = "AllFiles.txt";
+
+  // The name of the output file when it's compressed.
+  const char GZIP_OUTFILENAME[] = "AllFiles.txt.gz";
+
+  // The output name that means standard output.
+  const char STDOUT_NAME[] = "-";
+
+  // Written after the body of each file (the last line's newline).
+  const char BODY_TERMINATOR[] = "\n";
+
+  // Whitespace written to the file between chapters.
+  const char SECTION_SEPARATOR[] = "\n\n\n";
+
+  // Marks a file that had no body (it couldn't be read).
+  const unsigned long long NO_BODY = ~0ULL;
+
+  // Where one file's body sits in the merged output.
+  struct IndexEntry
+  {
+    // Offset of the first byte of the body, or NO_BODY.
+    unsigned long long offset;
+    // Length of the body in bytes.
+    unsigned long long length;
+  };
+
+  // Totals gathered over a single merge.
+  struct MergeReport
+  {
+    // The number of input files merged.
+    unsigned long files;
+    // The number of bytes written to the output.
+    unsigned long long bytes;
+    // Wall clock time of the merge in seconds.
+    double seconds;
+    // Where each file's body ended up, in file order.
+    std::vector<IndexEntry> sections;
+    // The number of files written as references to an
+    // identical earlier file, and the bytes that saved.
+    unsigned long duplicates;
+    unsigned long long saved;
+    // The numbers of the files whose bodies failed the UTF-8 check.
+    std::vector<unsigned long> invalid_utf8;
+    // The write calls issued for the output (0 if not counted).
+    unsigned long writes;
+    // For gzip output, the members written and their total size.
+    std::vector<GzipMember> members;
+    unsigned long long compressed;
+    // How long each file took, if kept (see timeFiles).
+    LatencyHistogram latency;
+  };
+
+  // When the block copy maps an input rather than reading it.
+  enum MapMode
+  {
+    // Always read.
+    MMAP_NEVER,
+    // Map regular files of at least the threshold.
+    MMAP_AUTO,
+    // Map every regular file that isn't empty.
+    MMAP_ALWAYS
+  };
+
+  // The size from which MMAP_AUTO maps an input.
+  const unsigned long long DEFAULT_MAP_THRESHOLD = 64ULL << 20;
+
+  // Tuning for the block copy.
+  struct BlockOptions
+  {
+    // The size of the copy buffer.
+    std::size_t chunk_size;
+    // The number of inputs opened and read ahead (see Prefetcher).
+    unsigned prefetch;
+    // true to write a duplicate body as a reference to the first copy.
+    bool dedup;
+    // The clean up applied to each body (see Transform).
+    TransformOptions transform;
+    // How the output buffers are written (see Writer).
+    WriteOptions write;
+    // Whether and how to compress the output (see GzipStream).
+    GzipOptions gzip;
+    // Which inputs are mapped (see Writer::mapFrom), and the size
+    // from which MMAP_AUTO maps them.
+    MapMode map;
+    unsigned long long map_threshold;
+  };
+
+  // Defaults for BlockOptions.
+  const BlockOptions BLOCK_DEFAULTS = { DEFAULT_CHUNK_SIZE, DEFAULT_PREFETCH, false,
+                                        TRANSFORM_NONE, WRITE_BACKGROUND, GZIP_OFF,
+                                        MMAP_AUTO, DEFAULT_MAP_THRESHOLD };
+
+  // Open (and truncate) outname for writing, or stdout for "-".
+  int openOutput(const char * outname, bool truncate = true);
+
+  // true if fd is a pipe or FIFO.
+  bool isPipe(int fd);
+
+  // true if fd is a regular file, which may be written at any offset.
+  bool isSeekable(int fd);
+
+  // outname with its extension swapped for extension (e.g. ".idx").
+  std::string siblingPath(const char * outname, const char * extension);
+
+  // Build the header that precedes file number n.
+  std::string sectionHeader(unsigned long number);
+
+  // Build the line that stands in for file n, a copy of file k.
+  std::string referenceHeader(unsigned long number, unsigned long original);
+
+  // Merge by copying file bodies in large fixed size blocks.
+  bool mergeBlocks( const InputSet & inputs, int out_fd,
+                    const BlockOptions & options,
+                    MergeReport & report );
+
+  // Merge by moving whole file bodies in the kernel.
+  bool mergeKernel( const InputSet & inputs, int out_fd,
+                    unsigned prefetch, MergeReport & report );
+
+  // Merge with a pool of threads writing at precomputed offsets.
+  bool mergeParallel( const InputSet & inputs, int out_fd,
+                      unsigned threads, MergeReport & report );
+
+  // Check whether two files hold exactly the same bytes.
+  bool sameContents(const char * fst_name, const char * snd_name);
+
+  // Megabytes per second for a report.
+  double throughput(const MergeReport & report);
+};
+#endif // MERGE_H
@@ -0,0 +1,1404 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  MergeTextFiles.cpp
+// Date:  April 23, 2017
+//
+// Overview: This program is used to copy over a set of
+// files into a single file. The files loaded into this
+// file must have numeric names spaced evenly by 1, with
+// a .txt extension.. i.e. 1.txt, 2.txt, .. , 5.txt. When
+// running the program, an argument of the name of the
+// last file to be loaded, sans extension.. If you want
+// to load 10 files, for example, the argument should
+// simply be 10. The files will be loaded into a new file
+// called AllFiles.txt. Other sets of files can be merged
+// with --dir, --glob or --list instead of a count.
+//
+// Options:
+//   -d, --dir DIR  Merge every regular file in DIR (not
+//                  hidden ones), in natural order, so
+//                  part9.txt comes before part10.txt.
+//                  The output itself is left out, but
+//                  its index would not be, so write
+//                  into DIR only with --no-index.
+//   -g, --glob PATTERN
+//                  Merge the files matching PATTERN
+//                  (quoted, so the shell leaves it
+//                  alone) in natural order. Only the
+//                  last part of the path may have
+//                  wildcards.
+//   -l, --list FILE
+//                  Merge the files named in FILE, one
+//                  per line, in the order listed.
+//   -o, --output PATH
+//                  Write the merge to PATH instead of
+//                  AllFiles.txt. "-" streams it to
+//                  standard output (status messages go
+//                  to standard error instead).
+//   --fd N         Stream the merge to the already open
+//                  descriptor N (a pipe, FIFO, socket
+//                  or file).
+//   --index PATH   Write the section index (the offset
+//                  and length of each file's body) to
+//                  PATH. By default it goes beside the
+//                  output, e.g. AllFiles.idx, and isn't
+//                  written for --fd or stdout output.
+//                  See ExtractFile.cpp.
+//   --no-index     Don't write a section index.
+//   -b, --chunk-size SIZE
+//                  The size of the blocks file bodies are
+//                  copied in (default 1M). A K, M or G
+//                  suffix may be used.
+//   -k, --kernel   Move each file body with
+//                  copy_file_range/sendfile instead of
+//                  copying it through a buffer.
+//   --dedup        Write a file whose bytes match an
+//                  earlier file as "FILE #n = FILE #k"
+//                  instead of copying it again, and
+//                  report the bytes saved. Its index
+//                  entry points at the earlier body.
+//                  Block copy only.
+//   --crlf         Turn every CR LF line end in a body
+//                  into a lone LF. Block copy only, as
+//                  are --nul and --utf8.
+//   --nul MODE     What to do with NUL bytes in a body:
+//                  "keep" (the default), "strip" them,
+//                  or "escape" each as the two
+//                  characters backslash and 0.
+//   --utf8         Check that each body is valid UTF-8
+//                  and warn about the files that aren't
+//                  (they are still merged as they are).
+//   -s, --sorted   The inputs are each sorted line by
+//                  line: merge their lines into one
+//                  sorted output (like sort -m, comparing
+//                  bytes) instead of writing the files
+//                  one after another. No headers or
+//                  index are written.
+//   --unique       With --sorted, write only the first
+//                  of each run of lines with equal keys.
+//   --key N        With --sorted, order lines by field N
+//                  (counting from 1) instead of the
+//                  whole line.
+//   --separator C  The character between fields (a tab
+//                  by default).
+//   --fan-in N     With --sorted, merge at most N files
+//                  at once (512 by default, and never
+//                  more than the open file limit
+//                  allows). More inputs are merged in
+//                  passes through temporary files.
+//   --temp-dir DIR Where those temporary files go
+//                  ($TMPDIR or /tmp by default).
+//   --direct       Write the output with O_DIRECT, so a
+//                  huge merge doesn't push everything
+//                  else out of the page cache. Block
+//                  copy to a regular file only; falls
+//                  back to normal writes where O_DIRECT
+//                  isn't supported.
+//   --mmap MODE    When to map an input instead of
+//                  reading it: "auto" (the default) maps
+//                  regular files of at least the
+//                  threshold, "always" every regular
+//                  file, "never" none. A mapped file is
+//                  read ahead sequentially (with huge
+//                  pages where the file system allows)
+//                  and written with writev together
+//                  with its header, so it's never copied
+//                  into the buffer. Used by the block
+//                  copy (and --batch), but not with
+//                  --gzip or --direct, which need the
+//                  buffer.
+//   --mmap-threshold SIZE
+//                  The size from which "auto" maps a
+//                  file (default 64M).
+//   -z, --gzip     Compress the output with gzip as it's
+//                  written (to AllFiles.txt.gz unless -o
+//                  says otherwise). It's written as a run
+//                  of gzip members, compressed by a pool
+//                  of threads and started where sections
+//                  start, so gzip -d reads it as usual
+//                  and ExtractFile can pull out one file
+//                  by inflating only its members. Block
+//                  copy only.
+//   --gzip-level N The compression level, 0 to 9 (6).
+//   --gzip-threads N
+//                  The compressing threads (one per CPU
+//                  by default, and never more than
+//                  there are CPUs).
+//   --gzip-block SIZE
+//                  Start a new member at the first
+//                  section after SIZE bytes (default
+//                  1M), and at 4 x SIZE regardless.
+//   -c, --compare  Run both the block copy and the
+//                  kernel copy, check that they produce
+//                  the same file and report the
+//                  throughput of each.
+//   -j, --threads N
+//                  Stat every file first, then copy
+//                  the files with N threads, each
+//                  writing its sections at their final
+//                  offsets. The output is identical to
+//                  a serial merge. N is at most 1024.
+//   -u, --uring    Batch the opens, reads, writes and
+//                  closes of many files into single
+//                  io_uring submissions. Falls back to
+//                  the kernel copy without io_uring.
+//   --uring-batch N
+//                  Files opened per submission (256,
+//                  at most 16384).
+//   --uring-depth N
+//                  Reads kept in flight at once (64,
+//                  at most 10922).
+//   -i, --incremental
+//                  Keep a manifest of the files merged
+//                  (size, mtime and content hash) and,
+//                  on later runs, keep the output up to
+//                  the first file that changed and merge
+//                  only from there on. New files are
+//                  just appended. Uses the block copy.
+//   --prefetch K   Open the next K files and start the
+//                  kernel reading them while the
+//                  current one is copied (default 8, 0
+//                  to open each file only when it's
+//                  needed). Used by the block, kernel
+//                  and incremental copies. K must leave
+//                  room under the open file limit.
+//   --manifest PATH
+//                  Where the manifest goes (by default
+//                  beside the output, e.g.
+//                  AllFiles.manifest).
+//   --match TEXT   Keep only the lines that contain TEXT
+//                  (or any of the TEXTs, if given more
+//                  than once), like a grep after the
+//                  merge but without writing the rest.
+//                  No index is written.
+//   --match-file FILE
+//                  Read more TEXTs from FILE, one per
+//                  line.
+//   --prefix       Keep only the lines that start with
+//                  a TEXT.
+//   --with-headers Write the "FILE #n" header (and
+//                  separator) around the lines kept
+//                  from each file; files with none are
+//                  left out.
+//   --split        Do the reverse of a merge: split the
+//                  merged file (AllFiles.txt, or the -o
+//                  path) back into 1.txt..N.txt. The
+//                  sections are taken from the index if
+//                  it still fits the merge, or else
+//                  found by a scan for their headers on
+//                  -j threads (one per CPU by default),
+//                  which also write the parts. A
+//                  "FILE #n = FILE #k" section gets a
+//                  copy of file k; one with no body gets
+//                  no file. Merging the parts again
+//                  gives back the same bytes. A --gzip
+//                  merge is inflated first.
+//   --split-dir DIR
+//                  Where the parts go (the current
+//                  directory by default). DIR is
+//                  made if it doesn't exist.
+//   --batch FILE   Run many merges in one process. Each
+//                  line of FILE is a job: the output,
+//                  then "dir", "glob" or "list" and
+//                  where the inputs are, e.g.
+//                  "out/a.txt dir exports/a" (blank
+//                  lines and # comments are skipped).
+//                  The jobs are measured, then run as
+//                  block copies largest first on one
+//                  pool of -j threads (one per CPU by
+//                  default), which keep their buffers
+//                  from job to job. Each job's status is
+//                  listed at the end, and the exit code
+//                  is 1 if any failed. The block copy
+//                  options, --no-index and --stats
+//                  apply to every job.
+//   --stats PATH   Write a JSON report of the merge to
+//                  PATH ("-" for standard error): its
+//                  bytes, files per second and MB/s,
+//                  the p50, p99 and max time per file,
+//                  and the number of open, read, write
+//                  and in-kernel copy calls with the
+//                  time spent in each. An io_uring
+//                  merge (-u) times neither files nor
+//                  calls, so its report has the ring's
+//                  submissions and operations instead.
+//   --progress, --no-progress
+//                  Show (or don't) a progress line on
+//                  standard error, redrawn a few times
+//                  a second. It's shown by default when
+//                  standard error is a terminal.
+//
+// ******************************************************/
+
+#include <iostream>
+#include <fstream>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <climits>
+#include <string>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#include "Merge.h"
+#include "Uring.h"
+#include "Writer.h"
+#include "Index.h"
+#include "Incremental.h"
+#include "Sorted.h"
+#include "Stats.h"
+#include "Split.h"
+#include "Filter.h"
+#include "Batch.h"
+
+
+// Read a byte count with an optional K, M or G suffix.
+static std::size_t parseSize(const char * text);
+// Read a whole number up to max for option, or say why it isn't one.
+static bool parseWhole( const char * option, const char * text,
+                        unsigned long max, unsigned long & value );
+// The deepest prefetch the descriptor limit leaves room for.
+static unsigned long prefetchLimit(void);
+// Check the block copy options against each other and the merge mode.
+static bool checkBlockOptions( const mtf::BlockOptions & options,
+                               bool other_copy, bool sorted );
+// Print the totals of a single merge.
+static void printReport(const char * label, const mtf::MergeReport & report);
+// Read the literals for a filter from a file, one per line.
+static bool readLiterals(const char * path, std::vector<std::string> & literals);
+// Split a merge back into its files, and report on it.
+static int runSplit( const char * merged_name, const char * index_name,
+                     const mtf::SplitOptions & options, const char * stats_name );
+// Run the merges in a job file, and report on each.
+static int runBatch( const char * job_name, const mtf::BatchOptions & options,
+                     const char * stats_name );
+
+
+// The most threads any option may ask for.
+static const unsigned long MAX_THREADS = 1024;
+
+// Descriptors kept free of a prefetch for stdio, the output and the rest.
+static const unsigned long RESERVED_FDS = 16;
+
+
+// Takes the number of files to scan.
+int main(int argc, char *argv[])
+{
+  // true if file bodies should be moved by the kernel.
+  bool use_kernel = false,
+  // true if both copy methods should be run and compared.
+       compare = false,
+  // true if io_uring should be used.
+       use_uring = false,
+  // true if only changed files should be merged again.
+       incremental = false,
+  // true if sorted inputs should be merged line by line.
+       sorted = false,
+  // true if a merge should be split back into its files.
+       split = false;
+
+  // The lines kept by a filtered merge (none means no filter).
+  mtf::FilterOptions filter_options = { std::vector<std::string>(), false, false };
+
+  // Tuning for the io_uring merge.
+  mtf::UringOptions uring_options = mtf::URING_DEFAULTS;
+
+  // The number of threads for a parallel merge (0 for serial).
+  unsigned threads = 0;
+
+  // The size of the blocks file bodies are copied in, the number of
+  // inputs opened and read ahead of the copy, whether to dedup, and
+  // the clean up applied to each body.
+  mtf::BlockOptions block_options = mtf::BLOCK_DEFAULTS;
+
+  // The key, uniqueness and fan-in of a sorted merge, and whether
+  // any of them were given.
+  mtf::SortOptions sort_options = mtf::SORT_DEFAULTS;
+  bool sort_tuned = false;
+
+  // The threads and directory of a split.
+  mtf::SplitOptions split_options = mtf::SPLIT_DEFAULTS;
+
+  // Where the merge is written.
+  const char * outname = mtf::OUTFILENAME;
+
+  // An inherited descriptor to write to instead (-1 for none).
+  int given_fd = -1;
+
+  // Where the section index goes (NULL for beside the output).
+  const char * index_name = NULL;
+
+  // false if no index should be written.
+  bool write_index = true;
+
+  // Where the incremental manifest goes (NULL for beside the output).
+  const char * manifest_name = NULL;
+
+  // A directory, glob or list file to take the inputs from (NULL for
+  // the numbered files).
+  const char * input_dir = NULL, * input_glob = NULL, * input_list = NULL;
+
+  // A job file of merges to run (NULL for a single merge).
+  const char * batch_name = NULL;
+
+  // Where the JSON stats go (NULL for nowhere).
+  const char * stats_name = NULL;
+
+  // true if the progress line should be shown.
+  bool progress = ::isatty(STDERR_FILENO);
+
+  // The options understood by this program.
+  const option long_opts[] =
+  {
+    { "output",  required_argument, NULL, 'o' },
+    { "fd",      required_argument, NULL, 'F' },
+    { "index",   required_argument, NULL, 'I' },
+    { "no-index", no_argument, NULL, 'N' },
+    { "chunk-size", required_argument, NULL, 'b' },
+    { "kernel",  no_argument, NULL, 'k' },
+    { "compare", no_argument, NULL, 'c' },
+    { "threads", required_argument, NULL, 'j' },
+    { "uring",   no_argument, NULL, 'u' },
+    { "uring-batch", required_argument, NULL, 'B' },
+    { "uring-depth", required_argument, NULL, 'D' },
+    { "incremental", no_argument, NULL, 'i' },
+    { "manifest", required_argument, NULL, 'M' },
+    { "prefetch", required_argument, NULL, 'P' },
+    { "dir",     required_argument, NULL, 'd' },
+    { "glob",    required_argument, NULL, 'g' },
+    { "list",    required_argument, NULL, 'l' },
+    { "dedup",   no_argument, NULL, 'X' },
+    { "crlf",    no_argument, NULL, 'R' },
+    { "nul",     required_argument, NULL, 'Z' },
+    { "utf8",    no_argument, NULL, 'U' },
+    { "sorted",  no_argument, NULL, 's' },
+    { "unique",  no_argument, NULL, 'Q' },
+    { "key",     required_argument, NULL, 'K' },
+    { "separator", required_argument, NULL, 'T' },
+    { "fan-in",  required_argument, NULL, 'W' },
+    { "temp-dir", required_argument, NULL, 'Y' },
+    { "direct",  no_argument, NULL, 'O' },
+    { "mmap",    required_argument, NULL, 'm' },
+    { "mmap-threshold", required_argument, NULL, 'h' },
+    { "gzip",    no_argument, NULL, 'z' },
+    { "gzip-level", required_argument, NULL, 'L' },
+    { "gzip-threads", required_argument, NULL, 'H' },
+    { "gzip-block", required_argument, NULL, 'G' },
+    { "match",   required_argument, NULL, 'J' },
+    { "match-file", required_argument, NULL, 'y' },
+    { "prefix",  no_argument, NULL, 'C' },
+    { "with-headers", no_argument, NULL, 'x' },
+    { "split",   no_argument, NULL, 'S' },
+    { "split-dir", required_argument, NULL, 'E' },
+    { "batch",   required_argument, NULL, 'a' },
+    { "stats",   required_argument, NULL, 'A' },
+    { "progress", no_argument, NULL, 'V' },
+    { "no-progress", no_argument, NULL, 'q' },
+    { NULL, 0, NULL, 0 }
+  };
+
+  int opt = 0;
+
+  // A number read from an option.
+  unsigned long number = 0;
+
+  // Read in any options.
+  while((opt = getopt_long(argc, argv, "o:b:kcj:uid:g:l:sz", long_opts, NULL)) != -1)
+  {
+    switch(opt)
+    {
+      case 'o': outname = optarg; break;
+      case 'F':
+      {
+        char * end = NULL;
+        long fd = std::strtol(optarg, &end, 10);
+
+        // A descriptor is a whole, non-negative int.
+        if(end == optarg || *end != '\0' || fd < 0 || fd > INT_MAX)
+        {
+          std::cout << "\nInvalid Argument!" << std::endl
+                    << "--fd must be an open file descriptor number.."
+                    << std::endl << std::endl;
+
+          return 1;
+        }
+
+        given_fd = static_cast<int>(fd);
+        break;
+      }
+      case 'I': index_name = optarg; break;
+      case 'N': write_index = false; break;
+      case 'b': block_options.chunk_size = parseSize(optarg); break;
+      case 'k': use_kernel = true; break;
+      case 'c': compare = true; break;
+      case 'j':
+        if(!parseWhole("-j", optarg, MAX_THREADS, number)) return 1;
+        threads = static_cast<unsigned>(number);
+        break;
+      case 'u': use_uring = true; break;
+      case 'B': uring_options.batch = std::strtoul(optarg, NULL, 10); break;
+      case 'D': uring_options.depth = std::strtoul(optarg, NULL, 10); break;
+      case 'i': incremental = true; break;
+      case 'M': manifest_name = optarg; break;
+      case 'P':
+        if(!parseWhole("--prefetch", optarg, prefetchLimit(), number)) return 1;
+        block_options.prefetch = static_cast<unsigned>(number);
+        break;
+      case 'd': input_dir = optarg; break;
+      case 'g': input_glob = optarg; break;
+      case 'l': input_list = optarg; break;
+      case 'X': block_options.dedup = true; break;
+      case 'R': block_options.transform.crlf = true; break;
+      case 'Z':
+        if(std::strcmp(optarg, "keep") == 0) block_options.transform.nul = mtf::NUL_KEEP;
+        else if(std::strcmp(optarg, "strip") == 0) block_options.transform.nul = mtf::NUL_STRIP;
+        else if(std::strcmp(optarg, "escape") == 0) block_options.transform.nul = mtf::NUL_ESCAPE;
+        else
+        {
+          std::cout << "\nInvalid Argument!" << std::endl
+                    << "--nul must be keep, strip or escape.."
+                    << std::endl << std::endl;
+
+          return 1;
+        }
+        break;
+      case 'U': block_options.transform.utf8 = true; break;
+      case 's': sorted = true; break;
+      case 'Q': sort_options.unique = true; sort_tuned = true; break;
+      case 'K':
+        if(!parseWhole("--key", optarg, UINT_MAX, number)) return 1;
+        sort_options.key_field = static_cast<unsigned>(number);
+        sort_tuned = true;
+        break;
+      case 'T':
+        if(std::strlen(optarg) != 1)
+        {
+          std::cout << "\nInvalid Argument!" << std::endl
+                    << "--separator must be a single character.."
+                    << std::endl << std::endl;
+
+          return 1;
+        }
+        sort_options.separator = optarg[0];
+        sort_tuned = true;
+        break;
+      case 'W':
+        if(!parseWhole("--fan-in", optarg, UINT_MAX, number)) return 1;
+        sort_options.fan_in = static_cast<unsigned>(number);
+        sort_tuned = true;
+        break;
+      case 'Y': sort_options.temp_dir = optarg; sort_tuned = true; break;
+      case 'O': block_options.write.direct = true; break;
+      case 'm':
+        if(std::strcmp(optarg, "auto") == 0) block_options.map = mtf::MMAP_AUTO;
+        else if(std::strcmp(optarg, "always") == 0) block_options.map = mtf::MMAP_ALWAYS;
+        else if(std::strcmp(optarg, "never") == 0) block_options.map = mtf::MMAP_NEVER;
+        else
+        {
+          std::cout << "\nInvalid Argument!" << std::endl
+                    << "--mmap must be auto, always or never.."
+                    << std::endl << std::endl;
+
+          return 1;
+        }
+        break;
+      case 'h': block_options.map_threshold = parseSize(optarg); break;
+      case 'z': block_options.gzip.enabled = true; break;
+      case 'L':
+        if(!parseWhole("--gzip-level", optarg, 9, number)) return 1;
+        block_options.gzip.level = static_cast<int>(number);
+        break;
+      case 'H':
+        if(!parseWhole("--gzip-threads", optarg, MAX_THREADS, number)) return 1;
+        block_options.gzip.threads = static_cast<unsigned>(number);
+        break;
+      case 'G': block_options.gzip.block_size = parseSize(optarg); break;
+      case 'J': filter_options.literals.push_back(optarg); break;
+      case 'y':
+        if(!readLiterals(optarg, filter_options.literals))
+        {
+          std::cout << "\nCould not read " << optarg << ": "
+                    << std::strerror(errno) << std::endl << std::endl;
+
+          return 1;
+        }
+        break;
+      case 'C': filter_options.prefix = true; break;
+      case 'x': filter_options.headers = true; break;
+      case 'S': split = true; break;
+      case 'E': split_options.dir = optarg; break;
+      case 'a': batch_name = optarg; break;
+      case 'A': stats_name = optarg; break;
+      case 'V': progress = true; break;
+      case 'q': progress = false; break;
+      default:  return 1;
+    }
+  }
+
+  // If the chunk size makes no sense..
+  if(block_options.chunk_size == 0)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "The chunk size must be a positive number of bytes.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // The same goes for the map threshold.
+  if(block_options.map_threshold == 0)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "The mmap threshold must be a positive number of bytes.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // If the merge goes to stdout, keep our messages out of it.
+  if(given_fd == STDOUT_FILENO || std::strcmp(outname, mtf::STDOUT_NAME) == 0)
+    std::cout.rdbuf(std::cerr.rdbuf());
+
+  // A filtered merge reads every line itself.
+  const bool filtering = !filter_options.literals.empty();
+
+  for(const std::string & literal : filter_options.literals)
+    if(literal.empty() || literal.find('\n') != std::string::npos)
+    {
+      std::cout << "\nInvalid Argument!" << std::endl
+                << "--match needs text on a single line.."
+                << std::endl << std::endl;
+
+      return 1;
+    }
+
+  if(sort_tuned && !sorted)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--unique, --key, --separator, --fan-in and --temp-dir need --sorted.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  if((filter_options.prefix || filter_options.headers) && !filtering)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--prefix and --with-headers need --match.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  if( filtering && ( compare || use_uring || threads > 0 || use_kernel || incremental
+                     || sorted || split || block_options.dedup || block_options.gzip.enabled
+                     || block_options.transform.crlf || block_options.transform.utf8
+                     || block_options.transform.nul != mtf::NUL_KEEP ) )
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--match can't be combined with the other merge modes, --dedup,"
+              << " --gzip or the clean up options.." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // A split reads a merge rather than making one.
+  if(split)
+  {
+    if( compare || use_uring || use_kernel || incremental || sorted || block_options.dedup
+        || block_options.transform.crlf || block_options.transform.utf8
+        || block_options.transform.nul != mtf::NUL_KEEP
+        || block_options.write.direct || block_options.gzip.enabled || given_fd >= 0
+        || std::strcmp(outname, mtf::STDOUT_NAME) == 0 || input_dir || input_glob || input_list
+        || batch_name )
+    {
+      std::cout << "\nInvalid Argument!" << std::endl
+                << "--split takes a named merge (-o), and only -j, --index,"
+                << " --no-index and --split-dir.." << std::endl << std::endl;
+
+      return 1;
+    }
+
+    split_options.threads = threads;
+    split_options.use_index = write_index;
+
+    return runSplit(outname, index_name, split_options, stats_name);
+  }
+
+  // A batch names its own inputs and outputs, and runs block copies.
+  if(batch_name)
+  {
+    if( compare || use_uring || use_kernel || incremental || sorted || filtering
+        || outname != mtf::OUTFILENAME || given_fd >= 0 || index_name || manifest_name
+        || input_dir || input_glob || input_list || optind < argc )
+    {
+      std::cout << "\nInvalid Argument!" << std::endl
+                << "--batch takes its inputs and outputs from the job file, and"
+                << " only -j and the block copy options.." << std::endl << std::endl;
+
+      return 1;
+    }
+
+    // Every job is a block copy.
+    if(!checkBlockOptions(block_options, false, false)) return 1;
+
+    mtf::BatchOptions batch_options = { threads, block_options, write_index };
+
+    return runBatch(batch_name, batch_options, stats_name);
+  }
+
+  // true if the inputs are 1.txt..N.txt.
+  const bool numbered = !input_dir && !input_glob && !input_list;
+
+  // If no arguments are provided..
+  if(numbered && optind >= argc)
+  {
+    // Print an alert for invalid argument list..
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "Please provide the number of files to scan.."
+              << std::endl << std::endl;
+
+    // Return with error code 1.
+    return 1;
+  }
+
+  char * end = NULL;
+  errno = 0;
+
+  // The number of files to scan.
+  const unsigned long NUMFILES = numbered ? std::strtoul( argv[optind], &end, 10 ) : 1;
+
+  // If the argument isn't a number of at least 1..
+  if(numbered && (end == argv[optind] || *end != '\0' || errno == ERANGE
+                  || argv[optind][0] == '-' || NUMFILES < 1))
+  {
+    // Print an alert for invalid argument.
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "Entry must be a whole number greater than 0.."
+              << std::endl << std::endl;
+
+    // Return with error code 1.
+    return 1;
+  }
+
+  // Comparing the outputs means reading them back by name.
+  if(compare && (given_fd >= 0 || std::strcmp(outname, mtf::STDOUT_NAME) == 0))
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--compare needs a named output file.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // The copy methods are alternatives, so only one can be asked for.
+  if((compare ? 1 : 0) + (use_uring ? 1 : 0) + (threads > 0 ? 1 : 0) + (use_kernel ? 1 : 0) > 1)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "Only one of --compare, --kernel, --threads and --uring can be"
+              << " given.." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // The ring can only be so big, so say so rather than falling back.
+  if( uring_options.batch < 1 || uring_options.batch > mtf::URING_MAX_ENTRIES / 2
+      || uring_options.depth < 1 || uring_options.depth > mtf::URING_MAX_ENTRIES / 3 )
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--uring-batch must be from 1 to " << mtf::URING_MAX_ENTRIES / 2
+              << " and --uring-depth from 1 to " << mtf::URING_MAX_ENTRIES / 3 << ".."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // An incremental merge rewrites part of an output it can find again.
+  if(incremental && (compare || use_uring || threads > 0 || use_kernel))
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--incremental can't be combined with --compare, --kernel,"
+              << " --threads or --uring.." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // true if the bodies are to be cleaned up.
+  const bool transforming = block_options.transform.crlf || block_options.transform.utf8
+                         || block_options.transform.nul != mtf::NUL_KEEP;
+
+  // Only the block copy looks at file contents.
+  if(!checkBlockOptions( block_options,
+                         compare || use_uring || threads > 0 || use_kernel || incremental,
+                         sorted ))
+    return 1;
+
+  // A compressed merge gets a name that says so.
+  if(block_options.gzip.enabled && outname == mtf::OUTFILENAME)
+    outname = mtf::GZIP_OUTFILENAME;
+
+  // A sorted merge has no sections to index, copy or compare.
+  if(sorted && ( compare || use_uring || threads > 0 || use_kernel || incremental
+                 || block_options.dedup || transforming ))
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--sorted can't be combined with the other merge modes.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  if(incremental && !manifest_name && given_fd >= 0)
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--incremental with --fd needs a --manifest.."
+              << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // The files to be loaded.
+  mtf::InputSet inputs;
+
+  if(numbered)
+    // 1.txt..NUMFILES.txt; names are made as needed.
+    inputs.setNumbered(NUMFILES);
+  else
+  {
+    struct stat out_info;
+
+    // If the output already exists, make sure it isn't merged into itself.
+    if( given_fd >= 0 ? ::fstat(given_fd, &out_info) == 0
+        : std::strcmp(outname, mtf::STDOUT_NAME) == 0 ? ::fstat(STDOUT_FILENO, &out_info) == 0
+        : ::stat(outname, &out_info) == 0 )
+      inputs.exclude(out_info);
+
+    const char * source = input_dir ? input_dir : input_glob ? input_glob : input_list;
+
+    bool found = input_dir ? inputs.scanDirectory(input_dir)
+               : input_glob ? inputs.scanGlob(input_glob)
+               : inputs.readList(input_list);
+
+    // If the inputs can't be found..
+    if(!found)
+    {
+      std::cout << "\nCould not read " << source << ": "
+                << std::strerror(errno) << std::endl << std::endl;
+
+      return 1;
+    }
+
+    // If there's nothing to merge..
+    if(inputs.size() == 0)
+    {
+      std::cout << "\nNo files to merge in " << source << ".."
+                << std::endl << std::endl;
+
+      return 1;
+    }
+  }
+
+  // Open the output (or take the one we were given).
+  int out_fd = given_fd >= 0 ? ::dup(given_fd) : mtf::openOutput(outname, !incremental);
+
+  // If the output can't be written, there's nothing to do.
+  if(out_fd < 0)
+  {
+    std::cout << "\nCould not open " << outname << ": "
+              << std::strerror(errno) << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // The parallel merges write sections out of order.
+  if((compare || use_uring || threads > 0 || incremental) && !mtf::isSeekable(out_fd))
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << "--compare, --threads, --uring and --incremental need a"
+              << " regular output file.."
+              << std::endl << std::endl;
+
+    ::close(out_fd);
+    return 1;
+  }
+
+  // Print message with number of files to be scanned.
+  std::cout << "Scanning " << inputs.size() << " files.." << std::endl;
+
+
+  // Print out some whitespace.
+  std::cout << std::endl << std::endl;
+
+  // Totals for the merge (and for the block copy it's compared with).
+  mtf::MergeReport report = {}, block_report = {};
+  mtf::UringReport uring_report = {};
+
+  // Count calls and time files only when they'll be reported.
+  if(stats_name)
+  {
+    mtf::countCalls(true);
+    mtf::timeFiles(true);
+  }
+
+  if(progress) mtf::startProgress(inputs.size());
+
+  bool ok = true;
+
+  // The name of the merge run, for the stats.
+  const char * mode = filtering ? "filter" : sorted ? "sorted" : incremental ? "incremental" : compare ? "compare"
+                    : use_uring ? "uring" : threads > 0 ? "parallel"
+                    : use_kernel ? "kernel" : "block";
+
+  // If only some lines should be kept..
+  if(filtering)
+  {
+    mtf::FilterReport filter_report = {};
+
+    ok = mtf::mergeFiltered(inputs, out_fd, block_options, filter_options, report, filter_report);
+
+    if(ok)
+    {
+      printReport("Filtered copy", report);
+      std::cout << "Filter: " << filter_report.kept << " lines kept from "
+                << filter_report.matched << " files" << std::endl;
+
+      if(filter_report.unreadable)
+        std::cout << filter_report.unreadable << " files could not be read" << std::endl;
+    }
+
+    // The sections aren't those of a full merge, so there's no index.
+    write_index = false;
+
+    if(given_fd < 0 && std::strcmp(outname, mtf::STDOUT_NAME) != 0)
+      std::remove(mtf::indexPathFor(outname).c_str());
+  }
+  // If the inputs' lines should be merged in order..
+  else if(sorted)
+  {
+    mtf::SortReport sort_report = {};
+
+    ok = mtf::mergeSorted(inputs, out_fd, sort_options, report, sort_report);
+
+    if(ok)
+    {
+      printReport("Sorted merge", report);
+      std::cout << "Lines: " << sort_report.lines << " written, "
+                << sort_report.dropped << " duplicates dropped, "
+                << sort_report.passes << " passes" << std::endl;
+    }
+
+    if(sort_report.unreadable)
+      std::cout << sort_report.unreadable << " files could not be read" << std::endl;
+
+    // There are no sections, so no index - and an old one would be wrong.
+    write_index = false;
+
+    if(given_fd < 0 && std::strcmp(outname, mtf::STDOUT_NAME) != 0)
+      std::remove(mtf::indexPathFor(outname).c_str());
+  }
+  // If only what changed since the last run should be merged..
+  else if(incremental)
+  {
+    std::string manifest_path = manifest_name ? manifest_name
+                                              : mtf::manifestPathFor(outname);
+    mtf::IncrementalReport incremental_report = {};
+
+    ok = mtf::mergeIncremental( inputs, out_fd, block_options.chunk_size,
+                                block_options.prefetch,
+                                manifest_path.c_str(), report,
+                                incremental_report );
+
+    if(ok)
+    {
+      printReport("Incremental copy", report);
+
+      if(incremental_report.rebuilt)
+        std::cout << "Incremental: no usable manifest, rebuilt the output" << std::endl;
+      else
+        std::cout << "Incremental: kept " << incremental_report.kept << " files ("
+                  << incremental_report.kept_bytes << " bytes), rehashed "
+                  << incremental_report.rehashed << std::endl;
+    }
+  }
+  // If the methods are being compared..
+  else if(compare)
+  {
+    // Write the block copy to a scratch file..
+    std::string block_outname = std::string(outname) + ".block";
+    int block_fd = mtf::openOutput(block_outname.c_str());
+
+    ok = block_fd >= 0
+      && mtf::mergeBlocks(inputs, block_fd, block_options, block_report)
+      && mtf::mergeKernel(inputs, out_fd, block_options.prefetch, report);
+
+    if(block_fd >= 0) ::close(block_fd);
+
+    // and check that both methods wrote the same bytes.
+    if(ok)
+    {
+      bool same = mtf::sameContents(block_outname.c_str(), outname);
+
+      printReport("Block copy", block_report);
+      printReport("Kernel copy", report);
+
+      std::cout << "Speedup: " << mtf::throughput(report)
+                                  / mtf::throughput(block_report)
+                << "x" << std::endl
+                << "Outputs " << (same ? "match." : "DIFFER!") << std::endl;
+    }
+
+    // Remove the scratch file.
+    std::remove(block_outname.c_str());
+  }
+  // If an io_uring merge was asked for..
+  else if(use_uring)
+  {
+    ok = mtf::mergeUring(inputs, out_fd, uring_options, report, uring_report);
+
+    if(ok && uring_report.used_ring)
+    {
+      printReport("io_uring copy", report);
+      std::cout << "io_uring: " << uring_report.submissions << " submissions ("
+                << uring_report.operations << " operations) for "
+                << uring_report.files << " completed files" << std::endl;
+    }
+    else if(ok)
+    {
+      printReport("Kernel copy (io_uring unavailable)", report);
+    }
+  }
+  // If a parallel merge was asked for..
+  else if(threads > 0)
+  {
+    ok = mtf::mergeParallel(inputs, out_fd, threads, report);
+    if(ok) printReport("Parallel copy", report);
+  }
+  // If only the kernel copy was asked for..
+  else if(use_kernel)
+  {
+    ok = mtf::mergeKernel(inputs, out_fd, block_options.prefetch, report);
+    if(ok) printReport("Kernel copy", report);
+  }
+  // Otherwise, copy through a buffer in large blocks.
+  else
+  {
+    ok = mtf::mergeBlocks(inputs, out_fd, block_options, report);
+    if(ok) printReport("Block copy", report);
+
+    if(ok && block_options.gzip.enabled)
+      std::cout << "Gzip: " << report.bytes << " bytes compressed to "
+                << report.compressed << " in " << report.members.size()
+                << " members" << std::endl;
+
+    if(ok && block_options.dedup)
+      std::cout << "Dedup: " << report.duplicates << " duplicate files, "
+                << report.saved << " bytes saved" << std::endl;
+
+    // Name the files that failed the UTF-8 check.
+    if(ok && block_options.transform.utf8)
+    {
+      std::cout << "UTF-8: " << report.invalid_utf8.size() << " invalid files";
+
+      for(std::size_t at = 0; at < report.invalid_utf8.size() && at < 10; ++at)
+        std::cout << (at ? ", " : " (") << "#" << report.invalid_utf8[at];
+
+      if(!report.invalid_utf8.empty())
+        std::cout << (report.invalid_utf8.size() > 10 ? ", ..)" : ")");
+
+      std::cout << std::endl;
+    }
+  }
+
+  // Why the merge failed, kept from the clean up below.
+  int error = ok ? 0 : errno;
+
+  // A failed merge still ends its progress line.
+  mtf::endProgress();
+
+  // Close the output, which may report a delayed write error.
+  if(::close(out_fd) != 0 && ok)
+  {
+    error = errno;
+    ok = false;
+  }
+
+  // The stats cover the (last) merge run, whether or not it succeeded.
+  if( stats_name && !mtf::writeStats( stats_name, mode, report,
+                                       use_uring ? &uring_report : NULL ) )
+    std::cerr << "\nCould not write " << stats_name << ": "
+              << std::strerror(errno) << std::endl;
+
+  // A full rewrite leaves any old manifest describing the wrong bytes.
+  if(!incremental && given_fd < 0 && std::strcmp(outname, mtf::STDOUT_NAME) != 0)
+    std::remove(mtf::manifestPathFor(outname).c_str());
+
+  // Streams only get an index if one was asked for by name.
+  if(!index_name && (given_fd >= 0 || std::strcmp(outname, mtf::STDOUT_NAME) == 0))
+    write_index = false;
+
+  // Write the section index beside the output.
+  if(ok && write_index)
+  {
+    std::string index_path = index_name ? index_name : mtf::indexPathFor(outname);
+
+    ok = mtf::writeIndex(index_path.c_str(), report.sections, report.members);
+
+    if(!ok) error = errno;
+  }
+
+  // If the merge failed, say so.
+  if(!ok)
+    std::cerr << "\nMerge failed: " << std::strerror(error) << std::endl;
+
+  return ok ? 0 : 1;
+}
+
+
+
+/* *************************************************
+// Reads a byte count such as 4096, 64K or 1M.
+//
+// @param text: The count, with an optional K, M or
+// G suffix (powers of 1024).
+//
+// @return: The number of bytes, or 0 if text isn't
+// a valid count.
+//
+// *************************************************/
+static std::size_t parseSize(const char * text)
+{
+  char * end = NULL;
+  unsigned long long size = std::strtoull(text, &end, 10);
+
+  // If there's no number at all, it's invalid.
+  if(end == text) return 0;
+
+  // Apply any suffix.
+  switch(*end)
+  {
+    case 'G': case 'g': size <<= 10; // fall through
+    case 'M': case 'm': size <<= 10; // fall through
+    case 'K': case 'k': size <<= 10; ++end; break;
+    case '\0': break;
+    default:  return 0;
+  }
+
+  // Nothing may follow the suffix.
+  return *end == '\0' ? size : 0;
+}
+
+
+
+/* *************************************************
+// Reads the literals for a filtered merge from a
+// file, one per line. Blank lines are skipped.
+//
+// @param path: The file.
+//
+// @param literals: The literals are appended.
+//
+// @return: false if the file couldn't be read.
+//
+// *************************************************/
+static bool readLiterals(const char * path, std::vector<std::string> & literals)
+{
+  std::ifstream in(path);
+  std::string line;
+
+  if(!in) return false;
+
+  while(std::getline(in, line))
+    if(!line.empty()) literals.push_back(line);
+
+  return !in.bad();
+}
+
+
+
+/* *************************************************
+// Reads the whole number given to an option, such
+// as 4 or 0. Signs, spaces, suffixes and numbers
+// above max are refused with a usage error.
+//
+// @param option: The option's name, for the error.
+//
+// @param text: The number.
+//
+// @param max: The largest value allowed.
+//
+// @param value: Set to the number if it's valid.
+//
+// @return: true if text was a valid number.
+//
+// *************************************************/
+static bool parseWhole( const char * option, const char * text,
+                        unsigned long max, unsigned long & value )
+{
+  char * end = NULL;
+  errno = 0;
+
+  unsigned long number = std::strtoul(text, &end, 10);
+
+  // strtoul skips spaces and takes signs, so the first character must be a digit.
+  if( !std::isdigit(static_cast<unsigned char>(text[0])) || *end != '\0'
+      || errno == ERANGE || number > max )
+  {
+    std::cout << "\nInvalid Argument!" << std::endl
+              << option << " must be a whole number from 0 to " << max << ".."
+              << std::endl << std::endl;
+
+    return false;
+  }
+
+  value = number;
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Works out the most inputs --prefetch may keep
+// open: the Prefetcher holds depth + 1 of them,
+// and RESERVED_FDS are left for everything else.
+//
+// @return: The largest prefetch depth allowed.
+//
+// *************************************************/
+static unsigned long prefetchLimit(void)
+{
+  struct rlimit limit;
+  unsigned long max = UINT_MAX;
+
+  if(::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+    max = limit.rlim_cur > RESERVED_FDS + 1 ? limit.rlim_cur - RESERVED_FDS - 1 : 0;
+
+  return max < UINT_MAX ? max : UINT_MAX;
+}
+
+
+
+/* *************************************************
+// Checks the block copy options against each other
+// and against the merge mode, and prints what's
+// wrong with them.
+//
+// @param options: The block copy options given.
+//
+// @param other_copy: true if a copy other than the
+// block copy (or an incremental merge) was asked
+// for.
+//
+// @param sorted: true for a sorted merge.
+//
+// @return: true if the options can be used.
+//
+// *************************************************/
+static bool checkBlockOptions( const mtf::BlockOptions & options,
+                               bool other_copy, bool sorted )
+{
+  const char * problem = NULL;
+
+  const bool transforming = options.transform.crlf || options.transform.utf8
+                         || options.transform.nul != mtf::NUL_KEEP;
+
+  if(options.dedup && other_copy)
+    problem = "--dedup only works with the block copy..";
+  // The same goes for cleaning the bodies up..
+  else if(transforming && other_copy)
+    problem = "--crlf, --nul and --utf8 only work with the block copy..";
+  // and for writing around the page cache.
+  else if(options.write.direct && (other_copy || sorted))
+    problem = "--direct only works with the block copy..";
+  // Compression happens in the block copy too.
+  else if(options.gzip.enabled && (other_copy || sorted || options.write.direct))
+    problem = "--gzip only works with the block copy, and not with --direct..";
+  else if(options.gzip.enabled && (options.gzip.level < 0 || options.gzip.level > 9))
+    problem = "--gzip-level must be from 0 to 9..";
+
+  if(problem)
+    std::cout << "\nInvalid Argument!" << std::endl
+              << problem << std::endl << std::endl;
+
+  return !problem;
+}
+
+
+
+/* *************************************************
+// Prints the totals of a single merge.
+//
+// @param label: The name of the copy method.
+//
+// @param report: The totals of the merge.
+//
+// *************************************************/
+static void printReport(const char * label, const mtf::MergeReport & report)
+{
+  // Finish the progress line, so the totals don't land on it.
+  mtf::endProgress();
+
+  std::cout << label << ": " << report.files << " files, "
+            << report.bytes << " bytes in " << report.seconds
+            << " s (" << mtf::throughput(report) << " MB/s";
+
+  if(report.writes) std::cout << ", " << report.writes << " writes";
+
+  std::cout << ")" << std::endl;
+}
+
+
+
+/* *************************************************
+// Splits a merge back into 1.txt..N.txt and
+// prints the totals.
+//
+// @param merged_name: The merge.
+//
+// @param index_name: Its index (NULL for beside
+// it).
+//
+// @param options: The threads, directory and
+// whether to use the index.
+//
+// @param stats_name: Where the JSON stats go (NULL
+// for nowhere).
+//
+// @return: The exit code for main.
+//
+// *************************************************/
+static int runSplit( const char * merged_name, const char * index_name,
+                     const mtf::SplitOptions & options, const char * stats_name )
+{
+  std::string index_path = index_name ? index_name : mtf::indexPathFor(merged_name);
+  mtf::SplitReport split_report = {};
+
+  // Make the directory for the parts, if it isn't there yet.
+  if(::mkdir(options.dir, 0755) != 0 && errno != EEXIST)
+  {
+    std::cerr << "\nCould not create " << options.dir << ": "
+              << std::strerror(errno) << std::endl;
+
+    return 1;
+  }
+
+  if(stats_name) mtf::countCalls(true);
+
+  bool ok = mtf::splitMerge(merged_name, index_path.c_str(), options, split_report);
+
+  // A split's totals look like a merge's.
+  mtf::MergeReport report = {};
+
+  report.files = split_report.files;
+  report.bytes = split_report.bytes;
+  report.seconds = split_report.seconds;
+
+  if(ok)
+  {
+    printReport("Split", report);
+    std::cout << "Sections " << (split_report.indexed ? "from the index" : "found by scanning")
+              << ", " << split_report.references << " references copied, "
+              << split_report.missing << " without a body" << std::endl;
+  }
+
+  if(stats_name && !mtf::writeStats(stats_name, "split", report))
+    std::cerr << "\nCould not write " << stats_name << ": "
+              << std::strerror(errno) << std::endl;
+
+  if(!ok)
+    std::cerr << "\nSplit of " << merged_name << " failed: "
+              << std::strerror(errno) << std::endl;
+
+  return ok ? 0 : 1;
+}
+
+
+
+/* *************************************************
+// Runs the merges listed in a job file, then
+// prints the status of each job (in the order of
+// the file) and the totals of the batch.
+//
+// @param job_name: The job file.
+//
+// @param options: The threads, how to merge and
+// whether to write indexes.
+//
+// @param stats_name: Where the JSON stats go (NULL
+// for nowhere).
+//
+// @return: The exit code for main: 1 if the job
+// file couldn't be read or any job failed.
+//
+// *************************************************/
+static int runBatch( const char * job_name, const mtf::BatchOptions & options,
+                     const char * stats_name )
+{
+  std::vector<mtf::BatchJob> jobs;
+  unsigned long bad_line = 0;
+
+  if(!mtf::readJobs(job_name, jobs, bad_line))
+  {
+    if(bad_line)
+      std::cout << "\nInvalid Argument!" << std::endl
+                << job_name << " line " << bad_line << " must be an output,"
+                << " dir, glob or list, and a source.." << std::endl << std::endl;
+    else
+      std::cout << "\nCould not read " << job_name << ": "
+                << std::strerror(errno) << std::endl << std::endl;
+
+    return 1;
+  }
+
+  // If there's nothing to run..
+  if(jobs.empty())
+  {
+    std::cout << "\nNo jobs in " << job_name << ".." << std::endl << std::endl;
+
+    return 1;
+  }
+
+  if(stats_name)
+  {
+    mtf::countCalls(true);
+    mtf::timeFiles(true);
+  }
+
+  std::cout << "Running " << jobs.size() << " jobs.." << std::endl;
+
+  mtf::MergeReport report = {};
+
+  bool ok = mtf::runBatch(jobs, options, report);
+  unsigned long failed = 0;
+
+  for(const mtf::BatchJob & job : jobs)
+  {
+    if(job.ok)
+      std::cout << "  ok    " << job.output << ": " << job.files << " files, "
+                << job.bytes << " bytes in " << job.seconds << " s" << std::endl;
+    else
+    {
+      std::cout << "  FAIL  " << job.output << " (line " << job.line << "): "
+                << job.error << std::endl;
+      ++failed;
+    }
+  }
+
+  printReport("Batch copy", report);
+  std::cout << "Batch: " << jobs.size() - failed << " of " << jobs.size()
+            << " jobs succeeded" << std::endl;
+
+  if(stats_name && !mtf::writeStats(stats_name, "batch", report))
+    std::cerr << "\nCould not write " << stats_name << ": "
+              << std::strerror(errno) << std::endl;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,197 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Parallel.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of mergeParallel, declared
+// in Merge.h. The layout of the whole output is planned
+// up front (see Layout.h), the output is sized to fit,
+// and then a pool of threads claims files one at a time
+// and writes each section at its precomputed offset.
+// Since no section depends on another, the result is
+// identical to a serial merge.
+//
+// ******************************************************/
+
+#include "Merge.h"
+#include "Layout.h"
+#include "FileCopy.h"
+
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+
+/* *************************************************
+// Writes the section for one file at the offsets
+// planned for it.
+//
+// @param inputs: The files being merged.
+//
+// @param index: The (0 based) input to write.
+//
+// @param section: Where the section goes.
+//
+// @param out_fd: The merged output.
+//
+// @return: true if the whole section was written.
+//
+// *************************************************/
+static bool writeSection( const mtf::InputSet & inputs, unsigned long index,
+                          const mtf::Section & section, int out_fd )
+{
+  std::string header = mtf::sectionHeader(index + 1);
+  unsigned long long tail_offset = section.body_offset;
+
+  // Write the section number.
+  if(!mtf::pwriteAll(out_fd, header.data(), header.size(), section.header_offset))
+    return false;
+
+  // If the file was readable when it was measured, copy its body.
+  if(section.readable)
+  {
+    int in_fd = inputs.open(index);
+
+    if(in_fd < 0) return false;
+
+    bool ok = mtf::copyRange(in_fd, out_fd, section.body_offset, section.body_size);
+
+    ::close(in_fd);
+
+    // The terminating newline follows the body.
+    tail_offset += section.body_size;
+    ok = ok && mtf::pwriteAll( out_fd, mtf::BODY_TERMINATOR,
+                               sizeof(mtf::BODY_TERMINATOR) - 1, tail_offset );
+    tail_offset += sizeof(mtf::BODY_TERMINATOR) - 1;
+
+    if(!ok) return false;
+  }
+
+  // Write some whitespace to the file between chapters.
+  return mtf::pwriteAll( out_fd, mtf::SECTION_SEPARATOR,
+                         sizeof(mtf::SECTION_SEPARATOR) - 1, tail_offset );
+}
+
+
+
+/* *************************************************
+// Copies the files in inputs into out_fd with
+// a pool of worker threads. Each worker repeatedly
+// claims the next unclaimed file and writes its
+// section with pwrite/copy_file_range, so any
+// number of sections are in flight at once.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output, which must be a
+// regular file.
+//
+// @param threads: The number of worker threads.
+//
+// @param report: Filled with totals for the merge.
+//
+// @return: true if every section was written.
+//
+// *************************************************/
+bool mtf::mergeParallel( const InputSet & inputs, int out_fd,
+                         unsigned threads, MergeReport & report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+
+  // Measure every input before writing anything.
+  std::vector<Section> sections;
+  unsigned long long total = planLayout(inputs, sections);
+
+  // Size the output for the whole merge.
+  if(::ftruncate(out_fd, total) != 0) return false;
+
+  // The next file to be claimed by a worker.
+  std::atomic<unsigned long> next_index(0);
+  // Cleared by the first worker that fails.
+  std::atomic<bool> ok(true);
+  // errno from the first failure, so the caller can report it.
+  std::atomic<int> failure(0);
+  // The files and bytes finished, for the progress line.
+  std::atomic<unsigned long> done_files(0);
+  std::atomic<unsigned long long> done_bytes(0);
+
+  // Each worker times its files on its own, and adds them in at the end.
+  report.latency = LatencyHistogram();
+
+  bool timing = fileHistogram(report) != NULL;
+  std::mutex latency_lock;
+
+  // Each worker writes sections until there are none left.
+  auto worker = [&]()
+  {
+    unsigned long index = 0;
+    std::unique_ptr<LatencyHistogram> latency(timing ? new LatencyHistogram() : NULL);
+
+    while(ok && (index = next_index++) < count)
+    {
+      FileTimer timer(latency.get());
+
+      if(!writeSection(inputs, index, sections[index], out_fd))
+      {
+        failure = errno;
+        ok = false;
+      }
+
+      timer.done();
+
+      unsigned long long end = index + 1 < count ? sections[index + 1].header_offset : total;
+
+      stepProgress(++done_files, done_bytes += end - sections[index].header_offset);
+    }
+
+    if(latency)
+    {
+      std::lock_guard<std::mutex> hold(latency_lock);
+      report.latency.merge(*latency);
+    }
+  };
+
+  // There's no point in more threads than files.
+  if(threads > count) threads = count;
+  if(threads < 1) threads = 1;
+
+  std::vector<std::thread> pool;
+
+  for(unsigned thread = 1; thread < threads; ++thread)
+    pool.push_back(std::thread(worker));
+
+  // This thread works too.
+  worker();
+
+  for(std::thread & thread : pool)
+    thread.join();
+
+  // A worker's last step may have found the progress line busy.
+  stepProgress(done_files, done_bytes);
+
+  if(!ok) errno = failure;
+
+  report.files = count;
+  report.bytes = total;
+  report.sections.resize(count);
+
+  for(unsigned long index = 0; index < count; ++index)
+  {
+    report.sections[index].offset = sections[index].readable ? sections[index].body_offset : NO_BODY;
+    report.sections[index].length = sections[index].body_size;
+  }
+
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
@@ -0,0 +1,660 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Sorted.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of mergeSorted, declared in
+// Sorted.h. Each input is read through a fixed size
+// buffer by a LineReader, which hands out lines as
+// pointers into that buffer, so no line is ever copied
+// or allocated on its own. A loser tree over the
+// readers picks the smallest line in log2(k)
+// comparisons, replaying only the path of the reader
+// that just moved. When there are more inputs than
+// descriptors to spare, groups of them are merged into
+// temporary runs first, and the runs are merged in
+// later passes.
+//
+// ******************************************************/
+
+#include "Sorted.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+
+// Descriptors kept back from the fan-in for the output, a temporary
+// run and the standard streams.
+static const unsigned RESERVED_FDS = 16;
+
+
+namespace
+{
+  /* ************************************************
+  // Reads one sorted input a line at a time. The
+  // current line (and its key) point into the
+  // buffer, and stay valid until the next call to
+  // next. The buffer only grows for a line longer
+  // than the whole buffer.
+  //
+  // ************************************************/
+  class LineReader
+  {
+    public:
+
+      // Read fd, which the reader then owns, through size bytes.
+      LineReader(int fd, std::size_t size, const mtf::SortOptions & options)
+        : in_fd(fd), buffer(new char[size ? size : 1]), capacity(size ? size : 1),
+          start(0), scanned(0), end(0), at_eof(false), error(false), done(false),
+          options(options), line(NULL), length(0), key(NULL), key_length(0)
+      {
+        ::posix_fadvise(in_fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+      }
+
+      ~LineReader(void) { ::close(in_fd); }
+
+      // Move to the next line. false at the end of the input.
+      bool next(void);
+
+      // true once every line has been read (or a read failed).
+      bool exhausted(void) const { return done; }
+
+      // true if a read failed.
+      bool failed(void) const { return error; }
+
+      // The current line, without its newline, and the key in it.
+      const char * lineData(void) const { return line; }
+      std::size_t lineLength(void) const { return length; }
+      const char * keyData(void) const { return key; }
+      std::size_t keyLength(void) const { return key_length; }
+
+
+    private:
+
+      LineReader(const LineReader &);
+      LineReader & operator=(const LineReader &);
+
+      // Make [text, text + size) the current line and find its key.
+      void setLine(const char * text, std::size_t size);
+
+      int in_fd;
+
+      // The buffer, its size, the unread bytes in [start, end), and
+      // how far past start has already been searched for a newline.
+      std::unique_ptr<char[]> buffer;
+      std::size_t capacity, start, scanned, end;
+
+      bool at_eof, error, done;
+
+      const mtf::SortOptions & options;
+
+      const char * line;
+      std::size_t length;
+      const char * key;
+      std::size_t key_length;
+  };
+
+
+  /* ************************************************
+  // A loser tree over a set of LineReaders. Node
+  // 0 holds the reader with the smallest line; each
+  // internal node holds the loser of the match
+  // played there.
+  //
+  // ************************************************/
+  class LoserTree
+  {
+    public:
+
+      explicit LoserTree(const std::vector<std::unique_ptr<LineReader> > & readers);
+
+      // The reader holding the smallest line.
+      unsigned winner(void) const { return tree[0]; }
+
+      // Replay the matches above reader leaf, after it moved on.
+      void replay(unsigned leaf);
+
+
+    private:
+
+      // true if reader fst's line comes before reader snd's.
+      bool before(unsigned fst, unsigned snd) const;
+
+      const std::vector<std::unique_ptr<LineReader> > & readers;
+      std::vector<unsigned> tree;
+  };
+}
+
+
+// Merge the (already open) sorted inputs fds into out_fd.
+static bool mergeGroup( const std::vector<int> & fds, int out_fd,
+                        const mtf::SortOptions & options,
+                        mtf::SortReport & sort_report,
+                        unsigned long long & lines, unsigned long long & bytes,
+                        unsigned long & writes );
+
+// Create an empty temporary run in dir.
+static int createRun(const std::string & dir, std::string & path);
+
+// The number of inputs that can be merged at once.
+static unsigned fanIn(const mtf::SortOptions & options);
+
+
+
+/* *************************************************
+// Merges inputs that are each sorted line by line
+// into one sorted output. Lines are compared as
+// bytes (like sort in the C locale) on their key
+// field, or on the whole line; lines with equal
+// keys come out in input order. A last line with
+// no newline is given one.
+//
+// If there are more inputs than the fan-in, each
+// group of fan-in inputs is merged into a
+// temporary run, and passes over the runs continue
+// until one pass can write the output. Inputs that
+// can't be opened are left out and counted.
+//
+// @param inputs: The sorted files to merge.
+//
+// @param out_fd: The output.
+//
+// @param options: The key, uniqueness, fan-in and
+// buffering.
+//
+// @param report: Filled with totals for the merge.
+// There are no sections.
+//
+// @param sort_report: Filled with the lines
+// written and dropped, and the passes made.
+//
+// @return: true if every line of the inputs that
+// could be opened was read and written. Inputs
+// that can't be opened are left out and counted
+// in sort_report.unreadable.
+//
+// *************************************************/
+bool mtf::mergeSorted( const InputSet & inputs, int out_fd,
+                       const SortOptions & options,
+                       MergeReport & report, SortReport & sort_report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+  const unsigned long fan_in = fanIn(options);
+
+  const char * tmpdir = std::getenv("TMPDIR");
+  const std::string dir = options.temp_dir ? options.temp_dir
+                        : tmpdir && *tmpdir ? tmpdir : "/tmp";
+
+  sort_report = SortReport();
+  report.sections.clear();
+  report.latency = LatencyHistogram();
+
+  // The runs written by the last pass.
+  std::vector<std::string> runs;
+  unsigned long long lines = 0, bytes = 0, run_total = 0;
+  unsigned long writes = 0, run_writes = 0;
+  bool ok = true;
+
+  // The first pass reads the inputs, into the output if they all fit..
+  for(unsigned long first = 0; ok && first < count; first += fan_in)
+  {
+    std::vector<int> fds;
+
+    for(unsigned long index = first; index < count && index < first + fan_in; ++index)
+    {
+      int in_fd = inputs.open(index);
+
+      if(in_fd >= 0) fds.push_back(in_fd);
+      else ++sort_report.unreadable;
+    }
+
+    if(count <= fan_in)
+    {
+      ok = mergeGroup(fds, out_fd, options, sort_report, lines, bytes, writes);
+      break;
+    }
+
+    // or into runs if they don't.
+    std::string path;
+    int run_fd = createRun(dir, path);
+
+    if(run_fd < 0)
+    {
+      for(int in_fd : fds) ::close(in_fd);
+      ok = false;
+      break;
+    }
+
+    runs.push_back(path);
+
+    unsigned long long run_lines = 0, run_bytes = 0;
+    ok = mergeGroup(fds, run_fd, options, sort_report, run_lines, run_bytes, run_writes);
+    ok = (::close(run_fd) == 0) && ok;
+
+    // Lines are merged from every input at once, so progress is per run.
+    run_total += run_bytes;
+    stepProgress(std::min<unsigned long>(count, first + fan_in), run_total);
+  }
+
+  sort_report.passes = count ? 1 : 0;
+
+  // Later passes merge the runs, until they fit in one.
+  while(ok && !runs.empty())
+  {
+    const bool last = runs.size() <= fan_in;
+    std::vector<std::string> merged;
+
+    ++sort_report.passes;
+
+    for(std::size_t first = 0; ok && first < runs.size(); first += fan_in)
+    {
+      std::size_t stop = std::min<std::size_t>(runs.size(), first + fan_in);
+      std::vector<int> fds;
+
+      for(std::size_t index = first; ok && index < stop; ++index)
+      {
+        int run_fd = ::open(runs[index].c_str(), O_RDONLY | O_CLOEXEC);
+
+        if(run_fd >= 0) fds.push_back(run_fd);
+        else ok = false;
+      }
+
+      if(ok && last)
+      {
+        ok = mergeGroup(fds, out_fd, options, sort_report, lines, bytes, writes);
+        fds.clear();
+      }
+      else if(ok)
+      {
+        std::string path;
+        int next_fd = createRun(dir, path);
+
+        if(next_fd >= 0)
+        {
+          merged.push_back(path);
+
+          unsigned long long run_lines = 0, run_bytes = 0;
+          ok = mergeGroup(fds, next_fd, options, sort_report, run_lines, run_bytes, run_writes);
+          ok = (::close(next_fd) == 0) && ok;
+          fds.clear();
+        }
+        else ok = false;
+      }
+
+      // Close whatever wasn't handed to a merge.
+      if(!ok) for(int in_fd : fds) ::close(in_fd);
+
+      // The runs just read aren't needed any more.
+      for(std::size_t index = first; index < stop; ++index)
+        ::unlink(runs[index].c_str());
+    }
+
+    // Any runs not reached were left by a failure.
+    if(!ok)
+      for(const std::string & path : runs) ::unlink(path.c_str());
+
+    runs.swap(merged);
+
+    if(last) break;
+  }
+
+  // If a pass failed, remove the runs it had made.
+  for(const std::string & path : runs) ::unlink(path.c_str());
+
+  sort_report.lines = lines;
+  stepProgress(count, bytes);
+
+  report.files = count;
+  report.bytes = bytes;
+  report.writes = writes;
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Merges one group of sorted inputs into out_fd
+// through a loser tree. With unique on, a line is
+// written only if its key differs from the last
+// key written.
+//
+// @param fds: The inputs, which are closed by the
+// time this returns.
+//
+// @param out_fd: Where the merged lines go.
+//
+// @param options: The key and uniqueness.
+//
+// @param sort_report: Its dropped count is added to.
+//
+// @param lines: Set to the lines written.
+//
+// @param bytes: Set to the bytes written.
+//
+// @param writes: Set to the write calls made.
+//
+// @return: true if every line could be read and
+// written.
+//
+// *************************************************/
+static bool mergeGroup( const std::vector<int> & fds, int out_fd,
+                        const mtf::SortOptions & options,
+                        mtf::SortReport & sort_report,
+                        unsigned long long & lines, unsigned long long & bytes,
+                        unsigned long & writes )
+{
+  std::vector<std::unique_ptr<LineReader> > readers;
+
+  readers.reserve(fds.size());
+
+  for(int in_fd : fds)
+    readers.push_back(std::unique_ptr<LineReader>(new LineReader(in_fd, options.buffer_size, options)));
+
+  // Load the first line of every input.
+  for(const std::unique_ptr<LineReader> & reader : readers)
+    if(!reader->next() && reader->failed()) return false;
+
+  mtf::Writer out(out_fd, mtf::DEFAULT_CHUNK_SIZE, 0, mtf::WRITE_BACKGROUND);
+
+  // The last key written, for unique. Its storage is reused.
+  std::string last_key;
+  bool have_last = false, ok = true;
+
+  if(!readers.empty())
+  {
+    LoserTree tree(readers);
+
+    while(ok)
+    {
+      unsigned winner = tree.winner();
+      LineReader & reader = *readers[winner];
+
+      // When the smallest line is past the end, every input is done.
+      if(reader.exhausted()) break;
+
+      if( options.unique && have_last && last_key.size() == reader.keyLength()
+          && std::memcmp(last_key.data(), reader.keyData(), last_key.size()) == 0 )
+        ++sort_report.dropped;
+      else
+      {
+        ok = out.append(reader.lineData(), reader.lineLength())
+          && out.append("\n", 1);
+        ++lines;
+
+        if(options.unique)
+        {
+          last_key.assign(reader.keyData(), reader.keyLength());
+          have_last = true;
+        }
+      }
+
+      if(!reader.next() && reader.failed()) return false;
+
+      tree.replay(winner);
+    }
+  }
+
+  ok = ok && out.flush();
+  bytes = out.position();
+  writes = out.writes();
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Creates an empty file for a run in dir.
+//
+// @param dir: The directory to put it in.
+//
+// @param path: Set to its name.
+//
+// @return: A descriptor open for writing, or -1.
+//
+// *************************************************/
+static int createRun(const std::string & dir, std::string & path)
+{
+  std::string name = dir + "/MergeTextFilesRunXXXXXX";
+  std::vector<char> text(name.begin(), name.end());
+
+  text.push_back('\0');
+
+  int fd = ::mkstemp(text.data());
+
+  if(fd >= 0) path = text.data();
+
+  return fd;
+}
+
+
+
+/* *************************************************
+// Works out how many inputs can be open at once:
+// the fan-in asked for, or DEFAULT_FAN_IN, but
+// never more than the descriptor limit allows,
+// and never fewer than 2.
+//
+// *************************************************/
+static unsigned fanIn(const mtf::SortOptions & options)
+{
+  unsigned long fan_in = options.fan_in ? options.fan_in : mtf::DEFAULT_FAN_IN;
+  struct rlimit limit;
+
+  if( ::getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY
+      && limit.rlim_cur < fan_in + RESERVED_FDS )
+    fan_in = limit.rlim_cur > RESERVED_FDS + 2 ? limit.rlim_cur - RESERVED_FDS : 2;
+
+  return std::max<unsigned long>(fan_in, 2);
+}
+
+
+
+/* *************************************************
+// Moves to the next line, reading more of the
+// input when the buffer holds no whole line. The
+// partial line left at the end of the buffer is
+// moved to the front before each read, and the
+// search for its newline picks up where it left
+// off.
+//
+// @return: true if there is a line; false at the
+// end of the input or if a read failed.
+//
+// *************************************************/
+bool LineReader::next(void)
+{
+  for(;;)
+  {
+    char * base = buffer.get();
+    char * newline = static_cast<char *>(std::memchr(base + scanned, '\n', end - scanned));
+
+    // If there's a whole line, hand it out.
+    if(newline)
+    {
+      setLine(base + start, newline - (base + start));
+      start = scanned = newline + 1 - base;
+      return true;
+    }
+
+    scanned = end;
+
+    // At the end of the input, whatever is left is the last line.
+    if(at_eof)
+    {
+      if(start < end)
+      {
+        setLine(base + start, end - start);
+        start = scanned = end;
+        return true;
+      }
+
+      done = true;
+      return false;
+    }
+
+    // Move the partial line to the front..
+    if(start > 0)
+    {
+      std::memmove(base, base + start, end - start);
+      end -= start;
+      scanned -= start;
+      start = 0;
+    }
+
+    // growing the buffer if the line fills all of it.
+    if(end == capacity)
+    {
+      std::unique_ptr<char[]> larger(new char[2 * capacity]);
+
+      std::memcpy(larger.get(), base, end);
+      buffer.swap(larger);
+      capacity *= 2;
+      base = buffer.get();
+    }
+
+    ssize_t got;
+
+    {
+      mtf::CallTimer timer(mtf::CALL_READ);
+      got = ::read(in_fd, base + end, capacity - end);
+    }
+
+    // If the read was interrupted, try again.
+    if(got < 0 && errno == EINTR) continue;
+
+    if(got < 0)
+    {
+      error = done = true;
+      return false;
+    }
+
+    if(got == 0) at_eof = true;
+    else end += got;
+  }
+}
+
+
+
+/* *************************************************
+// Makes text the current line and finds its key:
+// the whole line, or the key field's text up to
+// the next separator. A line with too few fields
+// has an empty key.
+//
+// *************************************************/
+void LineReader::setLine(const char * text, std::size_t size)
+{
+  line = text;
+  length = size;
+
+  if(options.key_field == 0)
+  {
+    key = text;
+    key_length = size;
+    return;
+  }
+
+  const char * field = text, * stop = text + size;
+
+  // Skip the fields before the key.
+  for(unsigned number = 1; number < options.key_field && field < stop; ++number)
+  {
+    const char * separator = static_cast<const char *>(std::memchr(field, options.separator, stop - field));
+
+    field = separator ? separator + 1 : stop;
+  }
+
+  const char * field_end = static_cast<const char *>(std::memchr(field, options.separator, stop - field));
+
+  key = field;
+  key_length = (field_end ? field_end : stop) - field;
+}
+
+
+
+/* *************************************************
+// Plays the first round of the tournament. The
+// leaves are nodes k..2k-1 and node n plays the
+// winners of nodes 2n and 2n+1, which works for
+// any number of readers.
+//
+// *************************************************/
+LoserTree::LoserTree(const std::vector<std::unique_ptr<LineReader> > & readers)
+  : readers(readers), tree(readers.size())
+{
+  const unsigned count = readers.size();
+  std::vector<unsigned> winners(2 * count);
+
+  for(unsigned leaf = 0; leaf < count; ++leaf)
+    winners[count + leaf] = leaf;
+
+  for(unsigned node = count - 1; node >= 1; --node)
+  {
+    unsigned fst = winners[2 * node], snd = winners[2 * node + 1];
+
+    if(before(snd, fst)) std::swap(fst, snd);
+
+    winners[node] = fst;
+    tree[node] = snd;
+  }
+
+  tree[0] = winners[1];
+}
+
+
+
+/* *************************************************
+// Replays the matches on the path from a leaf to
+// the root, after its reader moved to a new line.
+//
+// *************************************************/
+void LoserTree::replay(unsigned leaf)
+{
+  unsigned winner = leaf;
+
+  for(unsigned node = (leaf + tree.size()) / 2; node >= 1; node /= 2)
+    if(before(tree[node], winner)) std::swap(tree[node], winner);
+
+  tree[0] = winner;
+}
+
+
+
+/* *************************************************
+// Orders two readers by their current keys, as
+// unsigned bytes, with exhausted readers last and
+// ties going to the earlier input.
+//
+// *************************************************/
+bool LoserTree::before(unsigned fst, unsigned snd) const
+{
+  const LineReader & one = *readers[fst], & two = *readers[snd];
+
+  if(one.exhausted()) return false;
+  if(two.exhausted()) return true;
+
+  std::size_t shorter = std::min(one.keyLength(), two.keyLength());
+  int order = std::memcmp(one.keyData(), two.keyData(), shorter);
+
+  if(order != 0) return order < 0;
+  if(one.keyLength() != two.keyLength()) return one.keyLength() < two.keyLength();
+
+  return fst < snd;
+}
@@ -0,0 +1,64 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Sorted.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of mergeSorted, which merges
+// inputs that are each sorted line by line into one
+// sorted output, like sort -m, instead of writing them
+// one after another. See Sorted.cpp for more
+// information.
+//
+// ******************************************************/
+
+#ifndef SORTED_H
+#define SORTED_H
+
+#include "Merge.h"
+
+
+namespace mtf
+{
+  // The most inputs merged at once when the descriptor limit allows.
+  const unsigned DEFAULT_FAN_IN = 512;
+
+  // Tuning for the sorted merge.
+  struct SortOptions
+  {
+    // true to write only the first of a run of lines with equal keys.
+    bool unique;
+    // The (1 based) field lines are ordered by, or 0 for the whole line.
+    unsigned key_field;
+    // The character between fields.
+    char separator;
+    // The most inputs merged at once (0 to fit the descriptor limit).
+    unsigned fan_in;
+    // The size of the read buffer for each input.
+    std::size_t buffer_size;
+    // Where runs from earlier passes go (NULL for $TMPDIR or /tmp).
+    const char * temp_dir;
+  };
+
+  // Defaults for SortOptions.
+  const SortOptions SORT_DEFAULTS = { false, 0, '\t', 0, 64 * 1024, NULL };
+
+  // Counts gathered over a sorted merge.
+  struct SortReport
+  {
+    // The number of lines written.
+    unsigned long long lines;
+    // The number of lines left out by unique.
+    unsigned long long dropped;
+    // The number of merge passes (1 unless there were too many inputs).
+    unsigned passes;
+    // The number of inputs that couldn't be opened.
+    unsigned long unreadable;
+  };
+
+  // Merge inputs that are each sorted into one sorted output.
+  bool mergeSorted( const InputSet & inputs, int out_fd,
+                    const SortOptions & options,
+                    MergeReport & report, SortReport & sort_report );
+};
+#endif // SORTED_H
@@ -0,0 +1,742 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Split.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of the split, declared in
+// Split.h. A merge is a run of sections, each
+//
+//   "\nFILE #n\n\n\n" body "\n" "\n\n\n"
+//
+// or, for a file that couldn't be read, the header
+// and separator alone, or, for a dedup'd file, the
+// line "\nFILE #n = FILE #k\n" and the separator.
+//
+// If the index beside the merge still describes it
+// exactly (every header, body and separator where it
+// says), it gives the sections directly. Otherwise -
+// the usual case after the merge has been edited - the
+// mapped merge is cut into slices, one per thread, and
+// each is searched with memmem (which glibc vectorizes)
+// for "\nFILE #". The headers found are then walked in
+// order: section n+1 starts at the first header for
+// n+1 that follows a whole section. If a body holds a
+// copy of the next header, and that leads to a dead
+// end later on, the walk backs up and takes the next
+// header instead; only a copy that still parses to the
+// end of the merge is mistaken for a boundary, which
+// the index prevents.
+//
+// ******************************************************/
+
+#include "Split.h"
+#include "Index.h"
+#include "FileCopy.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+#include <zlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+// The first two bytes of every gzip member.
+static const unsigned char GZIP_MAGIC[] = { 0x1f, 0x8b };
+
+// The size of each piece a compressed merge is inflated in.
+static const std::size_t INFLATE_CHUNK = 1 << 20;
+
+// Every section header begins with this.
+static const char MARK[] = "\nFILE #";
+static const std::size_t MARK_LEN = sizeof(MARK) - 1;
+
+// What follows the number in a header, and in a reference.
+static const char HEADER_END[] = "\n\n\n";
+static const char REFERENCE[] = " = FILE #";
+
+static const std::size_t SEPARATOR_LEN = sizeof(mtf::SECTION_SEPARATOR) - 1;
+static const std::size_t TERMINATOR_LEN = sizeof(mtf::BODY_TERMINATOR) - 1;
+
+// Merges smaller than this per thread are scanned by fewer threads.
+static const std::size_t SCAN_SLICE = 1 << 20;
+
+
+// A header found by the scan.
+struct Candidate
+{
+  // Where it starts, and its length.
+  unsigned long long offset;
+  std::size_t length;
+  // Its file number, and the file it repeats (0 if it isn't a reference).
+  unsigned long number, original;
+};
+
+// Parse the header (if it is one) at data[at].
+static bool parseHeader(const char * data, std::size_t size, std::size_t at, Candidate & header);
+
+// Check the rest of a section, data[start, end), and find its body.
+static bool sectionBody( const char * data, unsigned long long start, unsigned long long end,
+                         const Candidate & header, mtf::IndexEntry & body );
+
+// Find the headers that start in data[low, high).
+static void scanSlice( const char * data, std::size_t size, std::size_t low,
+                       std::size_t high, std::vector<Candidate> & found );
+
+// Take the sections from the index, if it fits the merge exactly.
+static bool fromIndex( const char * data, std::size_t size, const mtf::SectionReader & reader,
+                       std::vector<mtf::SplitSection> & sections );
+
+// Write every section's part into dir.
+static bool writeParts( const char * data, const std::vector<mtf::SplitSection> & sections,
+                        const std::string & dir, unsigned threads,
+                        unsigned long long & bytes );
+
+// The number of threads to use for options.
+static unsigned threadCount(unsigned threads);
+
+// Inflate every gzip member of a compressed merge into text.
+static bool inflateMerge(const char * data, std::size_t size, std::string & text);
+
+
+
+/* *************************************************
+// Finds every section of a merge. The slices are
+// scanned in parallel; the headers found are then
+// checked in order, so a merge that isn't one (or
+// is damaged) is rejected rather than half split.
+//
+// @param data: The merge.
+//
+// @param size: Its size.
+//
+// @param threads: The scanning threads (0 for one
+// per CPU).
+//
+// @param sections: Replaced with the sections, in
+// file order.
+//
+// @return: false (with errno EINVAL) if data isn't
+// a series of sections numbered from 1.
+//
+// *************************************************/
+bool mtf::findSections( const char * data, std::size_t size, unsigned threads,
+                        std::vector<SplitSection> & sections )
+{
+  sections.clear();
+
+  std::size_t slices = std::min<std::size_t>(threadCount(threads), size / SCAN_SLICE + 1);
+  std::vector<std::vector<Candidate> > found(slices);
+  std::vector<std::thread> pool;
+
+  // Each thread takes one slice; this thread takes the first.
+  for(std::size_t slice = 1; slice < slices; ++slice)
+    pool.push_back(std::thread( scanSlice, data, size, size / slices * slice,
+                                slice + 1 < slices ? size / slices * (slice + 1) : size,
+                                std::ref(found[slice]) ));
+
+  scanSlice(data, size, 0, slices > 1 ? size / slices : size, found[0]);
+
+  for(std::thread & thread : pool) thread.join();
+
+  std::vector<Candidate> headers;
+
+  for(const std::vector<Candidate> & slice : found)
+    headers.insert(headers.end(), slice.begin(), slice.end());
+
+  errno = EINVAL;
+
+  // The first section starts the merge.
+  if(headers.empty() || headers[0].offset != 0 || headers[0].number != 1) return false;
+
+  // The header each section starts at so far, and the number of
+  // times an earlier choice may still be taken back.
+  std::vector<std::size_t> starts(1, 0);
+  std::size_t resume = 0, retries = 4 * headers.size() + 16;
+  IndexEntry body;
+
+  for(;;)
+  {
+    const Candidate & header = headers[starts.back()];
+    unsigned long long start = header.offset + header.length;
+    std::size_t look = resume ? resume : starts.back() + 1;
+
+    resume = 0;
+
+    // The section runs up to the next header, which follows a separator..
+    for(; look < headers.size(); ++look)
+      if( headers[look].number == header.number + 1
+          && sectionBody(data, start, headers[look].offset, header, body) )
+        break;
+
+    if(look < headers.size())
+    {
+      starts.push_back(look);
+      continue;
+    }
+
+    // or is the last one.
+    if(sectionBody(data, start, size, header, body)) break;
+
+    // If neither, a body held a copy of the header after it, and an
+    // earlier section was cut there: try the next header instead.
+    resume = starts.back() + 1;
+    starts.pop_back();
+
+    if(starts.empty() || --retries == 0) return false;
+  }
+
+  for(std::size_t index = 0; index < starts.size(); ++index)
+  {
+    const Candidate & header = headers[starts[index]];
+    unsigned long long end = index + 1 < starts.size() ? headers[starts[index + 1]].offset : size;
+    SplitSection section = { { NO_BODY, 0 }, header.original };
+
+    sectionBody(data, header.offset + header.length, end, header, section.body);
+
+    // A reference names an earlier file with a body of its own.
+    if( header.original
+        && ( header.original >= header.number
+             || sections[header.original - 1].original != 0
+             || sections[header.original - 1].body.offset == NO_BODY ) )
+      return false;
+
+    sections.push_back(section);
+  }
+
+  errno = 0;
+
+  return !sections.empty();
+}
+
+
+
+/* *************************************************
+// Splits a merge into the files it was made from,
+// written as 1.txt..N.txt in options.dir. Parts
+// are overwritten if they exist; a section with no
+// body gets no part, and an existing file of that
+// name is left alone, as the merge left it. A
+// reference's part is a copy of the file it names.
+// A --gzip merge is inflated into memory first.
+//
+// @param merged_path: The merge.
+//
+// @param index_path: Its index (NULL for none).
+//
+// @param options: The threads and directory, and
+// whether to try the index.
+//
+// @param report: Filled with totals for the split.
+//
+// @return: true if every part was written.
+//
+// *************************************************/
+bool mtf::splitMerge( const char * merged_path, const char * index_path,
+                      const SplitOptions & options, SplitReport & report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  report = SplitReport();
+
+  int fd;
+
+  {
+    CallTimer timer(CALL_OPEN);
+    fd = ::open(merged_path, O_RDONLY | O_CLOEXEC);
+  }
+
+  struct stat info;
+
+  if(fd < 0) return false;
+
+  if(::fstat(fd, &info) != 0)
+  {
+    ::close(fd);
+    return false;
+  }
+
+  // An empty file can't be mapped, or be a merge.
+  if(info.st_size == 0)
+  {
+    ::close(fd);
+    errno = EINVAL;
+    return false;
+  }
+
+  std::size_t size = info.st_size;
+  void * mapped = ::mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+
+  ::close(fd);
+
+  if(mapped == MAP_FAILED) return false;
+
+  // Every page will be read, by the scan or the writes.
+  ::madvise(mapped, size, MADV_WILLNEED);
+
+  const char * data = static_cast<const char *>(mapped);
+  std::vector<SplitSection> sections;
+  std::string inflated;
+  bool ok = true;
+
+  // A --gzip merge is split from its text, which its index describes too.
+  if(size >= 2 && std::memcmp(data, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0)
+  {
+    ok = inflateMerge(data, size, inflated);
+
+    int failure = errno;
+    ::munmap(mapped, size);
+    errno = failure;
+
+    mapped = MAP_FAILED;
+    data = inflated.data();
+    size = inflated.size();
+  }
+
+  // Use the index if there is one and the merge hasn't changed since.
+  if(ok && options.use_index && index_path)
+  {
+    SectionReader reader;
+
+    report.indexed = reader.open(merged_path, index_path)
+                  && fromIndex(data, size, reader, sections);
+  }
+
+  if(ok && !report.indexed) ok = findSections(data, size, options.threads, sections);
+
+  for(const SplitSection & section : sections)
+  {
+    if(section.original) ++report.references;
+    else if(section.body.offset == NO_BODY) ++report.missing;
+  }
+
+  ok = ok && writeParts(data, sections, options.dir, threadCount(options.threads), report.bytes);
+
+  int failure = errno;
+  if(mapped != MAP_FAILED) ::munmap(mapped, size);
+  errno = failure;
+
+  report.files = sections.size();
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// Parses a section header: "\nFILE #n\n\n\n" or a
+// reference, "\nFILE #n = FILE #k\n". Numbers are
+// written by std::to_string, so have no leading
+// zeros.
+//
+// @param data: The merge.
+//
+// @param size: Its size.
+//
+// @param at: Where "\nFILE #" was found.
+//
+// @param header: Filled in if it is a header.
+//
+// @return: true if a whole header is at data[at].
+//
+// *************************************************/
+static bool parseHeader(const char * data, std::size_t size, std::size_t at, Candidate & header)
+{
+  std::size_t end = at + MARK_LEN;
+  unsigned long * number = &header.number;
+
+  header.offset = at;
+  header.original = 0;
+
+  for(int part = 0; part < 2; ++part)
+  {
+    std::size_t digits = 0;
+
+    // At least one digit, not starting with 0, and few enough to fit.
+    if(end >= size || data[end] < '1' || data[end] > '9') return false;
+
+    for(*number = 0; end < size && data[end] >= '0' && data[end] <= '9'; ++end)
+    {
+      if(++digits > 18) return false;
+      *number = *number * 10 + (data[end] - '0');
+    }
+
+    // A plain header ends in three newlines..
+    if(part == 0 && size - end >= sizeof(HEADER_END) - 1
+       && std::memcmp(data + end, HEADER_END, sizeof(HEADER_END) - 1) == 0)
+    {
+      header.length = end + sizeof(HEADER_END) - 1 - at;
+      return true;
+    }
+
+    // a reference line in one..
+    if(part == 1 && end < size && data[end] == '\n')
+    {
+      header.length = end + 1 - at;
+      return true;
+    }
+
+    // and a reference names its original after this.
+    if( part == 1 || size - end < sizeof(REFERENCE) - 1
+        || std::memcmp(data + end, REFERENCE, sizeof(REFERENCE) - 1) != 0 )
+      return false;
+
+    end += sizeof(REFERENCE) - 1;
+    number = &header.original;
+  }
+
+  return false;
+}
+
+
+
+/* *************************************************
+// Checks what follows a section's header: the
+// separator alone for a reference, or for a plain
+// header either the separator alone (no body) or
+// a body, its terminator and the separator.
+//
+// @param data: The merge.
+//
+// @param start: The end of the header.
+//
+// @param end: Where the next section would start.
+//
+// @param header: The section's header.
+//
+// @param body: Set to where the body is.
+//
+// @return: true if it's a whole section.
+//
+// *************************************************/
+static bool sectionBody( const char * data, unsigned long long start, unsigned long long end,
+                         const Candidate & header, mtf::IndexEntry & body )
+{
+  const unsigned long long tail = SEPARATOR_LEN + TERMINATOR_LEN;
+
+  body.offset = mtf::NO_BODY;
+  body.length = 0;
+
+  if( end < start + SEPARATOR_LEN
+      || std::memcmp(data + end - SEPARATOR_LEN, mtf::SECTION_SEPARATOR, SEPARATOR_LEN) != 0 )
+    return false;
+
+  if(end - start == SEPARATOR_LEN) return true;
+
+  // Anything more than a separator is a body and its terminator.
+  if( header.original || end - start < tail
+      || std::memcmp(data + end - tail, mtf::BODY_TERMINATOR, TERMINATOR_LEN) != 0 )
+    return false;
+
+  body.offset = start;
+  body.length = end - start - tail;
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Finds the headers that start in one slice of a
+// merge. The search runs a little past the slice,
+// so a header that straddles its end is found.
+//
+// @param data: The merge.
+//
+// @param size: Its size.
+//
+// @param low: The start of the slice.
+//
+// @param high: The end of the slice.
+//
+// @param found: The headers are appended to it, in
+// order.
+//
+// *************************************************/
+static void scanSlice( const char * data, std::size_t size, std::size_t low,
+                       std::size_t high, std::vector<Candidate> & found )
+{
+  const char * at = data + low,
+             * end = data + std::min(size, high + MARK_LEN - 1);
+
+  while(at < end)
+  {
+    const char * mark = static_cast<const char *>(::memmem(at, end - at, MARK, MARK_LEN));
+
+    if(!mark) break;
+
+    Candidate header;
+
+    if(parseHeader(data, size, mark - data, header)) found.push_back(header);
+
+    at = mark + 1;
+  }
+}
+
+
+
+/* *************************************************
+// Takes the sections from the index, after
+// checking that they account for every byte of
+// the merge: each header, body, terminator and
+// separator must be where the index puts them. If
+// the merge was edited, they won't be.
+//
+// @param data: The merge.
+//
+// @param size: Its size.
+//
+// @param reader: The merge's index.
+//
+// @param sections: Filled with the sections.
+//
+// @return: true if the index fits the merge.
+//
+// *************************************************/
+static bool fromIndex( const char * data, std::size_t size, const mtf::SectionReader & reader,
+                       std::vector<mtf::SplitSection> & sections )
+{
+  // The number of the first file with each body, for references.
+  std::unordered_map<unsigned long long, unsigned long> firsts;
+  unsigned long long at = 0;
+
+  sections.clear();
+
+  for(unsigned long number = 1; number <= reader.count(); ++number)
+  {
+    mtf::SplitSection section = { { mtf::NO_BODY, 0 }, 0 };
+
+    if(!reader.locate(number, section.body)) return false;
+
+    std::string header = mtf::sectionHeader(number);
+    bool own = section.body.offset == mtf::NO_BODY
+            || section.body.offset == at + header.size();
+
+    // A body elsewhere is a reference to the file that has it.
+    if(!own)
+    {
+      std::unordered_map<unsigned long long, unsigned long>::const_iterator first
+        = firsts.find(section.body.offset);
+
+      if(first == firsts.end()) return false;
+
+      section.original = first->second;
+      header = mtf::referenceHeader(number, section.original);
+    }
+
+    if(size - at < header.size() || std::memcmp(data + at, header.data(), header.size()) != 0)
+      return false;
+
+    at += header.size();
+
+    // Skip the body and its terminator.
+    if(own && section.body.offset != mtf::NO_BODY)
+    {
+      if( size - at < section.body.length + TERMINATOR_LEN
+          || std::memcmp( data + at + section.body.length, mtf::BODY_TERMINATOR,
+                          TERMINATOR_LEN ) != 0 )
+        return false;
+
+      firsts.insert(std::make_pair(section.body.offset, number));
+      at += section.body.length + TERMINATOR_LEN;
+    }
+
+    if( size - at < SEPARATOR_LEN
+        || std::memcmp(data + at, mtf::SECTION_SEPARATOR, SEPARATOR_LEN) != 0 )
+      return false;
+
+    at += SEPARATOR_LEN;
+    sections.push_back(section);
+  }
+
+  return at == size && !sections.empty();
+}
+
+
+
+/* *************************************************
+// Writes the parts with a pool of threads, each
+// claiming the next section until none are left.
+// The bodies are written straight from the
+// mapping.
+//
+// @param data: The merge.
+//
+// @param sections: Its sections.
+//
+// @param dir: Where the parts go.
+//
+// @param threads: The writing threads.
+//
+// @param bytes: Set to the bytes written.
+//
+// @return: true if every part was written.
+//
+// *************************************************/
+static bool writeParts( const char * data, const std::vector<mtf::SplitSection> & sections,
+                        const std::string & dir, unsigned threads,
+                        unsigned long long & bytes )
+{
+  const unsigned long count = sections.size();
+
+  // The next section to be claimed, the bytes written, and the first failure.
+  std::atomic<unsigned long> next_index(0);
+  std::atomic<unsigned long long> written(0);
+  std::atomic<bool> ok(true);
+  std::atomic<int> failure(0);
+
+  auto worker = [&]()
+  {
+    unsigned long index = 0;
+
+    while(ok && (index = next_index++) < count)
+    {
+      const mtf::SplitSection & section = sections[index];
+      // A reference's part is a copy of the file it repeats.
+      const mtf::IndexEntry & body = section.original ? sections[section.original - 1].body
+                                                      : section.body;
+
+      if(body.offset == mtf::NO_BODY) continue;
+
+      std::string path = dir + "/" + std::to_string(index + 1) + ".txt";
+      int fd;
+
+      {
+        mtf::CallTimer timer(mtf::CALL_OPEN);
+        fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      }
+
+      bool done = fd >= 0 && mtf::writeAll(fd, data + body.offset, body.length);
+
+      if(fd >= 0) done = (::close(fd) == 0) && done;
+
+      if(!done)
+      {
+        failure = errno;
+        ok = false;
+      }
+
+      written += body.length;
+    }
+  };
+
+  // There's no point in more threads than parts.
+  if(threads > count) threads = count;
+
+  std::vector<std::thread> pool;
+
+  for(unsigned thread = 1; thread < threads; ++thread)
+    pool.push_back(std::thread(worker));
+
+  // This thread works too.
+  worker();
+
+  for(std::thread & thread : pool) thread.join();
+
+  if(!ok) errno = failure;
+
+  bytes = written;
+
+  return ok;
+}
+
+
+
+/* *************************************************
+// The threads to use: as asked, or one per CPU.
+//
+// *************************************************/
+static unsigned threadCount(unsigned threads)
+{
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+
+  return threads ? threads : 1;
+}
+
+
+
+/* *************************************************
+// Inflates a compressed merge: a run of gzip
+// members, one after another, whose text joined
+// together is the plain merge.
+//
+// @param data: The compressed merge.
+//
+// @param size: Its size.
+//
+// @param text: Replaced with the plain merge.
+//
+// @return: true if every member inflated whole
+// (errno is EINVAL if one was damaged or cut off).
+//
+// *************************************************/
+static bool inflateMerge(const char * data, std::size_t size, std::string & text)
+{
+  z_stream stream = z_stream();
+
+  // A window of 15 bits, plus 16 to expect a gzip wrapper.
+  if(inflateInit2(&stream, 15 + 16) != Z_OK)
+  {
+    errno = ENOMEM;
+    return false;
+  }
+
+  std::size_t used = 0;
+  int status = Z_OK;
+
+  text.clear();
+
+  // zlib counts its input in uInt, so it's fed in pieces.
+  while(status == Z_OK || status == Z_STREAM_END)
+  {
+    // The next member starts where the last one ended.
+    if(status == Z_STREAM_END)
+    {
+      if(stream.avail_in == 0 && used == size) break;
+      if(::inflateReset(&stream) != Z_OK) { status = Z_DATA_ERROR; break; }
+    }
+
+    if(stream.avail_in == 0)
+    {
+      std::size_t piece = std::min(size - used, INFLATE_CHUNK);
+
+      stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data + used));
+      stream.avail_in = piece;
+      used += piece;
+    }
+
+    std::size_t had = text.size();
+
+    text.resize(had + INFLATE_CHUNK);
+    stream.next_out = reinterpret_cast<Bytef *>(&text[had]);
+    stream.avail_out = INFLATE_CHUNK;
+
+    status = ::inflate(&stream, Z_NO_FLUSH);
+    text.resize(had + INFLATE_CHUNK - stream.avail_out);
+
+    // Out of input part way through a member means it was cut off.
+    if(status == Z_BUF_ERROR && stream.avail_in == 0 && used < size) status = Z_OK;
+  }
+
+  ::inflateEnd(&stream);
+
+  if(status != Z_STREAM_END)
+  {
+    errno = EINVAL;
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,78 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Split.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for splitting a merged file
+// back into the files it was made from, so AllFiles.txt
+// can be edited in one place and turned back into
+// 1.txt..N.txt. The merge is mapped, its sections are
+// found (from the index if it still fits, or else by a
+// scan for "FILE #n" headers spread over threads), and
+// the parts are written by a pool of threads. See
+// Split.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef SPLIT_H
+#define SPLIT_H
+
+#include <cstddef>
+#include <vector>
+
+#include "Merge.h"
+
+
+namespace mtf
+{
+  // Settings for a split.
+  struct SplitOptions
+  {
+    // The threads that scan and write (0 for one per CPU).
+    unsigned threads;
+    // The directory the parts are written to.
+    const char * dir;
+    // false to ignore the index and always scan.
+    bool use_index;
+  };
+
+  // Defaults for SplitOptions.
+  const SplitOptions SPLIT_DEFAULTS = { 0, ".", true };
+
+  // Totals for a split.
+  struct SplitReport
+  {
+    // The sections found, i.e. the files in the merge.
+    unsigned long files;
+    // Sections with no body, which get no part.
+    unsigned long missing;
+    // Sections written as "FILE #n = FILE #k", whose parts are
+    // copies of file k.
+    unsigned long references;
+    // The bytes written to the parts.
+    unsigned long long bytes;
+    // true if the sections came from the index rather than a scan.
+    bool indexed;
+    // Wall clock time of the split in seconds.
+    double seconds;
+  };
+
+  // One section of a merge, as found by a split.
+  struct SplitSection
+  {
+    // Where its body is (offset NO_BODY if it has none).
+    IndexEntry body;
+    // For a reference, the number of the file it repeats (else 0).
+    unsigned long original;
+  };
+
+  // Find every section in the size bytes of a merge at data.
+  bool findSections( const char * data, std::size_t size, unsigned threads,
+                     std::vector<SplitSection> & sections );
+
+  // Split the merge at merged_path into the files it was made from.
+  bool splitMerge( const char * merged_path, const char * index_path,
+                   const SplitOptions & options, SplitReport & report );
+};
+#endif // SPLIT_H
@@ -0,0 +1,415 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Stats.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementations for the instrumentation
+// declared in Stats.h. The call totals are relaxed
+// atomics, since the prefetcher and the parallel and
+// compressing merges make calls from several threads.
+// The progress line is redrawn in place with a
+// carriage return, at most four times a second, and
+// only by whichever thread gets the lock first.
+//
+// ******************************************************/
+
+#include "Stats.h"
+#include "Merge.h"
+#include "Uring.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+
+
+// The call totals, by kind.
+static std::atomic<unsigned long long> call_counts[mtf::CALL_KINDS], call_nanos[mtf::CALL_KINDS];
+
+// true while per file latencies are kept.
+static std::atomic<bool> timing_files(false);
+
+// The progress line: whether it's shown, the files expected, when the
+// merge and the last line began, and the lock that picks a printer.
+static std::atomic<bool> showing_progress(false);
+static unsigned long progress_files = 0;
+static std::chrono::steady_clock::time_point progress_start, progress_shown;
+static std::mutex progress_lock;
+static unsigned long shown_files = 0;
+static unsigned long long shown_bytes = 0;
+
+// The time between progress lines.
+static const std::chrono::milliseconds PROGRESS_PERIOD(250);
+
+std::atomic<bool> mtf::counting_calls(false);
+
+
+// The names of the call kinds in the report.
+static const char * const CALL_NAMES[mtf::CALL_KINDS] = { "open", "read", "write", "copy" };
+
+// Print the progress line for files and bytes done.
+static void showProgress(unsigned long files, unsigned long long bytes, bool last);
+// Write a JSON report to path, or to stderr for "-".
+static bool writeJson(const char * path, const std::string & json);
+
+
+
+/* *************************************************
+// Turns call counting on or off. The totals are
+// cleared either way.
+//
+// *************************************************/
+void mtf::countCalls(bool on)
+{
+  for(int kind = 0; kind < CALL_KINDS; ++kind)
+  {
+    call_counts[kind] = 0;
+    call_nanos[kind] = 0;
+  }
+
+  counting_calls = on;
+
+  return;
+}
+
+
+
+unsigned long long mtf::callCount(CallKind kind)
+{
+  return call_counts[kind].load(std::memory_order_relaxed);
+}
+
+
+
+double mtf::callSeconds(CallKind kind)
+{
+  return call_nanos[kind].load(std::memory_order_relaxed) / 1e9;
+}
+
+
+
+void mtf::recordCall(CallKind kind, unsigned long long nanos)
+{
+  call_counts[kind].fetch_add(1, std::memory_order_relaxed);
+  call_nanos[kind].fetch_add(nanos, std::memory_order_relaxed);
+
+  return;
+}
+
+
+
+mtf::LatencyHistogram::LatencyHistogram(void)
+  : total(0), longest(0)
+{
+  std::memset(buckets, 0, sizeof(buckets));
+}
+
+
+
+/* *************************************************
+// Records one duration. Values under 16 get a
+// bucket each; above that, each power of two is
+// split into 8 equal buckets by the 3 bits after
+// the leading one.
+//
+// @param nanos: The duration.
+//
+// *************************************************/
+void mtf::LatencyHistogram::record(unsigned long long nanos)
+{
+  std::size_t bucket = nanos;
+
+  if(nanos >= 16)
+  {
+    int power = 63 - __builtin_clzll(nanos);
+
+    bucket = 16 + (power - 4) * 8 + ((nanos >> (power - 3)) & 7);
+  }
+
+  ++buckets[bucket];
+  ++total;
+
+  if(nanos > longest) longest = nanos;
+
+  return;
+}
+
+
+
+void mtf::LatencyHistogram::merge(const LatencyHistogram & other)
+{
+  for(std::size_t bucket = 0; bucket < BUCKETS; ++bucket)
+    buckets[bucket] += other.buckets[bucket];
+
+  total += other.total;
+  if(other.longest > longest) longest = other.longest;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Finds a percentile: the top of the bucket that
+// holds the duration at that rank (never more than
+// the maximum).
+//
+// @param fraction: e.g. 0.99 for the 99th.
+//
+// @return: The duration, or 0 if there are none.
+//
+// *************************************************/
+unsigned long long mtf::LatencyHistogram::percentile(double fraction) const
+{
+  if(total == 0) return 0;
+
+  unsigned long long rank = fraction * total, seen = 0;
+
+  if(rank >= total) rank = total - 1;
+
+  for(std::size_t bucket = 0; bucket < BUCKETS; ++bucket)
+  {
+    seen += buckets[bucket];
+
+    if(seen <= rank) continue;
+    if(bucket < 16) return bucket;
+
+    int power = (bucket - 16) / 8 + 4;
+    unsigned long long top = ((9ULL + (bucket - 16) % 8) << (power - 3)) - 1;
+
+    return top < longest ? top : longest;
+  }
+
+  return longest;
+}
+
+
+
+mtf::FileTimer::FileTimer(LatencyHistogram * histogram)
+  : histogram(histogram)
+{
+  if(histogram) start = std::chrono::steady_clock::now();
+}
+
+
+
+void mtf::FileTimer::done(void)
+{
+  if(histogram)
+    histogram->record(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - start).count());
+
+  return;
+}
+
+
+
+void mtf::timeFiles(bool on)
+{
+  timing_files = on;
+
+  return;
+}
+
+
+
+mtf::LatencyHistogram * mtf::fileHistogram(MergeReport & report)
+{
+  return timing_files ? &report.latency : NULL;
+}
+
+
+
+/* *************************************************
+// Starts the progress line for a merge.
+//
+// @param files: The number of inputs.
+//
+// *************************************************/
+void mtf::startProgress(unsigned long files)
+{
+  std::lock_guard<std::mutex> hold(progress_lock);
+
+  progress_files = files;
+  progress_start = progress_shown = std::chrono::steady_clock::now();
+  shown_files = 0;
+  shown_bytes = 0;
+  showing_progress = true;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Notes progress, redrawing the line if it's been
+// long enough. A thread that finds the line being
+// drawn just moves on.
+//
+// @param files: The inputs finished so far.
+//
+// @param bytes: The output written so far.
+//
+// *************************************************/
+void mtf::stepProgress(unsigned long files, unsigned long long bytes)
+{
+  if(!showing_progress.load(std::memory_order_relaxed)) return;
+
+  std::unique_lock<std::mutex> hold(progress_lock, std::try_to_lock);
+
+  if(!hold.owns_lock()) return;
+
+  // Threads may report out of order; keep the furthest.
+  if(files > shown_files) shown_files = files;
+  if(bytes > shown_bytes) shown_bytes = bytes;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+  if(now - progress_shown < PROGRESS_PERIOD) return;
+
+  progress_shown = now;
+  showProgress(shown_files, shown_bytes, false);
+
+  return;
+}
+
+
+
+void mtf::endProgress(void)
+{
+  if(!showing_progress) return;
+
+  std::lock_guard<std::mutex> hold(progress_lock);
+
+  showProgress(shown_files, shown_bytes, true);
+  showing_progress = false;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Draws the progress line over the last one.
+//
+// *************************************************/
+static void showProgress(unsigned long files, unsigned long long bytes, bool last)
+{
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now()
+                                                 - progress_start).count();
+  char line[160];
+
+  std::snprintf( line, sizeof(line), "\r%lu/%lu files, %.1f MB, %.1f MB/s",
+                 files, progress_files, bytes / 1e6,
+                 seconds > 0 ? bytes / seconds / 1e6 : 0.0 );
+
+  std::cerr << line << (last ? "\n" : "") << std::flush;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Writes the JSON report of a merge: its totals
+// and rates, the per file latency percentiles (in
+// microseconds, if they were kept) and the call
+// counts and seconds by kind. Files and calls
+// aren't timed one by one on the ring, so a ring
+// merge reports its submissions and operations
+// instead, and leaves the latencies and calls out
+// rather than reporting zeros.
+//
+// @param path: Where to write it, or "-" for
+// standard error.
+//
+// @param mode: The kind of merge that was run.
+//
+// @param report: The totals of the merge.
+//
+// @param uring: The counts of an io_uring merge,
+// or NULL for any other merge.
+//
+// @return: true if the report was written.
+//
+// *************************************************/
+bool mtf::writeStats( const char * path, const char * mode, const MergeReport & report,
+                      const UringReport * uring )
+{
+  std::ostringstream json;
+  double seconds = report.seconds > 0 ? report.seconds : 0;
+
+  json << "{\n"
+       << "  \"mode\": \"" << mode << "\",\n"
+       << "  \"files\": " << report.files << ",\n"
+       << "  \"bytes\": " << report.bytes << ",\n"
+       << "  \"seconds\": " << seconds << ",\n"
+       << "  \"files_per_second\": " << (seconds ? report.files / seconds : 0) << ",\n"
+       << "  \"mb_per_second\": " << throughput(report) << ",\n";
+
+  if(report.compressed)
+    json << "  \"compressed_bytes\": " << report.compressed << ",\n";
+
+  if(uring && uring->used_ring)
+  {
+    json << "  \"uring\": {\n"
+         << "    \"submissions\": " << uring->submissions << ",\n"
+         << "    \"operations\": " << uring->operations << ",\n"
+         << "    \"files\": " << uring->files << "\n"
+         << "  }\n"
+         << "}\n";
+
+    return writeJson(path, json.str());
+  }
+
+  const LatencyHistogram & latency = report.latency;
+
+  json << "  \"latency_us\": {\n"
+       << "    \"count\": " << latency.count() << ",\n"
+       << "    \"p50\": " << latency.percentile(0.5) / 1e3 << ",\n"
+       << "    \"p99\": " << latency.percentile(0.99) / 1e3 << ",\n"
+       << "    \"max\": " << latency.maximum() / 1e3 << "\n"
+       << "  },\n"
+       << "  \"syscalls\": {\n";
+
+  for(int kind = 0; kind < CALL_KINDS; ++kind)
+    json << "    \"" << CALL_NAMES[kind] << "\": { \"calls\": "
+         << callCount(CallKind(kind)) << ", \"seconds\": "
+         << callSeconds(CallKind(kind)) << " }"
+         << (kind + 1 < CALL_KINDS ? ",\n" : "\n");
+
+  json << "  }\n"
+       << "}\n";
+
+  return writeJson(path, json.str());
+}
+
+
+
+/* *************************************************
+// Writes a finished JSON report.
+//
+// @param path: Where to write it, or "-" for
+// standard error.
+//
+// @param json: The report.
+//
+// @return: true if the report was written.
+//
+// *************************************************/
+static bool writeJson(const char * path, const std::string & json)
+{
+  if(std::strcmp(path, "-") == 0)
+  {
+    std::cerr << json;
+    return true;
+  }
+
+  std::ofstream out(path);
+  out << json;
+
+  return static_cast<bool>(out.flush());
+}
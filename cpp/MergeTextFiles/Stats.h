@@ -0,0 +1,179 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Stats.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the instrumentation of a
+// merge: counts and timings of the open, read, write
+// and in-kernel copy calls, a histogram of how long
+// each file took, the throttled progress line on
+// standard error, and the JSON report written with
+// --stats. Everything is off until turned on, and
+// costs one branch per call when off. See Stats.cpp
+// for more information.
+//
+// ******************************************************/
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+
+
+namespace mtf
+{
+  struct MergeReport;
+  struct UringReport;
+
+  // The kinds of system call that are counted.
+  enum CallKind
+  {
+    // open and openat of inputs.
+    CALL_OPEN,
+    // read from inputs.
+    CALL_READ,
+    // write and pwrite to the output.
+    CALL_WRITE,
+    // copy_file_range, sendfile and splice.
+    CALL_COPY,
+    CALL_KINDS
+  };
+
+  // true while calls are being counted.
+  extern std::atomic<bool> counting_calls;
+
+  // Start (or stop) counting calls, clearing the totals.
+  void countCalls(bool on);
+
+  // The number of calls of kind, and the seconds spent in them.
+  unsigned long long callCount(CallKind kind);
+  double callSeconds(CallKind kind);
+
+  // Add one call of kind that took nanos.
+  void recordCall(CallKind kind, unsigned long long nanos);
+
+
+  /* ************************************************
+  // Times one system call for the totals, if they
+  // are being kept. Construct it right before the
+  // call, in the same scope.
+  //
+  // ************************************************/
+  class CallTimer
+  {
+    public:
+
+      explicit CallTimer(CallKind kind)
+        : kind(kind), timing(counting_calls.load(std::memory_order_relaxed))
+      {
+        if(timing) start = std::chrono::steady_clock::now();
+      }
+
+      ~CallTimer(void)
+      {
+        if(timing)
+          recordCall( kind, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                              std::chrono::steady_clock::now() - start).count() );
+      }
+
+
+    private:
+
+      CallTimer(const CallTimer &);
+      CallTimer & operator=(const CallTimer &);
+
+      CallKind kind;
+      bool timing;
+      std::chrono::steady_clock::time_point start;
+  };
+
+
+  /* ************************************************
+  // A histogram of durations in nanoseconds, with
+  // eight buckets per power of two, so percentiles
+  // are within 12.5% using a few KB however many
+  // files are merged.
+  //
+  // ************************************************/
+  class LatencyHistogram
+  {
+    public:
+
+      // The number of buckets.
+      static const std::size_t BUCKETS = 16 + 60 * 8;
+
+      LatencyHistogram(void);
+
+      // Add one duration.
+      void record(unsigned long long nanos);
+
+      // Add every duration in other.
+      void merge(const LatencyHistogram & other);
+
+      // The number of durations recorded.
+      unsigned long long count(void) const { return total; }
+
+      // The longest duration recorded.
+      unsigned long long maximum(void) const { return longest; }
+
+      // The duration below which a fraction of them fall.
+      unsigned long long percentile(double fraction) const;
+
+
+    private:
+
+      unsigned long long buckets[BUCKETS];
+      unsigned long long total, longest;
+  };
+
+
+  /* ************************************************
+  // Times one file of a merge into a histogram, if
+  // the latencies are being kept.
+  //
+  // ************************************************/
+  class FileTimer
+  {
+    public:
+
+      // Time a file for histogram (NULL to not time it at all).
+      explicit FileTimer(LatencyHistogram * histogram);
+
+      // Record the time since the timer was made.
+      void done(void);
+
+
+    private:
+
+      LatencyHistogram * histogram;
+      std::chrono::steady_clock::time_point start;
+  };
+
+  // Start keeping per file latencies in merge reports.
+  void timeFiles(bool on);
+
+  // The histogram a merge should record into, or NULL if none is kept.
+  LatencyHistogram * fileHistogram(MergeReport & report);
+
+
+  // Show a progress line on stderr for a merge of files inputs.
+  void startProgress(unsigned long files);
+
+  // Note that files inputs and bytes of output are done (safe to
+  // call from any thread; only prints a few times a second).
+  void stepProgress(unsigned long files, unsigned long long bytes);
+
+  // Print the last progress line and end it.
+  void endProgress(void);
+
+
+  // Write the JSON report of a merge (and the call totals) to path,
+  // or to stderr for "-". A merge that went through io_uring passes
+  // its uring report, whose counts replace the latencies and calls.
+  bool writeStats( const char * path, const char * mode, const MergeReport & report,
+                   const UringReport * uring = NULL );
+};
+#endif // STATS_H
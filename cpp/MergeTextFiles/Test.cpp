@@ -0,0 +1,2133 @@
+/* ****************************************************
+// File: Test.cpp
+// Name: Nick G. Toth
+// Date: October 17, 2026
+//
+// Overview: This is a test file for the merge routines
+// in Merge.cpp in this same directory. The tests build
+// small corpora of numbered text files in a scratch
+// directory, merge them, and check the output. Run the
+// program executable without arguments; it returns 0
+// if every test passes.
+//
+// ****************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <cstdio>
+
+#include <thread>
+#include <iterator>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "Merge.h"
+#include "Uring.h"
+#include "Writer.h"
+#include "FileCopy.h"
+#include "Index.h"
+#include "Incremental.h"
+#include "Hash.h"
+#include "Transform.h"
+#include "Sorted.h"
+#include "Gzip.h"
+#include "Stats.h"
+#include "Split.h"
+#include "Filter.h"
+#include "Batch.h"
+
+#include <zlib.h>
+
+
+// The number of failed checks.
+static int failures = 0;
+
+// Record and display the result of a single check.
+static void check(const char * what, bool passed);
+// Run a merge into a freshly created file.
+template<typename Merge>
+static bool mergeTo(const char * outname, Merge merge);
+// Write the numbered text files 1.txt..count.txt.
+static void writeCorpus(unsigned short count);
+// Block copy settings for a test.
+static mtf::BlockOptions blockOptions( std::size_t chunk_size,
+                                       unsigned prefetch = 0,
+                                       bool dedup = false,
+                                       const mtf::TransformOptions & transform
+                                         = mtf::TRANSFORM_NONE );
+// Clean up a body the simplest way, to check the kernels against.
+static std::string transformed(const std::string & body, const mtf::TransformOptions & options);
+// The kernel copy must write the same bytes as the block copy.
+void kernelTest(void);
+// Long lines, blank lines and odd bytes must pass through untouched.
+void blockTest(void);
+// A parallel merge must write the same bytes as a serial merge.
+void parallelTest(void);
+// An io_uring merge must write the same bytes as a serial merge.
+void uringTest(void);
+// A merge streamed into a pipe must match one written to a file.
+void streamTest(void);
+// Every file must come back out of the merge through its index.
+void indexTest(void);
+// Re-merging must only redo files from the first change on.
+void incrementalTest(void);
+// File numbers past 32767 must merge, with or without prefetching.
+void scaleTest(void);
+// Directories, globs and lists must give the right files in order.
+void inputTest(void);
+// Repeated bodies must become references to the first copy.
+void dedupTest(void);
+// Every transform kernel must give the same bytes, however the input is split.
+void transformTest(void);
+// A sorted merge must match sorting every line, in one pass or many.
+void sortedTest(void);
+// Background and O_DIRECT writes must give the same bytes as plain ones.
+void writerTest(void);
+// A gzip merge must inflate to the plain merge, whole or a file at a time.
+void gzipTest(void);
+// Latency percentiles, call counts and the JSON report must add up.
+void statsTest(void);
+// Splitting a merge, edited or not, must give back its files exactly.
+void splitTest(void);
+// Every search kernel must find the first literal, and a filtered merge keep what grep would.
+void filterTest(void);
+// Every job in a batch must match its own merge, and a failed job must not stop the rest.
+void batchTest(void);
+// Mapped inputs must give the same bytes as read ones, into files and pipes.
+void mapTest(void);
+
+
+int main(void)
+{
+  // Work in a scratch directory so we don't clobber any real inputs.
+  char scratch[] = "/tmp/MergeTestXXXXXX";
+
+  // If the scratch directory can't be made..
+  if(!mkdtemp(scratch) || chdir(scratch) != 0)
+  {
+    // Print an error message.
+    std::cout << "\n  Error :: Could not create a scratch directory!"
+              << std::endl << std::endl;
+
+    // Return error code 1.
+    return 1;
+  }
+
+  // Run the kernel copy test.
+  kernelTest();
+
+  // Run the block copy test.
+  blockTest();
+
+  // Run the parallel merge test.
+  parallelTest();
+
+  // Run the io_uring merge test.
+  uringTest();
+
+  // Run the streaming merge test.
+  streamTest();
+
+  // Run the section index test.
+  indexTest();
+
+  // Run the incremental merge test.
+  incrementalTest();
+
+  // Run the large file count test.
+  scaleTest();
+
+  // Run the input set test.
+  inputTest();
+
+  // Run the dedup test.
+  dedupTest();
+
+  // Run the body transform test.
+  transformTest();
+
+  // Run the sorted merge test.
+  sortedTest();
+
+  // Run the output writer test.
+  writerTest();
+
+  // Run the compressed output test.
+  gzipTest();
+
+  // Run the instrumentation test.
+  statsTest();
+
+  // Run the split test.
+  splitTest();
+
+  // Run the line filter test.
+  filterTest();
+
+  // Run the batch test.
+  batchTest();
+
+  // Run the mapped input test.
+  mapTest();
+
+  // Display the final tally.
+  std::cout << "\n  " << (failures ? "FAILED" : "All tests passed")
+            << std::endl << std::endl;
+
+  // Clean up the scratch directory.
+  std::system((std::string("rm -rf ") + scratch).c_str());
+
+  return failures ? 1 : 0;
+}
+
+
+
+/* ********************************************
+// Displays the result of a check, and counts
+// it if it failed.
+//
+// ********************************************/
+static void check(const char * what, bool passed)
+{
+  std::cout << "    " << (passed ? "pass" : "FAIL") << " :: "
+            << what << std::endl;
+
+  if(!passed) ++failures;
+}
+
+
+
+/* ********************************************
+// Opens outname, runs merge on it and closes
+// it again.
+//
+// ********************************************/
+template<typename Merge>
+static bool mergeTo(const char * outname, Merge merge)
+{
+  int fd = mtf::openOutput(outname);
+
+  if(fd < 0) return false;
+
+  bool ok = merge(fd);
+
+  return (::close(fd) == 0) && ok;
+}
+
+
+
+/* ********************************************
+// Writes count files named 1.txt..count.txt.
+// File n holds n lines of text, so every file
+// is different and none has an empty line.
+//
+// ********************************************/
+static void writeCorpus(unsigned short count)
+{
+  for(unsigned short index = 1; index <= count; ++index)
+  {
+    std::ofstream out(std::to_string(index) + ".txt");
+
+    for(unsigned short line = 0; line < index; ++line)
+      out << "File " << index << ", line " << line << std::endl;
+  }
+}
+
+
+
+/* ********************************************
+// Builds the block copy settings for a test.
+//
+// ********************************************/
+static mtf::BlockOptions blockOptions( std::size_t chunk_size,
+                                       unsigned prefetch, bool dedup,
+                                       const mtf::TransformOptions & transform )
+{
+  mtf::BlockOptions options = { chunk_size, prefetch, dedup, transform,
+                                mtf::BLOCK_DEFAULTS.write, mtf::BLOCK_DEFAULTS.gzip,
+                                mtf::BLOCK_DEFAULTS.map, mtf::BLOCK_DEFAULTS.map_threshold };
+
+  return options;
+}
+
+
+
+/* ********************************************
+// kernelTest merges a small corpus with both
+// mergeBlocks and mergeKernel, and checks that
+// the two outputs are identical.
+//
+// ********************************************/
+void kernelTest(void)
+{
+  const unsigned short COUNT = 20;
+
+  std::cout << "\n  Starting Kernel Copy Test" << std::endl;
+
+  writeCorpus(COUNT);
+
+  // The files to be merged, 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  mtf::MergeReport block_report = {}, kernel_report = {};
+
+  check("block merge", mergeTo("blocks.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(mtf::DEFAULT_CHUNK_SIZE), block_report); }));
+  check("kernel merge", mergeTo("kernel.out", [&](int fd)
+    { return mtf::mergeKernel(inputs, fd, 0, kernel_report); }));
+  check("same bytes", mtf::sameContents("blocks.out", "kernel.out"));
+  check("same size", block_report.bytes == kernel_report.bytes);
+}
+
+
+
+/* ********************************************
+// blockTest merges files with lines far longer
+// than the copy chunk, blank lines, CRLFs, NULs
+// and no final newline, and checks the output
+// against the exact expected bytes.
+//
+// ********************************************/
+void blockTest(void)
+{
+  std::cout << "\n  Starting Block Copy Test" << std::endl;
+
+  const std::string bodies[3] =
+  {
+    std::string(5000, 'x') + "\n\n" + std::string(3000, 'y') + "\n",
+    std::string("crlf\r\nnul\0byte\r\n", 16),
+    "no final newline"
+  };
+
+  std::string expected;
+  std::vector<std::string> names(3);
+
+  for(unsigned short index = 0; index < 3; ++index)
+  {
+    names[index] = "long" + std::to_string(index + 1) + ".txt";
+
+    std::ofstream(names[index], std::ios::binary) << bodies[index];
+
+    expected += mtf::sectionHeader(index + 1) + bodies[index]
+              + mtf::BODY_TERMINATOR + mtf::SECTION_SEPARATOR;
+  }
+
+  std::ofstream("long.expected", std::ios::binary) << expected;
+
+  mtf::MergeReport report = {};
+
+  // A tiny chunk size forces every line to span several chunks.
+  check("block merge", mergeTo("long.out", [&](int fd)
+    { return mtf::mergeBlocks(mtf::InputSet(names), fd, blockOptions(100), report); }));
+  check("exact bytes", mtf::sameContents("long.expected", "long.out"));
+}
+
+
+
+/* ********************************************
+// parallelTest merges a corpus (including a
+// missing file and an empty file) serially
+// and with several threads, and checks that
+// the two outputs are identical. A directory
+// among the inputs must get a header but no
+// body from every copy method.
+//
+// ********************************************/
+void parallelTest(void)
+{
+  const unsigned short COUNT = 50;
+
+  std::cout << "\n  Starting Parallel Merge Test" << std::endl;
+
+  writeCorpus(COUNT);
+
+  // Leave a hole in the numbering and an empty file.
+  std::remove("7.txt");
+  std::ofstream("9.txt", std::ios::trunc);
+
+  // The files 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  mtf::MergeReport serial_report = {}, parallel_report = {};
+
+  check("serial merge", mergeTo("serial.out", [&](int fd)
+    { return mtf::mergeKernel(inputs, fd, 0, serial_report); }));
+  check("parallel merge", mergeTo("parallel.out", [&](int fd)
+    { return mtf::mergeParallel(inputs, fd, 4, parallel_report); }));
+  check("same bytes", mtf::sameContents("serial.out", "parallel.out"));
+  check("same size", serial_report.bytes == parallel_report.bytes);
+
+  // A directory opens, but has no body to copy.
+  ::mkdir("dir.txt", 0755);
+
+  std::vector<std::string> names = { "1.txt", "dir.txt", "3.txt" };
+  const mtf::InputSet mixed(names);
+
+  mtf::UringOptions uring_options = { 16, 4, 512 };
+  mtf::UringReport uring_report = {};
+  mtf::MergeReport report = {};
+
+  check("directory kernel merge", mergeTo("dir_kernel.out", [&](int fd)
+    { return mtf::mergeKernel(mixed, fd, 0, report); }));
+  check("directory has no body", report.sections[1].offset == mtf::NO_BODY);
+  check("directory block merge", mergeTo("dir_blocks.out", [&](int fd)
+    { return mtf::mergeBlocks(mixed, fd, blockOptions(4096), report); }));
+  check("directory has no body", report.sections[1].offset == mtf::NO_BODY);
+  check("directory parallel merge", mergeTo("dir_parallel.out", [&](int fd)
+    { return mtf::mergeParallel(mixed, fd, 2, report); }));
+  check("directory io_uring merge", mergeTo("dir_uring.out", [&](int fd)
+    { return mtf::mergeUring(mixed, fd, uring_options, report, uring_report); }));
+  check("same block bytes", mtf::sameContents("dir_kernel.out", "dir_blocks.out"));
+  check("same parallel bytes", mtf::sameContents("dir_kernel.out", "dir_parallel.out"));
+  check("same io_uring bytes", mtf::sameContents("dir_kernel.out", "dir_uring.out"));
+
+  ::rmdir("dir.txt");
+}
+
+
+
+/* ********************************************
+// uringTest merges the corpus left by
+// parallelTest with io_uring, using small
+// batches, few slots and a small slot size so
+// that windows, slot reuse and the large file
+// path all get exercised, then again with a
+// batch and depth too big for one ring.
+//
+// ********************************************/
+void uringTest(void)
+{
+  const unsigned short COUNT = 50;
+
+  std::cout << "\n  Starting io_uring Merge Test" << std::endl;
+
+  // The files 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  mtf::UringOptions options = { 16, 4, 512 };
+  mtf::MergeReport report = {};
+  mtf::UringReport uring_report = {};
+
+  check("io_uring merge", mergeTo("uring.out", [&](int fd)
+    { return mtf::mergeUring(inputs, fd, options, report, uring_report); }));
+  check("same bytes", mtf::sameContents("serial.out", "uring.out"));
+
+  std::cout << "    (" << (uring_report.used_ring ? "used" : "no") << " io_uring, "
+            << uring_report.submissions << " submissions)" << std::endl;
+
+  // A batch bigger than the kernel allows is clamped, not given up on.
+  mtf::UringOptions huge = { 20000, 20000, 512 };
+  mtf::UringReport huge_report = {};
+
+  check("oversized io_uring merge", mergeTo("uring_huge.out", [&](int fd)
+    { return mtf::mergeUring(inputs, fd, huge, report, huge_report); }));
+  check("oversized same bytes", mtf::sameContents("serial.out", "uring_huge.out"));
+  check("oversized ring used", huge_report.used_ring == uring_report.used_ring);
+}
+
+
+
+/* ********************************************
+// streamTest merges the corpus left by
+// parallelTest, plus one file large enough to
+// be spliced, into a pipe with both the block
+// and kernel copies. A second thread drains
+// the pipe into a file, and the result must
+// match a merge written straight to a file.
+//
+// ********************************************/
+void streamTest(void)
+{
+  const unsigned short COUNT = 51;
+
+  std::cout << "\n  Starting Streaming Merge Test" << std::endl;
+
+  // Add a file well over the splice threshold.
+  std::ofstream("51.txt") << std::string(300 * 1024, 's') << std::endl;
+
+  // The files 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  mtf::MergeReport report = {};
+
+  check("file merge", mergeTo("file.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), report); }));
+
+  const char * pipe_names[2] = { "pipe_blocks.out", "pipe_kernel.out" };
+
+  for(int method = 0; method < 2; ++method)
+  {
+    int ends[2];
+
+    if(::pipe(ends) != 0) { check("pipe", false); return; }
+
+    // Drain the pipe into a file, slowly enough to push back on the writer.
+    std::thread reader([&]()
+    {
+      int out_fd = mtf::openOutput(pipe_names[method]);
+      char block[4096];
+      ssize_t got = 0;
+
+      while((got = ::read(ends[0], block, sizeof(block))) > 0)
+        mtf::writeAll(out_fd, block, got);
+
+      ::close(out_fd);
+    });
+
+    // The writing end is non-blocking, so backpressure shows up as EAGAIN.
+    ::fcntl(ends[1], F_SETFL, O_NONBLOCK);
+
+    bool ok = method == 0 ? mtf::mergeBlocks(inputs, ends[1], blockOptions(4096, 4), report)
+                          : mtf::mergeKernel(inputs, ends[1], 4, report);
+
+    ::close(ends[1]);
+    reader.join();
+    ::close(ends[0]);
+
+    check(method == 0 ? "block merge into pipe" : "kernel merge into pipe", ok);
+    check("same bytes", mtf::sameContents("file.out", pipe_names[method]));
+  }
+}
+
+
+
+/* ********************************************
+// indexTest merges the corpus left by
+// streamTest (with its missing, empty and
+// large files) with the block and parallel
+// merges, writes each index, and reads every
+// file back through a SectionReader.
+//
+// ********************************************/
+void indexTest(void)
+{
+  const unsigned short COUNT = 51;
+
+  std::cout << "\n  Starting Section Index Test" << std::endl;
+
+  // The files 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  check("index path", mtf::indexPathFor("AllFiles.txt") == "AllFiles.idx"
+                   && mtf::indexPathFor("out.d/merged") == "out.d/merged.idx");
+
+  mtf::MergeReport reports[2];
+
+  check("block merge", mergeTo("indexed_blocks.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), reports[0]); }));
+  check("parallel merge", mergeTo("indexed_parallel.out", [&](int fd)
+    { return mtf::mergeParallel(inputs, fd, 3, reports[1]); }));
+
+  const char * merged[2] = { "indexed_blocks.out", "indexed_parallel.out" };
+
+  for(int method = 0; method < 2; ++method)
+  {
+    check("write index", mtf::writeIndex("indexed.idx", reports[method].sections));
+
+    mtf::SectionReader reader;
+    bool opened = reader.open(merged[method], "indexed.idx"),
+         all_match = opened && reader.count() == COUNT;
+
+    check("open reader", opened);
+
+    for(unsigned short index = 0; all_match && index < COUNT; ++index)
+    {
+      std::ifstream in(inputs.name(index), std::ios::binary);
+      std::string expected((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>()),
+                  body;
+
+      // A missing file must have no body; everything else must match.
+      if(!in) all_match = !reader.read(index + 1, body);
+      else all_match = reader.read(index + 1, body) && body == expected;
+    }
+
+    check("every body matches", all_match);
+  }
+
+  // The large file is extracted through a mapping.
+  std::string big;
+  mtf::SectionReader reader;
+  reader.open("indexed_blocks.out", "indexed.idx");
+
+  int big_fd = mtf::openOutput("big.extracted");
+  check("extract", reader.extract(COUNT, big_fd));
+  ::close(big_fd);
+  check("extracted bytes", mtf::sameContents("big.extracted", "51.txt"));
+}
+
+
+
+/* ********************************************
+// incrementalTest checks Hash64 against known
+// XXH64 values, then grows, edits and touches
+// the corpus left by streamTest, re-merging
+// incrementally each time. Each result must
+// match a fresh merge, and only the sections
+// from the first change on may be rewritten.
+// A directory among the inputs must get a
+// header but no body, and keep its section.
+//
+// ********************************************/
+void incrementalTest(void)
+{
+  const unsigned short COUNT = 51, FIRST = 40;
+
+  std::cout << "\n  Starting Incremental Merge Test" << std::endl;
+
+  // Known XXH64 values, and the same hash however the input is split.
+  std::string text(100, 'h');
+  mtf::Hash64 whole, split, empty, abc;
+
+  whole.update(text.data(), text.size());
+  split.update(text.data(), 7);
+  split.update(text.data() + 7, 30);
+  split.update(text.data() + 37, 63);
+  abc.update("abc", 3);
+
+  check("xxh64 vectors", empty.digest() == 0xEF46DB3751D8E999ULL
+                      && abc.digest() == 0x44BC2CF5AD770999ULL);
+  check("split updates", whole.digest() == split.digest());
+
+  // The files 1.txt..COUNT.txt.
+  const mtf::InputSet inputs(COUNT);
+
+  mtf::MergeReport report = {}, fresh_report = {};
+  mtf::IncrementalReport incremental = {};
+
+  // Run an incremental merge of the first count files into inc.out.
+  auto merge = [&](unsigned short count)
+  {
+    int fd = mtf::openOutput("inc.out", false);
+    bool ok = fd >= 0 && mtf::mergeIncremental( mtf::InputSet(count), fd, 4096, 2,
+                                                "inc.manifest", report,
+                                                incremental );
+    return (fd >= 0 && ::close(fd) == 0) && ok;
+  };
+
+  // The first run has no manifest, so it builds everything.
+  check("first merge", merge(FIRST) && incremental.rebuilt);
+  check("fresh merge", mergeTo("fresh.out", [&](int fd)
+    { return mtf::mergeBlocks(mtf::InputSet(FIRST), fd, blockOptions(4096), fresh_report); }));
+  check("same bytes", mtf::sameContents("fresh.out", "inc.out"));
+
+  // New files are only appended.
+  check("append merge", merge(COUNT) && !incremental.rebuilt
+                     && incremental.kept == FIRST && report.files == COUNT - FIRST);
+  check("same bytes", mtf::sameContents("file.out", "inc.out"));
+
+  // A changed file is rewritten along with everything after it.
+  std::ofstream("45.txt", std::ios::app) << "One more line" << std::endl;
+
+  check("edit merge", merge(COUNT) && incremental.kept == 44);
+  check("fresh merge", mergeTo("fresh.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), fresh_report); }));
+  check("same bytes", mtf::sameContents("fresh.out", "inc.out"));
+
+  // A touched but unchanged file is hashed, not rewritten.
+  struct timespec times[2] = { { 0, UTIME_NOW }, { 1000000000, 0 } };
+  ::utimensat(AT_FDCWD, "10.txt", times, 0);
+
+  check("touch merge", merge(COUNT) && incremental.kept == COUNT
+                    && incremental.rehashed == 1 && report.bytes == 0);
+  check("same bytes", mtf::sameContents("fresh.out", "inc.out"));
+
+  // The sections cover the whole output, kept and new.
+  mtf::SectionReader reader;
+  std::string body;
+
+  check("write index", mtf::writeIndex("inc.idx", report.sections));
+  check("read kept and new", reader.open("inc.out", "inc.idx")
+                          && reader.read(2, body) && body == "File 2, line 0\nFile 2, line 1\n"
+                          && reader.read(COUNT, body) && body.size() == 300 * 1024 + 1);
+
+  // An output changed behind the manifest's back is rebuilt.
+  std::ofstream("inc.out", std::ios::app) << "junk";
+
+  check("rebuild merge", merge(COUNT) && incremental.rebuilt);
+  check("same bytes", mtf::sameContents("fresh.out", "inc.out"));
+
+  // A directory opens, but has no body to copy or hash.
+  ::mkdir("dir.txt", 0755);
+
+  std::vector<std::string> names = { "1.txt", "dir.txt", "2.txt" };
+  const mtf::InputSet mixed(names);
+
+  auto mergeMixed = [&](int fd)
+  {
+    return mtf::mergeIncremental( mixed, fd, 4096, 2, "dir_inc.manifest",
+                                  report, incremental );
+  };
+
+  ::unlink("dir_inc.manifest");
+
+  check("directory merge", mergeTo("dir_inc.out", mergeMixed) && incremental.rebuilt);
+  check("directory has no body", report.sections[1].offset == mtf::NO_BODY);
+  check("fresh merge", mergeTo("dir_fresh.out", [&](int fd)
+    { return mtf::mergeBlocks(mixed, fd, blockOptions(4096), fresh_report); }));
+  check("same bytes", mtf::sameContents("dir_fresh.out", "dir_inc.out"));
+
+  // Nothing changed, so the directory's section is kept too.
+  int dir_fd = mtf::openOutput("dir_inc.out", false);
+  check("directory re-merge", dir_fd >= 0 && mergeMixed(dir_fd)
+                           && incremental.kept == names.size());
+  if(dir_fd >= 0) ::close(dir_fd);
+  check("same bytes", mtf::sameContents("dir_fresh.out", "dir_inc.out"));
+
+  ::rmdir("dir.txt");
+}
+
+
+
+/* ********************************************
+// scaleTest merges 40000 numbered inputs, of
+// which only the last exists, so the numbers
+// run past what a short can hold without
+// writing thousands of files. Merges with and
+// without prefetching must agree, and the last
+// body must come back through the index.
+//
+// ********************************************/
+void scaleTest(void)
+{
+  const unsigned long COUNT = 40000;
+
+  std::cout << "\n  Starting Large File Count Test" << std::endl;
+
+  // Work apart from the corpus the other tests left behind.
+  if(::mkdir("scale", 0755) != 0 || ::chdir("scale") != 0)
+  {
+    check("scale directory", false);
+    return;
+  }
+
+  const std::string body = "The last of many files\n";
+  std::ofstream(std::to_string(COUNT) + ".txt") << body;
+
+  const mtf::InputSet inputs(COUNT);
+
+  check("numbered names", inputs.size() == COUNT && inputs.name(0) == "1.txt"
+                       && inputs.name(COUNT - 1) == "40000.txt");
+
+  // Every section is a header and separator; only the last has a body.
+  unsigned long long expected = body.size() + sizeof(mtf::BODY_TERMINATOR) - 1;
+
+  for(unsigned long number = 1; number <= COUNT; ++number)
+    expected += mtf::sectionHeader(number).size() + sizeof(mtf::SECTION_SEPARATOR) - 1;
+
+  mtf::MergeReport reports[2];
+
+  // Keep 80000 progress lines off the console.
+  std::streambuf * console = std::cout.rdbuf();
+  std::ofstream quiet("scale.log");
+  std::cout.rdbuf(quiet.rdbuf());
+
+  bool plain = mergeTo("scale_plain.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(1 << 16), reports[0]); });
+  bool ahead = mergeTo("scale_ahead.out", [&](int fd)
+    { return mtf::mergeKernel(inputs, fd, 16, reports[1]); });
+
+  std::cout.rdbuf(console);
+
+  check("merge without prefetch", plain && reports[0].bytes == expected);
+  check("merge with prefetch", ahead && reports[1].bytes == expected);
+  check("same bytes", mtf::sameContents("scale_plain.out", "scale_ahead.out"));
+
+  mtf::SectionReader reader;
+  std::string last;
+
+  check("last body", mtf::writeIndex("scale.idx", reports[1].sections)
+                  && reader.open("scale_ahead.out", "scale.idx")
+                  && reader.count() == COUNT
+                  && reader.read(COUNT, last) && last == body
+                  && !reader.read(COUNT - 1, last));
+
+  check("back to scratch", ::chdir("..") == 0);
+}
+
+
+
+/* ********************************************
+// inputTest checks the natural sort, then
+// builds a small export directory with names
+// that sort differently as text, a hidden file,
+// a subdirectory and a symlink, and merges it
+// as a directory, a glob and a list. The output
+// of the merge is put inside the directory, and
+// must not be merged into itself.
+//
+// ********************************************/
+void inputTest(void)
+{
+  std::cout << "\n  Starting Input Set Test" << std::endl;
+
+  check("natural order", mtf::naturalLess("part9.txt", "part10.txt")
+                      && !mtf::naturalLess("part10.txt", "part9.txt")
+                      && mtf::naturalLess("a2b3", "a2b10")
+                      && mtf::naturalLess("a", "b")
+                      && mtf::naturalLess("a", "a1")
+                      && mtf::naturalLess("a01", "a1")
+                      && !mtf::naturalLess("a1", "a01")
+                      && !mtf::naturalLess("same", "same"));
+
+  ::mkdir("export", 0755);
+  ::mkdir("export/sub", 0755);
+
+  const char * names[] = { "part10.txt", "part9.txt", "part1.txt", "notes.md" };
+
+  for(const char * name : names)
+    std::ofstream(std::string("export/") + name) << "Contents of " << name << std::endl;
+
+  std::ofstream("export/.hidden") << "not merged" << std::endl;
+  ::symlink("part1.txt", "export/link.txt");
+
+  // What each kind of input set should find, in order.
+  const std::vector<std::string> by_dir = { "link.txt", "notes.md", "part1.txt",
+                                            "part9.txt", "part10.txt" },
+                                 by_glob = { "part1.txt", "part9.txt", "part10.txt" };
+
+  // The output lives in the directory being merged.
+  int out_fd = mtf::openOutput("export/merged.out");
+  struct stat out_info;
+  ::fstat(out_fd, &out_info);
+
+  mtf::InputSet dir_inputs, glob_inputs, list_inputs;
+  dir_inputs.exclude(out_info);
+
+  bool scanned = dir_inputs.scanDirectory("export") && dir_inputs.size() == by_dir.size();
+
+  for(std::size_t index = 0; scanned && index < by_dir.size(); ++index)
+    scanned = dir_inputs.name(index) == by_dir[index];
+
+  check("directory scan", scanned);
+
+  bool globbed = glob_inputs.scanGlob("export/part*.txt") && glob_inputs.size() == by_glob.size();
+
+  for(std::size_t index = 0; globbed && index < by_glob.size(); ++index)
+    globbed = glob_inputs.name(index) == by_glob[index];
+
+  check("glob scan", globbed);
+  check("wildcard directory refused", !glob_inputs.scanGlob("exp*/part1.txt"));
+
+  // A list keeps its own order, and skips blank lines.
+  std::ofstream("inputs.list") << "export/part10.txt\r\n\nexport/part1.txt\n";
+
+  check("list", list_inputs.readList("inputs.list") && list_inputs.size() == 2
+             && list_inputs.name(0) == "export/part10.txt");
+
+  // Merge the directory; the names are opened relative to it.
+  mtf::MergeReport report = {};
+  std::string expected;
+
+  check("directory merge", mtf::mergeBlocks(dir_inputs, out_fd, blockOptions(4096, 2), report));
+  ::close(out_fd);
+
+  for(std::size_t index = 0; index < by_dir.size(); ++index)
+  {
+    std::string target = by_dir[index] == "link.txt" ? "part1.txt" : by_dir[index];
+
+    expected += mtf::sectionHeader(index + 1) + "Contents of " + target + "\n"
+              + mtf::BODY_TERMINATOR + mtf::SECTION_SEPARATOR;
+  }
+
+  std::ofstream("export.expected") << expected;
+  check("exact bytes", mtf::sameContents("export.expected", "export/merged.out"));
+
+  // A rescan, now that the output exists, must still leave it out.
+  check("output excluded", dir_inputs.scanDirectory("export")
+                        && dir_inputs.size() == by_dir.size());
+}
+
+
+
+/* ********************************************
+// dedupTest merges a set of files holding a
+// few repeated bodies - alongside a file of the
+// same size that differs in its last byte, and
+// duplicates too small to be worth a
+// reference - and checks the exact output, the
+// bytes saved, and that every index entry
+// still gives back the right body. Then it
+// checks that references are weighed against
+// bodies as written when they're cleaned up.
+//
+// ********************************************/
+void dedupTest(void)
+{
+  std::cout << "\n  Starting Dedup Test" << std::endl;
+
+  const std::string chapter(1000, 'c'), other = std::string(999, 'c') + "d";
+
+  // The bodies, and which earlier file (1 based) each repeats, or 0.
+  const std::string bodies[] = { chapter, chapter, other, "", "", "x\n", "x\n", chapter };
+  const unsigned long repeats[] = { 0, 1, 0, 0, 0, 0, 0, 1 };
+  const unsigned long COUNT = sizeof(repeats) / sizeof(repeats[0]);
+
+  std::vector<std::string> names;
+  std::string expected;
+  unsigned long long saved = 0;
+
+  for(unsigned long index = 0; index < COUNT; ++index)
+  {
+    names.push_back("dup" + std::to_string(index + 1) + ".txt");
+    std::ofstream(names[index], std::ios::binary) << bodies[index];
+
+    std::string full = mtf::sectionHeader(index + 1) + bodies[index] + mtf::BODY_TERMINATOR;
+
+    if(repeats[index])
+    {
+      std::string reference = mtf::referenceHeader(index + 1, repeats[index]);
+
+      saved += full.size() - reference.size();
+      full = reference;
+    }
+
+    expected += full + mtf::SECTION_SEPARATOR;
+  }
+
+  std::ofstream("dup.expected", std::ios::binary) << expected;
+
+  const mtf::InputSet inputs(names);
+  mtf::MergeReport report = {};
+
+  check("dedup merge", mergeTo("dup.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(64, 2, true), report); }));
+  check("exact bytes", mtf::sameContents("dup.expected", "dup.out"));
+  check("duplicates counted", report.duplicates == 2 && report.saved == saved);
+
+  mtf::SectionReader reader;
+  bool all_match = mtf::writeIndex("dup.idx", report.sections)
+                && reader.open("dup.out", "dup.idx");
+
+  for(unsigned long index = 0; all_match && index < COUNT; ++index)
+  {
+    std::string body;
+    all_match = reader.read(index + 1, body) && body == bodies[index];
+  }
+
+  check("every body through the index", all_match);
+
+  // With NULs stripped, a copy costs what's written, not what's on disk:
+  // the empty bodies aren't worth a reference, but the CRLF ones are.
+  std::string lines;
+
+  for(unsigned line = 0; line < 100; ++line) lines += "line\r\n";
+
+  const std::string cleaned[] = { std::string(500, '\0'), std::string(500, '\0'), lines, lines };
+  const mtf::TransformOptions clean = { true, mtf::NUL_STRIP, false };
+
+  std::vector<std::string> clean_names;
+  std::string clean_expected;
+
+  for(unsigned long index = 0; index < 4; ++index)
+  {
+    clean_names.push_back("dupclean" + std::to_string(index + 1) + ".txt");
+    std::ofstream(clean_names[index], std::ios::binary) << cleaned[index];
+
+    std::string full = mtf::sectionHeader(index + 1) + transformed(cleaned[index], clean)
+                     + mtf::BODY_TERMINATOR;
+
+    if(index == 3)
+    {
+      std::string reference = mtf::referenceHeader(4, 3);
+
+      saved = full.size() - reference.size();
+      full = reference;
+    }
+
+    clean_expected += full + mtf::SECTION_SEPARATOR;
+  }
+
+  std::ofstream("dupclean.expected", std::ios::binary) << clean_expected;
+
+  check("dedup clean merge", mergeTo("dupclean.out", [&](int fd)
+    { return mtf::mergeBlocks(mtf::InputSet(clean_names), fd, blockOptions(64, 2, true, clean), report); }));
+  check("exact clean bytes", mtf::sameContents("dupclean.expected", "dupclean.out"));
+  check("written bytes saved", report.duplicates == 1 && report.saved == saved);
+}
+
+
+
+/* ********************************************
+// Transforms body as whole with the simplest
+// possible code, to check the kernels against.
+//
+// ********************************************/
+static std::string transformed(const std::string & body, const mtf::TransformOptions & options)
+{
+  std::string result;
+
+  for(std::size_t at = 0; at < body.size(); ++at)
+  {
+    if(options.crlf && body[at] == '\r' && at + 1 < body.size() && body[at + 1] == '\n')
+      continue;
+
+    if(body[at] == '\0' && options.nul == mtf::NUL_STRIP) continue;
+    if(body[at] == '\0' && options.nul == mtf::NUL_ESCAPE) { result += "\\0"; continue; }
+
+    result += body[at];
+  }
+
+  return result;
+}
+
+
+
+/* ********************************************
+// Runs body through a Transform in pieces cut
+// at the given offsets.
+//
+// ********************************************/
+static std::string transformInPieces( mtf::Transform & transform, const std::string & body,
+                                      const std::vector<std::size_t> & cuts )
+{
+  std::string result;
+  std::vector<char> out(2 * body.size() + 2);
+  std::size_t from = 0;
+
+  transform.reset();
+
+  for(std::size_t index = 0; index <= cuts.size(); ++index)
+  {
+    std::size_t to = index < cuts.size() ? cuts[index] : body.size();
+
+    result.append(out.data(), transform.apply(body.data() + from, to - from, out.data()));
+    from = to;
+  }
+
+  result.append(out.data(), transform.finish(out.data()));
+
+  return result;
+}
+
+
+
+/* ********************************************
+// transformTest feeds random bodies full of CR,
+// LF and NUL bytes through every kernel this
+// machine can run, under every set of options,
+// cut at random points (including just after a
+// CR), and checks each result against a simple
+// reference. It then checks the UTF-8 check on
+// good and bad text, and a whole merge through
+// the block copy with both a tiny buffer and a
+// large one.
+//
+// ********************************************/
+void transformTest(void)
+{
+  std::cout << "\n  Starting Transform Test" << std::endl;
+
+  const mtf::TransformKernel kernels[] = { mtf::KERNEL_SCALAR, mtf::KERNEL_SSE2, mtf::KERNEL_AVX2 };
+  const char alphabet[] = { 'a', 'b', '\r', '\n', '\0', ' ' };
+
+  std::srand(11);
+
+  // Random bodies, from empty to long enough to span several registers.
+  std::vector<std::string> bodies;
+  bodies.push_back("");
+  bodies.push_back("\r");
+  bodies.push_back("\r\r\n\0\r");
+  bodies.push_back(std::string(100, 'x') + "\r\n" + std::string(40, '\0') + "\r");
+
+  for(int count = 0; count < 200; ++count)
+  {
+    std::string body(std::rand() % 300, 'a');
+
+    for(char & byte : body)
+      if(std::rand() % 4 == 0) byte = alphabet[std::rand() % sizeof(alphabet)];
+
+    bodies.push_back(body);
+  }
+
+  bool all_match = true;
+
+  for(const mtf::TransformKernel kernel : kernels)
+  {
+    if(!mtf::kernelSupported(kernel)) continue;
+
+    for(int crlf = 0; crlf < 2; ++crlf)
+      for(int nul = mtf::NUL_KEEP; nul <= mtf::NUL_ESCAPE; ++nul)
+      {
+        const mtf::TransformOptions options = { crlf != 0, mtf::NulMode(nul), false };
+        mtf::Transform transform(options, kernel);
+
+        for(const std::string & body : bodies)
+        {
+          // Cut at random offsets, and right after the first CR.
+          std::vector<std::size_t> cuts;
+          std::size_t cr = body.find('\r');
+
+          for(std::size_t at = 0; at < body.size(); at += 1 + std::rand() % 70)
+          {
+            if(cr != std::string::npos && cr < at && (cuts.empty() || cuts.back() <= cr))
+              cuts.push_back(cr + 1);
+            if(cuts.empty() || cuts.back() < at) cuts.push_back(at);
+          }
+
+          all_match = all_match
+                   && transformInPieces(transform, body, std::vector<std::size_t>()) == transformed(body, options)
+                   && transformInPieces(transform, body, cuts) == transformed(body, options);
+        }
+      }
+  }
+
+  check("every kernel matches the reference", all_match);
+
+  // UTF-8: text that is fine, and text that isn't.
+  const std::string ascii(100, 'a');
+  const std::string good[] = { "", ascii, "h\xc3\xa9llo \xe2\x82\xac \xf0\x9d\x84\x9e",
+                               ascii + "\xf4\x8f\xbf\xbf" + ascii + "\xed\x9f\xbf" };
+  const std::string bad[] = { "\xc0\xaf", ascii + "\xed\xa0\x80", "\xf4\x90\x80\x80",
+                              ascii + "\xe0\x80\x80", "\xff", ascii + "\x80",
+                              "abc\xe2\x82" };
+  bool good_pass = true, bad_fail = true;
+
+  for(const mtf::TransformKernel kernel : kernels)
+  {
+    if(!mtf::kernelSupported(kernel)) continue;
+
+    const mtf::TransformOptions options = { false, mtf::NUL_KEEP, true };
+    mtf::Transform transform(options, kernel);
+
+    for(const std::string & text : good)
+    {
+      // Cut every sequence in two to test the carried state.
+      std::vector<std::size_t> cuts;
+
+      for(std::size_t at = 1; at < text.size(); at += 3) cuts.push_back(at);
+
+      good_pass = good_pass && transformInPieces(transform, text, cuts) == text
+               && transform.valid();
+    }
+
+    for(const std::string & text : bad)
+    {
+      transformInPieces(transform, text, std::vector<std::size_t>());
+      bad_fail = bad_fail && !transform.valid();
+    }
+  }
+
+  check("valid UTF-8 accepted", good_pass);
+  check("invalid UTF-8 caught", bad_fail);
+
+  // A merge with CRLF ends and NULs, through a tiny buffer and a big one.
+  const std::string inputs_text[] = { "one\r\ntwo\r\n", std::string(70000, 'x') + "\r\n\0",
+                                      "bad \xff byte\r" };
+  std::vector<std::string> names;
+  std::string expected;
+  const mtf::TransformOptions options = { true, mtf::NUL_ESCAPE, true };
+
+  for(unsigned long index = 0; index < 3; ++index)
+  {
+    names.push_back("crlf" + std::to_string(index + 1) + ".txt");
+    std::ofstream(names[index], std::ios::binary) << inputs_text[index];
+
+    expected += mtf::sectionHeader(index + 1) + transformed(inputs_text[index], options)
+              + mtf::BODY_TERMINATOR + mtf::SECTION_SEPARATOR;
+  }
+
+  std::ofstream("crlf.expected", std::ios::binary) << expected;
+
+  const mtf::InputSet inputs(names);
+
+  for(std::size_t chunk_size : { std::size_t(64), mtf::DEFAULT_CHUNK_SIZE })
+  {
+    mtf::MergeReport report = {};
+
+    check("transformed merge", mergeTo("crlf.out", [&](int fd)
+      { return mtf::mergeBlocks(inputs, fd, blockOptions(chunk_size, 2, false, options), report); }));
+    check("exact bytes", mtf::sameContents("crlf.expected", "crlf.out"));
+    check("invalid file reported", report.invalid_utf8 == std::vector<unsigned long>(1, 3));
+  }
+}
+
+
+
+/* ********************************************
+// sortedTest writes 30 sorted files of random
+// lines - tab separated, in order on the whole
+// line and on the second field, some far longer than
+// the read buffer, one file empty and one with
+// no final newline - and merges them with a
+// fan-in of 4, forcing three passes through
+// temporary runs. The output must match a
+// stable sort of every line, on the whole line
+// and on the second field, with and without
+// unique, and no runs may be left behind.
+//
+// ********************************************/
+void sortedTest(void)
+{
+  std::cout << "\n  Starting Sorted Merge Test" << std::endl;
+
+  const unsigned long COUNT = 30;
+
+  std::srand(12);
+
+  std::vector<std::string> names, all_lines;
+
+  for(unsigned long index = 0; index < COUNT; ++index)
+  {
+    std::vector<std::string> lines;
+    unsigned count = index == 5 ? 0 : std::rand() % 200;
+
+    for(unsigned line = 0; line < count; ++line)
+    {
+      // The first field is the same all through a file and the key
+      // has a fixed width, so the file is in order both ways.
+      char prefix[16];
+      std::snprintf(prefix, sizeof(prefix), "f%02lu\t%02d\t", index, std::rand() % 20);
+
+      std::string text = prefix + std::to_string(std::rand() % 50);
+
+      if(std::rand() % 50 == 0) text += std::string(300, 'z');
+
+      lines.push_back(text);
+    }
+
+    std::sort(lines.begin(), lines.end());
+    all_lines.insert(all_lines.end(), lines.begin(), lines.end());
+
+    std::string body;
+
+    for(const std::string & line : lines) body += line + "\n";
+
+    // Leave one file without its final newline.
+    if(index == 7 && !body.empty()) body.erase(body.size() - 1);
+
+    names.push_back("sorted" + std::to_string(index + 1) + ".txt");
+    std::ofstream(names[index], std::ios::binary) << body;
+  }
+
+  ::mkdir("runs", 0700);
+
+  const mtf::InputSet inputs(names);
+
+  // The second field of a line.
+  auto field = [](const std::string & line)
+  {
+    std::size_t first = line.find('\t') + 1;
+    return line.substr(first, line.find('\t', first) - first);
+  };
+
+  for(int keyed = 0; keyed < 2; ++keyed)
+    for(int unique = 0; unique < 2; ++unique)
+    {
+      std::vector<std::string> lines = all_lines;
+
+      // The lines were gathered in input order, so a stable sort keeps ties in it.
+      if(keyed)
+        std::stable_sort(lines.begin(), lines.end(), [&](const std::string & fst, const std::string & snd)
+          { return field(fst) < field(snd); });
+      else
+        std::stable_sort(lines.begin(), lines.end());
+
+      std::string expected, last;
+
+      for(std::size_t at = 0; at < lines.size(); ++at)
+      {
+        std::string key = keyed ? field(lines[at]) : lines[at];
+
+        if(unique && at > 0 && key == last) continue;
+
+        expected += lines[at] + "\n";
+        last = key;
+      }
+
+      std::ofstream("sorted.expected", std::ios::binary) << expected;
+
+      mtf::SortOptions options = mtf::SORT_DEFAULTS;
+      options.unique = unique != 0;
+      options.key_field = keyed ? 2 : 0;
+      options.fan_in = 4;
+      options.buffer_size = 64;
+      options.temp_dir = "runs";
+
+      mtf::MergeReport report = {};
+      mtf::SortReport sort_report = {};
+
+      check("sorted merge", mergeTo("sorted.out", [&](int fd)
+        { return mtf::mergeSorted(inputs, fd, options, report, sort_report); }));
+      check("matches a full sort", mtf::sameContents("sorted.expected", "sorted.out"));
+      check("three passes", sort_report.passes == 3);
+    }
+
+  check("runs cleaned up", ::rmdir("runs") == 0);
+}
+
+
+
+/* ********************************************
+// writerTest pushes the same mix of small and
+// large appends and file copies through a
+// Writer in each mode - plain, background, and
+// O_DIRECT with and without the background -
+// with a buffer small enough to fill many
+// times, and checks the bytes, the write count
+// and that O_DIRECT is off again afterwards.
+// Transformed copies must keep O_DIRECT on until
+// the final tail. A block copy merge with
+// O_DIRECT must match one without.
+//
+// ********************************************/
+void writerTest(void)
+{
+  std::cout << "\n  Starting Writer Test" << std::endl;
+
+  const mtf::WriteOptions modes[] = { mtf::WRITE_PLAIN, mtf::WRITE_BACKGROUND,
+                                      { false, true }, { true, true } };
+
+  std::srand(13);
+
+  std::string source(100000, ' ');
+  for(char & byte : source) byte = 'a' + std::rand() % 26;
+  std::ofstream("writer.src", std::ios::binary) << source;
+
+  // Appends of every size, from a byte to several buffers' worth.
+  std::vector<std::size_t> sizes;
+  for(int count = 0; count < 200; ++count)
+    sizes.push_back(count % 20 == 0 ? 20000 + std::rand() % 20000 : std::rand() % 300);
+
+  std::string expected;
+
+  for(std::size_t size : sizes)
+  {
+    expected += source.substr(0, size);
+    if(size > 20000) expected += source;
+  }
+
+  std::ofstream("writer.expected", std::ios::binary) << expected;
+
+  for(const mtf::WriteOptions & mode : modes)
+  {
+    int fd = mtf::openOutput("writer.out");
+    bool ok = fd >= 0;
+    unsigned long writes = 0;
+
+    {
+      mtf::Writer out(fd, 8192, 0, mode);
+
+      for(std::size_t size : sizes)
+      {
+        ok = ok && out.append(source.data(), size);
+
+        // Copy the whole source after each large append.
+        if(ok && size > 20000)
+        {
+          int in_fd = ::open("writer.src", O_RDONLY);
+          ok = in_fd >= 0 && out.copyFrom(in_fd);
+          if(in_fd >= 0) ::close(in_fd);
+        }
+      }
+
+      ok = ok && out.flush();
+      writes = out.writes();
+    }
+
+    ok = ok && (::fcntl(fd, F_GETFL) & O_DIRECT) == 0;
+    ok = (::close(fd) == 0) && ok;
+
+    check("writer mode", ok);
+    check("exact bytes", mtf::sameContents("writer.expected", "writer.out"));
+    // Large appends skip the buffer, so there may be fewer writes than buffers.
+    check("writes counted", writes > 0 && writes < expected.size() / 4096);
+  }
+
+  // Transformed copies with O_DIRECT, through a buffer that holds a
+  // few transformed blocks, so blocks often don't fit in what's left.
+  std::string crlf, lf;
+
+  for(int line = 0; line < 20000; ++line)
+  {
+    std::string text = source.substr(line % 1000, 10 + line % 17);
+
+    crlf += text + "\r\n";
+    lf += text + "\n";
+  }
+
+  std::ofstream("writer.crlf", std::ios::binary) << crlf;
+  std::ofstream("writer.expected", std::ios::binary) << lf << lf << lf;
+
+  {
+    const mtf::TransformOptions options = { true, mtf::NUL_KEEP, false };
+    mtf::Transform transform(options);
+    int fd = mtf::openOutput("writer.out");
+    bool ok = fd >= 0, still_direct = false;
+
+    {
+      mtf::Writer out(fd, 256 * 1024, 0, mtf::WriteOptions{ false, true });
+
+      for(int copy = 0; ok && copy < 3; ++copy)
+      {
+        int in_fd = ::open("writer.crlf", O_RDONLY);
+
+        transform.reset();
+        ok = in_fd >= 0 && out.transformFrom(in_fd, NULL, transform);
+        if(in_fd >= 0) ::close(in_fd);
+      }
+
+      still_direct = (::fcntl(fd, F_GETFL) & O_DIRECT) != 0;
+      ok = ok && out.flush();
+    }
+
+    ok = (::close(fd) == 0) && ok;
+
+    check("direct transform", ok);
+    check("direct kept through transform", still_direct);
+    check("transformed bytes", mtf::sameContents("writer.expected", "writer.out"));
+  }
+
+  // A merge written with O_DIRECT.
+  writeCorpus(20);
+
+  const mtf::InputSet inputs(20);
+  mtf::BlockOptions direct = blockOptions(4096);
+  direct.write.direct = true;
+  mtf::MergeReport reports[2] = {};
+
+  check("plain merge", mergeTo("plain.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), reports[0]); }));
+  check("direct merge", mergeTo("direct.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, direct, reports[1]); }));
+  check("same bytes", mtf::sameContents("plain.out", "direct.out"));
+  check("writes reported", reports[1].writes > 0);
+}
+
+
+
+/* ********************************************
+// Inflates every gzip member in a file, one
+// after another, as gzip -d would.
+//
+// ********************************************/
+static bool gunzip(const char * path, std::string & text)
+{
+  std::ifstream in(path, std::ios::binary);
+  std::string packed((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  z_stream stream = z_stream();
+  char output[4096];
+
+  if(inflateInit2(&stream, 15 + 16) != Z_OK) return false;
+
+  stream.next_in = reinterpret_cast<Bytef *>(&packed[0]);
+  stream.avail_in = packed.size();
+  text.clear();
+
+  int status = Z_OK;
+
+  while(stream.avail_in > 0 && (status == Z_OK || status == Z_STREAM_END))
+  {
+    if(status == Z_STREAM_END) inflateReset(&stream);
+
+    stream.next_out = reinterpret_cast<Bytef *>(output);
+    stream.avail_out = sizeof(output);
+    status = inflate(&stream, Z_NO_FLUSH);
+    text.append(output, sizeof(output) - stream.avail_out);
+  }
+
+  inflateEnd(&stream);
+
+  return status == Z_STREAM_END;
+}
+
+
+
+/* ********************************************
+// gzipTest merges a corpus with one big file
+// in it into gzip output, with small blocks and
+// several threads, and checks that it inflates
+// to exactly the plain merge, that members only
+// start mid section inside the big file, and
+// that every file comes back out through the
+// version 2 index.
+//
+// ********************************************/
+void gzipTest(void)
+{
+  std::cout << "\n  Starting Gzip Test" << std::endl;
+
+  writeCorpus(40);
+
+  // Make file 20 big enough to be cut into several members.
+  std::string big;
+  for(int line = 0; big.size() < 100000; ++line)
+    big += "Big file, line " + std::to_string(line) + "\n";
+  std::ofstream("20.txt", std::ios::binary) << big;
+
+  const mtf::InputSet inputs(40);
+  mtf::BlockOptions options = blockOptions(4096);
+  options.gzip.enabled = true;
+  options.gzip.threads = 3;
+  options.gzip.block_size = 4096;
+
+  mtf::MergeReport plain = {}, packed = {};
+
+  check("plain merge", mergeTo("gzip.txt", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), plain); }));
+  check("gzip merge", mergeTo("gzip.txt.gz", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, options, packed); }));
+
+  std::string text;
+  std::ofstream out("gzip.inflated", std::ios::binary);
+  check("inflates", gunzip("gzip.txt.gz", text) && (out << text).flush());
+  check("same text as plain", mtf::sameContents("gzip.txt", "gzip.inflated"));
+  check("several members", packed.members.size() > 5 && packed.compressed < packed.bytes);
+
+  // Members start at a section, except inside the big file.
+  bool aligned = true;
+  const mtf::IndexEntry & big_entry = packed.sections[19];
+
+  for(const mtf::GzipMember & member : packed.members)
+  {
+    bool inside_big = member.start > big_entry.offset
+                   && member.start < big_entry.offset + big_entry.length;
+    bool at_section = member.start == 0;
+
+    for(unsigned long index = 0; !at_section && index < 40; ++index)
+      at_section = member.start == packed.sections[index].offset
+                                 - mtf::sectionHeader(index + 1).size();
+
+    aligned = aligned && (at_section || inside_big);
+  }
+
+  check("members start at sections", aligned);
+
+  mtf::SectionReader reader;
+  bool all_match = mtf::writeIndex("gzip.txt.idx", packed.sections, packed.members)
+                && reader.open("gzip.txt.gz", "gzip.txt.idx") && reader.compressed();
+
+  for(unsigned long index = 0; all_match && index < 40; ++index)
+  {
+    std::ifstream in(std::to_string(index + 1) + ".txt", std::ios::binary);
+    std::string body, original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    all_match = reader.read(index + 1, body) && body == original;
+  }
+
+  check("every file through the index", all_match);
+}
+
+
+
+/* ********************************************
+// statsTest checks the latency histogram's
+// percentiles on known durations, then runs
+// each serial merge and the parallel merge with
+// everything counted, and checks the calls, the
+// files timed and the JSON report, which for
+// an io_uring merge has the ring's counts.
+//
+// ********************************************/
+void statsTest(void)
+{
+  std::cout << "\n  Starting Stats Test" << std::endl;
+
+  // 1..1000 microseconds: the percentiles are within a bucket (1/8).
+  mtf::LatencyHistogram latency, copy;
+
+  for(unsigned long long micros = 1; micros <= 1000; ++micros)
+    latency.record(micros * 1000);
+
+  unsigned long long p50 = latency.percentile(0.5), p99 = latency.percentile(0.99);
+
+  check("durations counted", latency.count() == 1000 && latency.maximum() == 1000000);
+  check("p50 close", p50 >= 500000 && p50 <= 500000 * 9 / 8);
+  check("p99 close", p99 >= 990000 && p99 <= 1000000);
+  check("empty histogram", mtf::LatencyHistogram().percentile(0.5) == 0);
+
+  copy.record(3);
+  check("small durations exact", copy.percentile(0.99) == 3);
+  copy = mtf::LatencyHistogram();
+
+  copy.merge(latency);
+  copy.merge(latency);
+
+  check("histograms merge", copy.count() == 2000 && copy.percentile(0.5) == p50);
+
+  writeCorpus(30);
+
+  const mtf::InputSet inputs(30);
+  mtf::countCalls(true);
+  mtf::timeFiles(true);
+
+  mtf::MergeReport report = {};
+
+  check("block merge", mergeTo("stats.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), report); }));
+  check("every file timed", report.latency.count() == 30);
+  check( "opens and writes counted", mtf::callCount(mtf::CALL_OPEN) == 30
+         && mtf::callCount(mtf::CALL_READ) >= 30 && mtf::callCount(mtf::CALL_WRITE) > 0 );
+  check("time spent", mtf::callSeconds(mtf::CALL_READ) > 0);
+
+  check("stats written", mtf::writeStats("stats.json", "block", report));
+
+  std::ifstream in("stats.json");
+  std::string json((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  bool keys = json.size() > 2 && json[0] == '{' && json[json.size() - 2] == '}';
+
+  const char * names[] = { "\"mode\": \"block\"", "\"files\": 30", "\"files_per_second\"",
+                           "\"mb_per_second\"", "\"p50\"", "\"p99\"", "\"max\"",
+                           "\"open\": { \"calls\": 30", "\"read\"", "\"write\"", "\"copy\"" };
+
+  for(const char * name : names)
+    keys = keys && json.find(name) != std::string::npos;
+
+  check("report has every key", keys);
+
+  // A ring merge reports its own counts, not latencies and calls it didn't time.
+  mtf::UringReport uring_report = { true, 4, 90, 30 };
+
+  check("uring stats written", mtf::writeStats("uring.json", "uring", report, &uring_report));
+
+  std::ifstream uring_in("uring.json");
+  json.assign((std::istreambuf_iterator<char>(uring_in)), std::istreambuf_iterator<char>());
+
+  check( "uring report has its counts", json.find("\"submissions\": 4") != std::string::npos
+         && json.find("\"operations\": 90") != std::string::npos
+         && json.find("\"latency_us\"") == std::string::npos
+         && json.find("\"syscalls\"") == std::string::npos );
+
+  // The kernel copy's bodies are counted as copies; the parallel one times each thread.
+  mtf::countCalls(true);
+
+  check("kernel merge", mergeTo("stats.out", [&](int fd)
+    { return mtf::mergeKernel(inputs, fd, 0, report); }));
+  check( "kernel copies counted", report.latency.count() == 30
+         && mtf::callCount(mtf::CALL_COPY) + mtf::callCount(mtf::CALL_READ) >= 30 );
+
+  check("parallel merge", mergeTo("stats.out", [&](int fd)
+    { return mtf::mergeParallel(inputs, fd, 4, report); }));
+  check("parallel files timed", report.latency.count() == 30);
+
+  // Nothing is kept once it's turned off.
+  mtf::countCalls(false);
+  mtf::timeFiles(false);
+
+  check("untimed merge", mergeTo("stats.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), report); }));
+  check( "nothing counted", report.latency.count() == 0
+         && mtf::callCount(mtf::CALL_OPEN) == 0 );
+}
+
+
+
+/* ********************************************
+// Checks that the parts of a split, parts/1.txt
+// onwards, hold bodies, except for the missing
+// one (1 based), which should have no part. The
+// parts are removed as they are checked.
+//
+// ********************************************/
+static bool partsMatch(const std::vector<std::string> & bodies, std::size_t missing)
+{
+  bool match = true;
+
+  for(std::size_t index = 0; match && index < bodies.size(); ++index)
+  {
+    std::string path = "parts/" + std::to_string(index + 1) + ".txt";
+    std::ifstream in(path, std::ios::binary);
+    std::string part((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+    match = index + 1 == missing ? !in.is_open() : in.is_open() && part == bodies[index];
+    ::unlink(path.c_str());
+  }
+
+  return match;
+}
+
+
+
+/* ********************************************
+// splitTest merges files with awkward bodies -
+// text that looks like headers, a body too big
+// for one scanning thread, duplicates and a
+// missing file - then splits the merge using the
+// index, by scanning, and after an edit that
+// leaves the index stale, and merges the edited
+// parts back into the same bytes. A gzip merge
+// must split into the same parts.
+//
+// ********************************************/
+void splitTest(void)
+{
+  std::cout << "\n  Starting Split Test" << std::endl;
+
+  std::string big;
+  while(big.size() < (3 << 20)) big += "text\nFILE #9 is mentioned here\n";
+
+  // Bodies by file; file 6 doesn't exist, while file 8 is empty.
+  const std::string chapter = "one chapter, long enough to dedup\n";
+  std::vector<std::string> bodies = { chapter, "see\nFILE #3\nbelow\n", big,
+                                      "a\n\n\n\n\nFILE #1\n\n\nb\n", chapter, "",
+                                      "no newline", "", chapter };
+  const std::size_t MISSING = 6;
+  std::vector<std::string> names;
+
+  for(std::size_t index = 0; index < bodies.size(); ++index)
+  {
+    names.push_back("split" + std::to_string(index + 1) + ".txt");
+    if(index + 1 != MISSING) std::ofstream(names[index], std::ios::binary) << bodies[index];
+  }
+
+  const mtf::InputSet inputs(names);
+  mtf::MergeReport report = {};
+  mtf::SplitOptions options = { 4, "parts", true };
+  mtf::SplitReport split_report = {};
+
+  ::mkdir("parts", 0755);
+
+  check("dedup merge", mergeTo("split.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096, 2, true), report); }));
+  check("index written", mtf::writeIndex("split.idx", report.sections));
+
+  std::vector<std::string> expected = bodies;
+
+  check("split by index", mtf::splitMerge("split.out", "split.idx", options, split_report));
+  check("index used", split_report.indexed && split_report.files == bodies.size());
+  check( "references and missing counted",
+         split_report.references == 2 && split_report.missing == 1 );
+  check("parts match", partsMatch(expected, MISSING));
+
+  options.use_index = false;
+
+  check("split by scan", mtf::splitMerge("split.out", NULL, options, split_report));
+  check("scanned", !split_report.indexed && split_report.files == bodies.size());
+  check("scanned parts match", partsMatch(expected, MISSING));
+
+  // Edit a merge without dedup, so its index no longer fits.
+  check("plain merge", mergeTo("plain.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, blockOptions(4096), report); }));
+  check("plain index", mtf::writeIndex("plain.idx", report.sections));
+
+  std::ifstream in("plain.out", std::ios::binary);
+  std::string merged((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+  std::size_t first = merged.find(chapter);
+
+  merged.replace(first, chapter.size(), "one, edited\n");
+  std::ofstream("edited.out", std::ios::binary) << merged;
+
+  options.use_index = true;
+  expected[0] = "one, edited\n";
+
+  check("split edited", mtf::splitMerge("edited.out", "plain.idx", options, split_report));
+  check("stale index ignored", !split_report.indexed && split_report.references == 0);
+
+  // Merge the parts again (before partsMatch removes them).
+  std::vector<std::string> parts;
+  for(std::size_t index = 0; index < bodies.size(); ++index)
+    parts.push_back("parts/" + std::to_string(index + 1) + ".txt");
+
+  const mtf::InputSet again(parts);
+
+  check("merge parts", mergeTo("again.out", [&](int fd)
+    { return mtf::mergeBlocks(again, fd, blockOptions(4096), report); }));
+  check("round trip", mtf::sameContents("edited.out", "again.out"));
+  check("edited parts match", partsMatch(expected, MISSING));
+
+  // A gzip merge is split from its text, with or without its index.
+  mtf::BlockOptions gzip = blockOptions(4096);
+  gzip.gzip.enabled = true;
+  gzip.gzip.block_size = 4096;
+
+  check("gzip merge", mergeTo("split.out.gz", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, gzip, report); }));
+  check("gzip index", mtf::writeIndex("split.gz.idx", report.sections, report.members));
+  check("several members", report.members.size() > 1);
+
+  check("split gzip by index", mtf::splitMerge("split.out.gz", "split.gz.idx", options, split_report));
+  check("gzip index used", split_report.indexed && split_report.files == bodies.size());
+  check("gzip parts match", partsMatch(bodies, MISSING));
+
+  options.use_index = false;
+
+  check("split gzip by scan", mtf::splitMerge("split.out.gz", NULL, options, split_report));
+  check("gzip parts scanned", !split_report.indexed && partsMatch(bodies, MISSING));
+
+  // A cut off gzip merge is refused rather than split short.
+  std::ifstream packed("split.out.gz", std::ios::binary);
+  std::string zipped((std::istreambuf_iterator<char>(packed)), std::istreambuf_iterator<char>());
+  std::ofstream("cut.out.gz", std::ios::binary) << zipped.substr(0, zipped.size() - 10);
+  errno = 0;
+
+  check( "cut off gzip", !mtf::splitMerge("cut.out.gz", NULL, options, split_report)
+                         && errno == EINVAL );
+
+  // Anything that isn't a merge is refused.
+  std::ofstream("notmerged.txt") << "\nFILE #1\n\n\nno separator";
+  errno = 0;
+
+  check( "not a merge", !mtf::splitMerge("notmerged.txt", NULL, options, split_report)
+                        && errno == EINVAL );
+}
+
+
+
+/* ********************************************
+// The lines of bodies that hold (or start
+// with) one of literals, each ending in a
+// newline, optionally with headers, as a
+// filtered merge should write them.
+//
+// ********************************************/
+static std::string filtered( const std::vector<std::string> & bodies,
+                             const mtf::FilterOptions & options )
+{
+  std::string expected;
+
+  for(std::size_t index = 0; index < bodies.size(); ++index)
+  {
+    std::string kept;
+    std::size_t at = 0;
+
+    while(at < bodies[index].size())
+    {
+      std::size_t end = bodies[index].find('\n', at);
+      std::string line = bodies[index].substr(at, end == std::string::npos ? end : end - at);
+
+      for(const std::string & literal : options.literals)
+        if(options.prefix ? line.compare(0, literal.size(), literal) == 0
+                          : line.find(literal) != std::string::npos)
+        {
+          kept += line + "\n";
+          break;
+        }
+
+      at = end == std::string::npos ? bodies[index].size() : end + 1;
+    }
+
+    if(kept.empty()) continue;
+
+    if(options.headers)
+      kept = mtf::sectionHeader(index + 1) + kept + mtf::BODY_TERMINATOR + mtf::SECTION_SEPARATOR;
+
+    expected += kept;
+  }
+
+  return expected;
+}
+
+
+
+/* ********************************************
+// filterTest checks each search kernel against
+// std::string::find on random text, including
+// literals shorter than the 3 byte fingerprint
+// and more literals than buckets, then runs
+// filtered merges in each mode and compares
+// them with the lines picked out by hand.
+//
+// ********************************************/
+void filterTest(void)
+{
+  std::cout << "\n  Starting Filter Test" << std::endl;
+
+  const mtf::TransformKernel kernels[] = { mtf::KERNEL_SCALAR, mtf::KERNEL_SSE2, mtf::KERNEL_AVX2 };
+  const std::vector<std::string> sets[] =
+  {
+    { "abc" },
+    { "b" },
+    { "ab", "ca", "bbb" },
+    { "cab", "acb", "bca", "aaaa", "cc", "bab", "abba", "cbc", "acca", "baab", "ccb" }
+  };
+
+  std::srand(17);
+
+  std::string text(5000, 'a');
+  for(char & byte : text) byte = "abc\n"[std::rand() % 4];
+
+  bool all_match = true;
+
+  for(const std::vector<std::string> & set : sets)
+  {
+    const mtf::FilterOptions options = { set, false, false };
+
+    for(const mtf::TransformKernel kernel : kernels)
+    {
+      if(!mtf::kernelSupported(kernel)) continue;
+
+      mtf::LineFilter filter(options, kernel);
+
+      for(std::size_t from = 0; all_match && from < 300; from += 7)
+        for(std::size_t len = from; all_match && len <= text.size(); len += 97)
+        {
+          std::size_t first = len;
+
+          for(const std::string & literal : set)
+          {
+            std::size_t at = text.find(literal, from);
+            if(at != std::string::npos && at + literal.size() <= len) first = std::min(first, at);
+          }
+
+          all_match = filter.find(text.data(), from, len) == first;
+        }
+    }
+  }
+
+  check("kernels find the first literal", all_match);
+
+  // Bodies: no trailing newline, a line longer than the buffer, an
+  // empty file, a missing one, and matches at every edge of a line.
+  std::string longest(200000, 'z');
+  longest.replace(150000, 5, "ERROR");
+
+  std::vector<std::string> bodies = { "ERROR one\nfine\nWARN two\n", "fine\n",
+                                      "x ERROR\nERROR\nERRO\nlast ERROR", longest + "\nERRORS\n",
+                                      "", "", "WARN\n\nERROR\n" };
+  std::vector<std::string> names;
+
+  for(std::size_t index = 0; index < bodies.size(); ++index)
+  {
+    names.push_back("filter" + std::to_string(index + 1) + ".txt");
+    if(index != 5) std::ofstream(names[index], std::ios::binary) << bodies[index];
+  }
+
+  const mtf::InputSet inputs(names);
+  const mtf::FilterOptions modes[] =
+  {
+    { { "ERROR", "WARN" }, false, false },
+    { { "ERROR" }, true, false },
+    { { "ERROR", "two" }, false, true },
+    { { "nothing" }, false, true }
+  };
+
+  for(const mtf::FilterOptions & mode : modes)
+  {
+    mtf::MergeReport report = {};
+    mtf::FilterReport filter_report = {};
+
+    std::ofstream("filter.expected", std::ios::binary) << filtered(bodies, mode);
+
+    check("filtered merge", mergeTo("filter.out", [&](int fd)
+      { return mtf::mergeFiltered( inputs, fd, blockOptions(4096), mode,
+                                   report, filter_report ); }));
+    check("kept lines", mtf::sameContents("filter.expected", "filter.out"));
+    check("missing file counted", filter_report.unreadable == 1);
+  }
+}
+
+
+
+/* ********************************************
+// batchTest runs a job file of merges over
+// directories, a glob and a list, with jobs
+// that can't run mixed in, and checks each
+// output against a merge of its own and each
+// job's status. More jobs than threads make
+// threads reuse their buffers.
+//
+// ********************************************/
+void batchTest(void)
+{
+  std::cout << "\n  Starting Batch Test" << std::endl;
+
+  ::mkdir("jobs", 0755);
+
+  // Job directories of very different sizes.
+  for(int dir = 0; dir < 4; ++dir)
+  {
+    std::string path = "jobs/" + std::to_string(dir);
+
+    ::mkdir(path.c_str(), 0755);
+
+    for(int file = 0; file <= dir * 3; ++file)
+    {
+      std::ofstream out(path + "/" + std::to_string(file) + ".txt");
+
+      for(int line = 0; line < (dir == 2 ? 40000 : 5); ++line)
+        out << "job " << dir << ", file " << file << ", line " << line << "\n";
+    }
+  }
+
+  std::ofstream("jobs/list.txt") << "jobs/3/1.txt\njobs/0/0.txt\n";
+  std::ofstream("jobs.txt") << "# output, kind, source\n"
+                            << "jobs/0.out dir jobs/0\n"
+                            << "jobs/1.out   dir   jobs/1  \n\n"
+                            << "jobs/2.out dir jobs/2\n"
+                            << "jobs/3.out glob jobs/3/*.txt\n"
+                            << "jobs/4.out list jobs/list.txt\n"
+                            << "jobs/5.out dir jobs/none\n"
+                            << "jobs/0.out dir jobs/1\n";
+
+  std::vector<mtf::BatchJob> jobs;
+  unsigned long bad_line = 0;
+
+  check("job file read", mtf::readJobs("jobs.txt", jobs, bad_line) && jobs.size() == 7);
+  check( "job fields", jobs[1].line == 3 && jobs[1].output == "jobs/1.out"
+                       && jobs[1].kind == mtf::SOURCE_DIR && jobs[1].source == "jobs/1"
+                       && jobs[3].kind == mtf::SOURCE_GLOB && jobs[4].kind == mtf::SOURCE_LIST );
+
+  mtf::BatchOptions options = { 2, blockOptions(4096, 2), true };
+  mtf::MergeReport report = {};
+
+  check("batch reports failures", !mtf::runBatch(jobs, options, report));
+  check( "missing source fails", !jobs[5].ok
+         && jobs[5].error.find("jobs/none") != std::string::npos );
+  check( "repeated output fails", !jobs[6].ok
+         && jobs[6].error == "same output as line 2" );
+
+  bool each = true;
+  unsigned long files = 0;
+
+  // Every good job must match the same merge run on its own.
+  for(std::size_t index = 0; index < 5; ++index)
+  {
+    mtf::InputSet inputs;
+    mtf::MergeReport single = {};
+
+    if(index == 3) inputs.scanGlob("jobs/3/*.txt");
+    else if(index == 4) inputs.readList("jobs/list.txt");
+    else inputs.scanDirectory(jobs[index].source.c_str());
+
+    each = each && jobs[index].ok && jobs[index].files == inputs.size()
+        && mergeTo("jobs/single.out", [&](int fd)
+             { return mtf::mergeBlocks(inputs, fd, options.block, single); })
+        && mtf::sameContents("jobs/single.out", jobs[index].output.c_str())
+        && jobs[index].bytes == single.bytes;
+
+    mtf::SectionReader reader;
+    std::string body;
+
+    each = each && reader.open(jobs[index].output.c_str(),
+                               mtf::indexPathFor(jobs[index].output.c_str()).c_str())
+        && reader.read(1, body)
+        && body.compare(0, 5, "job " + std::to_string(index < 3 ? index : 3)) == 0;
+
+    files += jobs[index].files;
+  }
+
+  check("jobs match single merges", each);
+  check("jobs sized", jobs[2].size > jobs[3].size && jobs[3].size > jobs[0].size);
+  check("batch totals", report.files == files);
+
+  // A line without a source is refused.
+  std::ofstream("badjobs.txt") << "jobs/0.out dir jobs/0\njobs/1.out dir\n";
+  jobs.clear();
+
+  check( "bad job line", !mtf::readJobs("badjobs.txt", jobs, bad_line)
+                         && bad_line == 2 && errno == EINVAL );
+}
+
+
+
+/* ********************************************
+// mapTest merges files of many sizes - empty,
+// missing, duplicated, and one over a mapping
+// window - with every input read, then mapped
+// (all, or only the large ones) into a file
+// with plain and background writes, with dedup,
+// and into a slow pipe, and checks that every
+// output is the same.
+//
+// ********************************************/
+void mapTest(void)
+{
+  std::cout << "\n  Starting Mapped Input Test" << std::endl;
+
+  std::vector<std::string> names;
+  std::string body;
+
+  for(int index = 0; index < 12; ++index)
+  {
+    names.push_back("map" + std::to_string(index) + ".txt");
+
+    // File 3 is missing and file 5 is empty.
+    if(index == 3) continue;
+
+    std::size_t size = index == 5 ? 0 : index == 11 ? (64 << 20) + 5000 : 1000 << index;
+
+    body.assign(size, 'm');
+    for(std::size_t at = 0; at < size; at += 97) body[at] = at % 2 ? '\n' : 'a' + at % 26;
+
+    std::ofstream(names.back(), std::ios::binary) << body;
+  }
+
+  // A copy of file 9, for dedup.
+  names.push_back("map9.txt");
+
+  const mtf::InputSet inputs(names);
+  mtf::MergeReport report = {};
+  mtf::BlockOptions options = blockOptions(8192, 2);
+
+  options.map = mtf::MMAP_NEVER;
+
+  check("read merge", mergeTo("read.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, options, report); }));
+
+  const unsigned long read_writes = report.writes;
+
+  options.map = mtf::MMAP_ALWAYS;
+
+  for(int background = 0; background < 2; ++background)
+  {
+    options.write.background = background;
+
+    check("mapped merge", mergeTo("mapped.out", [&](int fd)
+      { return mtf::mergeBlocks(inputs, fd, options, report); }));
+    check("same bytes", mtf::sameContents("read.out", "mapped.out"));
+  }
+
+  // Big bodies skip the buffer, so there are fewer writes.
+  check("fewer writes", report.writes < read_writes);
+
+  options.map = mtf::MMAP_AUTO;
+  options.map_threshold = 300000;
+
+  check("auto merge", mergeTo("mapped.out", [&](int fd)
+    { return mtf::mergeBlocks(inputs, fd, options, report); }));
+  check("same bytes", mtf::sameContents("read.out", "mapped.out"));
+
+  // Dedup hashes the mapped bodies too.
+  mtf::MergeReport dedup_reports[2] = {};
+
+  for(int map = 0; map < 2; ++map)
+  {
+    options.dedup = true;
+    options.map = map ? mtf::MMAP_ALWAYS : mtf::MMAP_NEVER;
+
+    check("dedup merge", mergeTo(map ? "dedup_mapped.out" : "dedup_read.out", [&](int fd)
+      { return mtf::mergeBlocks(inputs, fd, options, dedup_reports[map]); }));
+  }
+
+  check("dedup same bytes", mtf::sameContents("dedup_read.out", "dedup_mapped.out"));
+  check("duplicate found", dedup_reports[1].duplicates == 1);
+
+  // A non-blocking pipe, drained by a thread.
+  int ends[2];
+
+  if(::pipe(ends) != 0) { check("pipe", false); return; }
+
+  std::thread reader([&]()
+  {
+    int out_fd = mtf::openOutput("pipe_mapped.out");
+    char block[65536];
+    ssize_t got = 0;
+
+    while((got = ::read(ends[0], block, sizeof(block))) > 0)
+      mtf::writeAll(out_fd, block, got);
+
+    ::close(out_fd);
+  });
+
+  ::fcntl(ends[1], F_SETFL, O_NONBLOCK);
+
+  options.dedup = false;
+  options.map = mtf::MMAP_ALWAYS;
+
+  bool ok = mtf::mergeBlocks(inputs, ends[1], options, report);
+
+  ::close(ends[1]);
+  reader.join();
+  ::close(ends[0]);
+
+  check("mapped merge into pipe", ok);
+  check("same bytes", mtf::sameContents("read.out", "pipe_mapped.out"));
+
+  for(const std::string & name : names) ::unlink(name.c_str());
+}
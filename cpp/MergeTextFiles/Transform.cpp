@@ -0,0 +1,387 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Transform.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of Transform, declared in
+// Transform.h. The vector kernels only search: they
+// compare a whole register of input against CR and
+// NUL at once and return the position of the first
+// hit, and the clean runs in between are copied with
+// memcpy. Only the bytes that need work are handled
+// one at a time, by code shared by every kernel, which
+// is what keeps the kernels' output identical. The
+// UTF-8 check skips whole registers of ASCII the same
+// way, and walks anything else through a small state
+// machine.
+//
+// ******************************************************/
+
+#include "Transform.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MTF_X86 1
+#endif
+
+
+// What a NUL is escaped as.
+static const char NUL_ESCAPE_TEXT[2] = { '\\', '0' };
+
+
+#ifdef MTF_X86
+
+// SSE2: the offset of the first CR (if find_cr) or NUL (if find_nul)
+// in in[from, len), or len.
+static std::size_t findSse2( const char * in, std::size_t from, std::size_t len,
+                             bool find_cr, bool find_nul )
+{
+  const __m128i cr = _mm_set1_epi8(find_cr ? '\r' : '\0'),
+                nul = _mm_set1_epi8(find_nul ? '\0' : '\r');
+
+  for(; from + 16 <= len; from += 16)
+  {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(in + from));
+    int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, cr),
+                                              _mm_cmpeq_epi8(block, nul)));
+
+    if(mask) return from + __builtin_ctz(mask);
+  }
+
+  for(; from < len; ++from)
+    if((find_cr && in[from] == '\r') || (find_nul && in[from] == '\0')) return from;
+
+  return len;
+}
+
+
+// AVX2: as findSse2, 32 bytes at a time.
+__attribute__((target("avx2")))
+static std::size_t findAvx2( const char * in, std::size_t from, std::size_t len,
+                             bool find_cr, bool find_nul )
+{
+  const __m256i cr = _mm256_set1_epi8(find_cr ? '\r' : '\0'),
+                nul = _mm256_set1_epi8(find_nul ? '\0' : '\r');
+
+  for(; from + 32 <= len; from += 32)
+  {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + from));
+    unsigned mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, cr),
+                                                         _mm256_cmpeq_epi8(block, nul)));
+
+    if(mask) return from + __builtin_ctz(mask);
+  }
+
+  return findSse2(in, from, len, find_cr, find_nul);
+}
+
+
+// SSE2: the offset of the first byte in in[from, len) with its top
+// bit set, or len.
+static std::size_t asciiSse2(const unsigned char * in, std::size_t from, std::size_t len)
+{
+  for(; from + 16 <= len; from += 16)
+  {
+    int mask = _mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i *>(in + from)));
+
+    if(mask) return from + __builtin_ctz(mask);
+  }
+
+  for(; from < len && in[from] < 0x80; ++from)
+    ;
+
+  return from;
+}
+
+
+// AVX2: as asciiSse2, 32 bytes at a time.
+__attribute__((target("avx2")))
+static std::size_t asciiAvx2(const unsigned char * in, std::size_t from, std::size_t len)
+{
+  for(; from + 32 <= len; from += 32)
+  {
+    unsigned mask = _mm256_movemask_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(in + from)));
+
+    if(mask) return from + __builtin_ctz(mask);
+  }
+
+  return asciiSse2(in, from, len);
+}
+
+#endif // MTF_X86
+
+
+
+/* *************************************************
+// Picks the widest kernel the CPU supports.
+//
+// *************************************************/
+mtf::TransformKernel mtf::bestKernel(void)
+{
+  if(kernelSupported(KERNEL_AVX2)) return KERNEL_AVX2;
+  if(kernelSupported(KERNEL_SSE2)) return KERNEL_SSE2;
+
+  return KERNEL_SCALAR;
+}
+
+
+
+/* *************************************************
+// Checks whether the CPU can run a kernel.
+//
+// *************************************************/
+bool mtf::kernelSupported(TransformKernel kernel)
+{
+  switch(kernel)
+  {
+#ifdef MTF_X86
+    case KERNEL_AVX2: return __builtin_cpu_supports("avx2");
+    case KERNEL_SSE2: return __builtin_cpu_supports("sse2");
+#endif
+    case KERNEL_SCALAR: return true;
+    default: return false;
+  }
+}
+
+
+
+/* *************************************************
+// Sets up a Transform.
+//
+// @param options: The clean up to apply.
+//
+// @param kernel: How to scan; falls back to the
+// scalar code if the CPU can't run it.
+//
+// *************************************************/
+mtf::Transform::Transform(const TransformOptions & options, TransformKernel kernel)
+  : options(options),
+    kernel(kernelSupported(kernel) ? kernel : KERNEL_SCALAR),
+    input(new char[BLOCK_SIZE])
+{
+  reset();
+}
+
+
+
+/* *************************************************
+// Checks whether the options do anything.
+//
+// *************************************************/
+bool mtf::Transform::active(void) const
+{
+  return options.crlf || options.nul != NUL_KEEP || options.utf8;
+}
+
+
+
+/* *************************************************
+// Gets ready for a new body.
+//
+// *************************************************/
+void mtf::Transform::reset(void)
+{
+  pending_cr = false;
+  utf8_ok = true;
+  utf8_need = 0;
+  utf8_lo = 0x80;
+  utf8_hi = 0xbf;
+
+  return;
+}
+
+
+
+/* *************************************************
+// Gives the spare output buffer, allocating it the
+// first time.
+//
+// *************************************************/
+char * mtf::Transform::spare(void)
+{
+  if(!output) output.reset(new char[2 * BLOCK_SIZE + 1]);
+
+  return output.get();
+}
+
+
+
+/* *************************************************
+// Finds the next CR or NUL that needs work, with
+// the kernel chosen for this Transform.
+//
+// @param in: The block.
+//
+// @param from: Where to start looking.
+//
+// @param len: The length of the block.
+//
+// @return: The offset of the byte, or len.
+//
+// *************************************************/
+std::size_t mtf::Transform::findSpecial( const char * in, std::size_t from,
+                                         std::size_t len ) const
+{
+  bool find_cr = options.crlf, find_nul = options.nul != NUL_KEEP;
+
+  if(!find_cr && !find_nul) return len;
+
+#ifdef MTF_X86
+  if(kernel == KERNEL_AVX2) return findAvx2(in, from, len, find_cr, find_nul);
+  if(kernel == KERNEL_SSE2) return findSse2(in, from, len, find_cr, find_nul);
+#endif
+
+  for(; from < len; ++from)
+    if((find_cr && in[from] == '\r') || (find_nul && in[from] == '\0')) return from;
+
+  return len;
+}
+
+
+
+/* *************************************************
+// Transforms one block. Clean runs are copied as
+// they are; a CR directly followed by an LF is
+// dropped, and each NUL is dropped or escaped. A
+// CR that ends the block waits for the next one.
+// NULs are dealt with after line ends, so "\r\0\n"
+// keeps its CR.
+//
+// @param in: The input bytes.
+//
+// @param len: The number of input bytes.
+//
+// @param out: Room for 2 * len + 1 bytes.
+//
+// @return: The number of bytes written to out.
+//
+// *************************************************/
+std::size_t mtf::Transform::apply(const char * in, std::size_t len, char * out)
+{
+  char * next = out;
+  std::size_t from = 0;
+
+  if(options.utf8 && utf8_ok)
+    checkUtf8(reinterpret_cast<const unsigned char *>(in), len);
+
+  // Settle a CR held over from the last block.
+  if(pending_cr && len > 0)
+  {
+    if(in[0] != '\n') *next++ = '\r';
+    pending_cr = false;
+  }
+
+  while(from < len)
+  {
+    std::size_t found = findSpecial(in, from, len);
+
+    // Copy the clean run.
+    std::memcpy(next, in + from, found - from);
+    next += found - from;
+
+    if(found == len) break;
+
+    from = found + 1;
+
+    if(in[found] == '\r' && options.crlf)
+    {
+      // If the block ends here, the next one decides.
+      if(found + 1 == len) pending_cr = true;
+      else if(in[found + 1] != '\n') *next++ = '\r';
+    }
+    else if(options.nul == NUL_ESCAPE)
+    {
+      std::memcpy(next, NUL_ESCAPE_TEXT, sizeof(NUL_ESCAPE_TEXT));
+      next += sizeof(NUL_ESCAPE_TEXT);
+    }
+    // Otherwise it's a NUL being stripped.
+  }
+
+  return next - out;
+}
+
+
+
+/* *************************************************
+// Ends a body: a CR still held back is written,
+// and a UTF-8 sequence left unfinished makes the
+// body invalid.
+//
+// @param out: Room for 1 byte.
+//
+// @return: The number of bytes written to out.
+//
+// *************************************************/
+std::size_t mtf::Transform::finish(char * out)
+{
+  if(utf8_need) utf8_ok = false;
+
+  if(!pending_cr) return 0;
+
+  pending_cr = false;
+  *out = '\r';
+
+  return 1;
+}
+
+
+
+/* *************************************************
+// Runs the UTF-8 check over a block. Runs of ASCII
+// are skipped a register at a time; other bytes go
+// through the state machine, which tracks how many
+// continuation bytes are still needed and the range
+// the next must fall in (ruling out overlong forms,
+// surrogates and code points past U+10FFFF).
+//
+// @param in: The input bytes.
+//
+// @param len: The number of input bytes.
+//
+// *************************************************/
+void mtf::Transform::checkUtf8(const unsigned char * in, std::size_t len)
+{
+  for(std::size_t at = 0; at < len; ++at)
+  {
+    // Between characters, skip straight past any ASCII.
+    if(utf8_need == 0)
+    {
+#ifdef MTF_X86
+      if(kernel == KERNEL_AVX2) at = asciiAvx2(in, at, len);
+      else if(kernel == KERNEL_SSE2) at = asciiSse2(in, at, len);
+      else
+#endif
+      while(at < len && in[at] < 0x80) ++at;
+
+      if(at == len) return;
+    }
+
+    unsigned char byte = in[at];
+
+    // A continuation byte must fall in the expected range.
+    if(utf8_need)
+    {
+      if(byte < utf8_lo || byte > utf8_hi) { utf8_ok = false; return; }
+
+      --utf8_need;
+      utf8_lo = 0x80;
+      utf8_hi = 0xbf;
+      continue;
+    }
+
+    // Otherwise this is a lead byte.
+    if(byte >= 0xc2 && byte <= 0xdf) utf8_need = 1;
+    else if(byte == 0xe0) { utf8_need = 2; utf8_lo = 0xa0; }
+    else if(byte == 0xed) { utf8_need = 2; utf8_hi = 0x9f; }
+    else if(byte >= 0xe1 && byte <= 0xef) utf8_need = 2;
+    else if(byte == 0xf0) { utf8_need = 3; utf8_lo = 0x90; }
+    else if(byte == 0xf4) { utf8_need = 3; utf8_hi = 0x8f; }
+    else if(byte >= 0xf1 && byte <= 0xf3) utf8_need = 3;
+    else { utf8_ok = false; return; }
+  }
+
+  return;
+}
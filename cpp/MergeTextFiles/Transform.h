@@ -0,0 +1,138 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Transform.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of Transform, the optional
+// clean up applied to file bodies as the block copy
+// moves them: CRLF line ends become LF, NUL bytes are
+// stripped or escaped, and the body can be checked for
+// valid UTF-8. The scanning is done 16 (SSE2) or 32
+// (AVX2) bytes at a time, with a plain C++ version for
+// other machines; all of them give the same bytes. See
+// Transform.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef TRANSFORM_H
+#define TRANSFORM_H
+
+#include <cstddef>
+#include <memory>
+
+
+namespace mtf
+{
+  // What to do with NUL bytes.
+  enum NulMode
+  {
+    // Leave them alone.
+    NUL_KEEP,
+    // Drop them.
+    NUL_STRIP,
+    // Replace each with the two characters "\0".
+    NUL_ESCAPE
+  };
+
+  // Which clean up to apply to each body.
+  struct TransformOptions
+  {
+    // true to turn every CR LF pair into a lone LF.
+    bool crlf;
+    // What to do with NUL bytes.
+    NulMode nul;
+    // true to check that each body is valid UTF-8.
+    bool utf8;
+  };
+
+  // No clean up at all.
+  const TransformOptions TRANSFORM_NONE = { false, NUL_KEEP, false };
+
+  // The ways a Transform can scan its input.
+  enum TransformKernel
+  {
+    KERNEL_SCALAR,
+    KERNEL_SSE2,
+    KERNEL_AVX2
+  };
+
+  // The fastest kernel this machine can run.
+  TransformKernel bestKernel(void);
+
+  // true if this machine can run kernel.
+  bool kernelSupported(TransformKernel kernel);
+
+
+  /* ************************************************
+  // Applies TransformOptions to a stream of blocks.
+  // A CR at the end of one block is held back until
+  // the next block shows whether an LF follows it,
+  // so the result doesn't depend on where the input
+  // was split. Call reset before each body and
+  // finish after it.
+  //
+  // ************************************************/
+  class Transform
+  {
+    public:
+
+      // The size of the staging buffer input is read into.
+      static const std::size_t BLOCK_SIZE = 1 << 16;
+
+      // Apply options, scanning with kernel.
+      Transform( const TransformOptions & options,
+                 TransformKernel kernel = bestKernel() );
+
+      // true if the options change anything at all.
+      bool active(void) const;
+
+      // Start a new body.
+      void reset(void);
+
+      // Transform len bytes from in into out, which must have
+      // room for 2 * len + 1 bytes. Returns the bytes written.
+      std::size_t apply(const char * in, std::size_t len, char * out);
+
+      // End the body, writing at most 1 byte to out.
+      std::size_t finish(char * out);
+
+      // false if the body so far isn't valid UTF-8 (when checked).
+      bool valid(void) const { return utf8_ok; }
+
+      // A buffer of BLOCK_SIZE bytes to read input into..
+      char * staging(void) { return input.get(); }
+      // and one of 2 * BLOCK_SIZE + 1 to transform it into.
+      char * spare(void);
+
+
+    private:
+
+      // Transforms own buffers, so they can't be copied.
+      Transform(const Transform &);
+      Transform & operator=(const Transform &);
+
+      // Find the next byte at or after from that needs work.
+      std::size_t findSpecial(const char * in, std::size_t from, std::size_t len) const;
+
+      // Check len more bytes for UTF-8.
+      void checkUtf8(const unsigned char * in, std::size_t len);
+
+      TransformOptions options;
+      TransformKernel kernel;
+
+      // true if a CR ended the last block.
+      bool pending_cr;
+
+      // The UTF-8 check: false once the body is known to be bad,
+      // the continuation bytes still needed, and the range the
+      // next one must fall in.
+      bool utf8_ok;
+      unsigned utf8_need;
+      unsigned char utf8_lo, utf8_hi;
+
+      // The staging and spare buffers.
+      std::unique_ptr<char[]> input, output;
+  };
+};
+#endif // TRANSFORM_H
@@ -0,0 +1,681 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Uring.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of mergeUring, declared in
+// Uring.h. The inputs are handled in windows of
+// options.batch files. For each window, one submission
+// opens and stats every file. Each file's section is
+// then built in one of options.depth slot buffers: the
+// header is written into the slot, the body is read in
+// after it, the separator is appended, and the whole
+// section goes out as one write at its final offset.
+// Reads, writes and closes for many files are queued
+// together, so the number of system calls grows with
+// the number of windows rather than the number of files.
+//
+// There is no liburing here - the ring is driven with
+// the raw io_uring_setup/io_uring_enter system calls.
+// If the kernel doesn't offer io_uring (or the needed
+// operations), the merge falls back to mergeKernel;
+// any other failure to set up the ring is an error.
+//
+// ******************************************************/
+
+#include "Uring.h"
+#include "FileCopy.h"
+
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+
+// The kind of operation a completion belongs to. The kind
+// is kept in the top half of user_data, and the file or
+// slot index in the bottom half.
+enum OpKind { OP_OPEN = 1, OP_STAT, OP_READ, OP_WRITE, OP_CLOSE };
+
+
+/* ************************************************
+// A bare bones io_uring. queue fills in submission
+// queue entries, submit passes them to the kernel
+// (optionally waiting for completions), and pop
+// takes completions off the completion queue.
+//
+// ************************************************/
+class Ring
+{
+  public:
+
+    Ring(void) : ring_fd(-1), sq_ptr(MAP_FAILED), cq_ptr(MAP_FAILED),
+                 sqes(static_cast<io_uring_sqe *>(MAP_FAILED)),
+                 sq_len(0), cq_len(0), sqes_len(0),
+                 local_tail(0), pending(0),
+                 submissions(0), operations(0)
+    { return; }
+
+
+
+    /* ************************************************
+    // Unmaps the queues and closes the ring.
+    //
+    // ************************************************/
+    ~Ring(void)
+    {
+      if(sqes != MAP_FAILED) ::munmap(sqes, sqes_len);
+      if(cq_ptr != MAP_FAILED && cq_ptr != sq_ptr) ::munmap(cq_ptr, cq_len);
+      if(sq_ptr != MAP_FAILED) ::munmap(sq_ptr, sq_len);
+      if(ring_fd >= 0) ::close(ring_fd);
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Creates the ring and maps its queues.
+    //
+    // @param entries: The size of the submission queue.
+    //
+    // @return: false if io_uring isn't available.
+    //
+    // ************************************************/
+    bool setup(unsigned entries)
+    {
+      io_uring_params params;
+      std::memset(&params, 0, sizeof(params));
+
+      ring_fd = ::syscall(__NR_io_uring_setup, entries, &params);
+
+      if(ring_fd < 0) return false;
+
+      sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+      cq_len = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+      // Newer kernels map both rings with a single mmap.
+      bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+
+      if(single && cq_len > sq_len) sq_len = cq_len;
+
+      sq_ptr = ::mmap( NULL, sq_len, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING );
+      if(sq_ptr == MAP_FAILED) return false;
+
+      cq_ptr = single ? sq_ptr
+                      : ::mmap( NULL, cq_len, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING );
+      if(cq_ptr == MAP_FAILED) return false;
+
+      sqes_len = params.sq_entries * sizeof(io_uring_sqe);
+      sqes = static_cast<io_uring_sqe *>(::mmap( NULL, sqes_len, PROT_READ | PROT_WRITE,
+                                                 MAP_SHARED | MAP_POPULATE, ring_fd,
+                                                 IORING_OFF_SQES ));
+      if(sqes == MAP_FAILED) return false;
+
+      char * sq = static_cast<char *>(sq_ptr), * cq = static_cast<char *>(cq_ptr);
+
+      sq_head  = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+      sq_tail  = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+      sq_mask  = reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+      sq_array = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+      cq_head  = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+      cq_tail  = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+      cq_mask  = reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+      cqes     = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+      sq_entries = params.sq_entries;
+      local_tail = *sq_tail;
+
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Fills in the next submission queue entry. If the
+    // submission queue is full, what's in it is
+    // submitted first to make room.
+    //
+    // @return: false if there was no room and the
+    // submission failed.
+    //
+    // ************************************************/
+    bool queue( unsigned char opcode, int fd, const void * addr,
+                unsigned len, unsigned long long off,
+                OpKind kind, unsigned index )
+    {
+      // If every entry is still waiting for the kernel, hand them over.
+      if(full())
+      {
+        if(!submit(0)) return false;
+        if(full()) { errno = EBUSY; return false; }
+      }
+
+      unsigned slot = local_tail & *sq_mask;
+      io_uring_sqe * sqe = &sqes[slot];
+
+      std::memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = opcode;
+      sqe->fd = fd;
+      sqe->addr = reinterpret_cast<unsigned long long>(addr);
+      sqe->len = len;
+      sqe->off = off;
+      sqe->user_data = (static_cast<unsigned long long>(kind) << 32) | index;
+
+      sq_array[slot] = slot;
+      ++local_tail;
+      ++pending;
+
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Passes every queued entry to the kernel.
+    //
+    // @param wait_for: The number of completions to
+    // wait for before returning.
+    //
+    // @return: false if io_uring_enter failed.
+    //
+    // ************************************************/
+    bool submit(unsigned wait_for)
+    {
+      // Publish the new entries before telling the kernel about them.
+      __atomic_store_n(sq_tail, local_tail, __ATOMIC_RELEASE);
+
+      int consumed = 0;
+
+      do consumed = ::syscall( __NR_io_uring_enter, ring_fd, pending, wait_for,
+                               wait_for ? IORING_ENTER_GETEVENTS : 0, NULL, 0 );
+      while(consumed < 0 && errno == EINTR);
+
+      if(consumed < 0) return false;
+
+      ++submissions;
+      operations += consumed;
+      pending -= consumed;
+
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Takes the next completion off the queue.
+    //
+    // @param cqe: Where the completion is copied.
+    //
+    // @return: false if there are no completions.
+    //
+    // ************************************************/
+    bool pop(io_uring_cqe & cqe)
+    {
+      unsigned head = *cq_head;
+
+      // If the kernel hasn't posted anything new, there's nothing to take.
+      if(head == __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) return false;
+
+      cqe = cqes[head & *cq_mask];
+      __atomic_store_n(cq_head, head + 1, __ATOMIC_RELEASE);
+
+      return true;
+    }
+
+
+  private:
+
+    // true if every submission queue entry is still waiting for the kernel.
+    bool full(void) const
+    {
+      return local_tail - __atomic_load_n(sq_head, __ATOMIC_ACQUIRE) >= sq_entries;
+    }
+
+    // The ring itself.
+    int ring_fd;
+
+    // The mapped queues.
+    void * sq_ptr, * cq_ptr;
+    io_uring_sqe * sqes;
+    std::size_t sq_len, cq_len, sqes_len;
+
+    // Pointers into the mapped queues.
+    unsigned * sq_head, * sq_tail, * sq_mask, * sq_array,
+             * cq_head, * cq_tail, * cq_mask;
+    io_uring_cqe * cqes;
+
+    // The size of the submission queue.
+    unsigned sq_entries;
+    // Our tail, which runs ahead of the kernel's view until submit.
+    unsigned local_tail;
+    // Entries queued but not yet consumed by the kernel.
+    unsigned pending;
+
+
+  public:
+
+    // The number of io_uring_enter calls made.
+    unsigned long submissions;
+    // The number of entries the kernel has consumed.
+    unsigned long operations;
+};
+
+
+
+// A buffer that holds one section while it's being built.
+struct Slot
+{
+  // Header, body and separator, in that order.
+  std::unique_ptr<char[]> buffer;
+  // The window index of the file in this slot.
+  unsigned file;
+  // The length of the header at the front of buffer.
+  std::size_t header_len;
+  // The length of the whole section.
+  std::size_t length;
+};
+
+
+// What the open and stat of a single file turned up.
+struct Probe
+{
+  // The open file, or -1.
+  int fd;
+  // The result of the statx.
+  int stat_result;
+  // Filled in by statx.
+  struct statx info;
+  // true if the body should be copied.
+  bool readable;
+  // Where the file's section starts in the output.
+  unsigned long long header_offset;
+};
+
+
+
+/* *************************************************
+// Writes a section of a file too large for a slot
+// buffer with ordinary system calls.
+//
+// @return: true if the whole section was written.
+//
+// *************************************************/
+static bool copyLargeSection( unsigned long number, const Probe & probe,
+                              int out_fd )
+{
+  std::string header = mtf::sectionHeader(number);
+  unsigned long long size = probe.info.stx_size,
+                     tail_offset = probe.header_offset + header.size() + size;
+  std::string tail = std::string(mtf::BODY_TERMINATOR) + mtf::SECTION_SEPARATOR;
+
+  return mtf::pwriteAll(out_fd, header.data(), header.size(), probe.header_offset)
+      && mtf::copyRange(probe.fd, out_fd, probe.header_offset + header.size(), size)
+      && mtf::pwriteAll(out_fd, tail.data(), tail.size(), tail_offset);
+}
+
+
+
+/* *************************************************
+// Copies the files in inputs into out_fd using
+// io_uring. If io_uring can't be used, the merge is
+// done by mergeKernel instead, and
+// uring_report.used_ring is set to false.
+//
+// @param inputs: The files to merge.
+//
+// @param out_fd: The output, which must be a
+// regular file.
+//
+// @param options: Batch size, queue depth and slot
+// size.
+//
+// @param report: Filled with totals for the merge.
+//
+// @param uring_report: Filled with counts of
+// submissions and completed files.
+//
+// @return: true if every section was written.
+//
+// *************************************************/
+bool mtf::mergeUring( const InputSet & inputs, int out_fd,
+                      const UringOptions & options,
+                      MergeReport & report, UringReport & uring_report )
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  unsigned long count = inputs.size();
+
+  // Keep the ring within what the kernel will create.
+  unsigned batch = std::min(std::max(options.batch, 1u), URING_MAX_ENTRIES / 2),
+           depth = std::min(std::max(options.depth, 1u), URING_MAX_ENTRIES / 3);
+
+  uring_report = UringReport();
+
+  // Every file in a window needs an open and a stat in flight at once,
+  // and every slot may have a read, a write and a close queued.
+  Ring ring;
+  unsigned entries = 2 * batch > 3 * depth ? 2 * batch : 3 * depth;
+
+  // If there's no io_uring (or it's been turned off), use plain system
+  // calls. Anything else is a real failure.
+  if(!ring.setup(entries))
+  {
+    if(errno == ENOSYS || errno == EPERM || errno == EACCES)
+      return mergeKernel(inputs, out_fd, 0, report);
+
+    return false;
+  }
+
+  std::string separator = std::string(BODY_TERMINATOR) + SECTION_SEPARATOR;
+
+  // Room for the largest header, a full slot of body and the separator.
+  std::size_t slot_capacity = options.slot_size + sectionHeader(count).size()
+                            + separator.size();
+
+  std::vector<Slot> slots(depth);
+  std::vector<unsigned> free_slots;
+
+  for(unsigned slot = 0; slot < depth; ++slot)
+  {
+    slots[slot].buffer.reset(new char[slot_capacity]);
+    free_slots.push_back(slot);
+  }
+
+  std::vector<Probe> probes(batch);
+
+  // The names of the window's files, which must outlive their submission.
+  std::vector<std::string> paths(batch);
+  io_uring_cqe cqe;
+
+  report.sections.assign(count, IndexEntry());
+  report.latency = LatencyHistogram();
+
+  // Where the next section starts.
+  unsigned long long offset = 0;
+  // The number of operations the kernel hasn't completed yet.
+  unsigned long in_flight = 0;
+
+  bool ok = true;
+
+  for(unsigned long first = 0; ok && first < count; first += batch)
+  {
+    unsigned window = count - first < batch ? count - first : batch;
+
+    // Open and stat every file in the window with one submission.
+    for(unsigned file = 0; file < window; ++file)
+    {
+      probes[file].fd = -1;
+      probes[file].stat_result = -1;
+    }
+
+    for(unsigned file = 0; ok && file < window; ++file)
+    {
+      paths[file] = inputs.name(first + file);
+
+      ok = ring.queue( IORING_OP_OPENAT, inputs.directory(), paths[file].c_str(),
+                       0, 0, OP_OPEN, file );
+      if(ok) ++in_flight;
+
+      ok = ok && ring.queue( IORING_OP_STATX, inputs.directory(), paths[file].c_str(),
+                             STATX_TYPE | STATX_SIZE,
+                             reinterpret_cast<unsigned long long>(&probes[file].info),
+                             OP_STAT, file );
+      if(ok) ++in_flight;
+    }
+
+    // Wait for all of them.
+    ok = ok && ring.submit(2 * window);
+
+    while(ok && in_flight > 0)
+    {
+      // If the completions haven't all been posted yet, wait for more.
+      if(!ring.pop(cqe)) { ok = ring.submit(1); continue; }
+
+      unsigned file = cqe.user_data & 0xffffffff;
+
+      if((cqe.user_data >> 32) == OP_OPEN) probes[file].fd = cqe.res;
+      else probes[file].stat_result = cqe.res;
+
+      --in_flight;
+    }
+
+    // If the window couldn't be probed, close what did open and stop.
+    if(!ok)
+    {
+      for(unsigned file = 0; file < window; ++file)
+        if(probes[file].fd >= 0) ::close(probes[file].fd);
+
+      break;
+    }
+
+    // If the kernel doesn't know these operations, start over without the ring.
+    if(ok && first == 0 && (probes[0].fd == -EINVAL || probes[0].stat_result == -EINVAL))
+    {
+      for(unsigned file = 0; file < window; ++file)
+        if(probes[file].fd >= 0) ::close(probes[file].fd);
+
+      return mergeKernel(inputs, out_fd, 0, report);
+    }
+
+    // Now that the sizes are known, lay out the window's sections.
+    for(unsigned file = 0; file < window; ++file)
+    {
+      Probe & probe = probes[file];
+
+      probe.readable = probe.fd >= 0 && probe.stat_result == 0
+                    && S_ISREG(probe.info.stx_mode);
+
+      // If there's nothing to copy, the file doesn't need to stay open.
+      if(!probe.readable && probe.fd >= 0)
+      {
+        ::close(probe.fd);
+        probe.fd = -1;
+      }
+
+      IndexEntry & entry = report.sections[first + file];
+      std::size_t header_size = sectionHeader(first + file + 1).size();
+
+      probe.header_offset = offset;
+      entry.offset = probe.readable ? offset + header_size : NO_BODY;
+      entry.length = probe.readable ? probe.info.stx_size : 0;
+
+      offset += header_size + sizeof(SECTION_SEPARATOR) - 1;
+
+      if(probe.readable)
+        offset += probe.info.stx_size + sizeof(BODY_TERMINATOR) - 1;
+    }
+
+    unsigned next_file = 0;
+
+    // Build and write every section, keeping at most depth in flight.
+    while(ok && (next_file < window || in_flight > 0))
+    {
+      // Start as many sections as there are free slots.
+      while(ok && next_file < window && !free_slots.empty())
+      {
+        unsigned file = next_file++;
+        Probe & probe = probes[file];
+
+        // Files too large for a slot are copied directly.
+        if(probe.readable && probe.info.stx_size > options.slot_size)
+        {
+          ok = copyLargeSection(first + file + 1, probe, out_fd);
+          ::close(probe.fd);
+          if(ok) ++uring_report.files;
+          continue;
+        }
+
+        unsigned slot_index = free_slots.back();
+        Slot & slot = slots[slot_index];
+        std::string header = sectionHeader(first + file + 1);
+
+        free_slots.pop_back();
+        slot.file = file;
+        slot.header_len = header.size();
+        std::memcpy(slot.buffer.get(), header.data(), header.size());
+
+        // If the file has a body, read it in after the header..
+        if(probe.readable)
+        {
+          ok = ring.queue( IORING_OP_READ, probe.fd, slot.buffer.get() + slot.header_len,
+                           probe.info.stx_size, 0, OP_READ, slot_index );
+        }
+        // Otherwise the section is just the header and separator.
+        else
+        {
+          std::memcpy( slot.buffer.get() + slot.header_len, SECTION_SEPARATOR,
+                       sizeof(SECTION_SEPARATOR) - 1 );
+          slot.length = slot.header_len + sizeof(SECTION_SEPARATOR) - 1;
+
+          ok = ring.queue( IORING_OP_WRITE, out_fd, slot.buffer.get(), slot.length,
+                           probe.header_offset, OP_WRITE, slot_index );
+        }
+
+        // If the ring couldn't take it, the file was never started.
+        if(!ok)
+        {
+          if(probe.fd >= 0) ::close(probe.fd);
+          free_slots.push_back(slot_index);
+          break;
+        }
+
+        ++in_flight;
+      }
+
+      // Hand everything to the kernel and wait for something to finish.
+      if(ok && in_flight > 0) ok = ring.submit(1);
+
+      // Handle every completion that has been posted.
+      while(ok && ring.pop(cqe))
+      {
+        unsigned kind = cqe.user_data >> 32, slot_index = cqe.user_data & 0xffffffff;
+        Slot & slot = slots[slot_index];
+        Probe & probe = probes[slot.file];
+
+        --in_flight;
+
+        // Close failures don't affect the output.
+        if(kind == OP_CLOSE) continue;
+
+        if(cqe.res < 0)
+        {
+          errno = -cqe.res;
+          ok = false;
+
+          // A failed read leaves its file open.
+          if(kind == OP_READ) ::close(probe.fd);
+
+          break;
+        }
+
+        // When a body has been read, finish the section and write it out.
+        if(kind == OP_READ)
+        {
+          std::size_t got = cqe.res, size = probe.info.stx_size;
+          char * body = slot.buffer.get() + slot.header_len;
+
+          // Pick up anything a short read left behind.
+          while(got < size)
+          {
+            ssize_t more = ::pread(probe.fd, body + got, size - got, got);
+
+            if(more < 0 && errno == EINTR) continue;
+
+            // If the file shrank since it was stat'ed, the layout is wrong.
+            if(more == 0) errno = EIO;
+            if(more <= 0) { ok = false; break; }
+
+            got += more;
+          }
+
+          // Never write out a section that wasn't read in full.
+          if(!ok)
+          {
+            ::close(probe.fd);
+            break;
+          }
+
+          std::memcpy(body + size, separator.data(), separator.size());
+          slot.length = slot.header_len + size + separator.size();
+
+          ok = ring.queue( IORING_OP_WRITE, out_fd, slot.buffer.get(), slot.length,
+                           probe.header_offset, OP_WRITE, slot_index );
+          if(ok) ++in_flight;
+
+          ok = ok && ring.queue(IORING_OP_CLOSE, probe.fd, NULL, 0, 0, OP_CLOSE, slot_index);
+          if(ok) ++in_flight;
+
+          // If the close couldn't be queued, close the file here.
+          if(!ok)
+          {
+            ::close(probe.fd);
+            break;
+          }
+        }
+        // When a section has been written, its slot is free again.
+        else if(kind == OP_WRITE)
+        {
+          std::size_t put = cqe.res;
+
+          // Finish a short write with ordinary system calls.
+          if(put < slot.length)
+            ok = pwriteAll( out_fd, slot.buffer.get() + put, slot.length - put,
+                            probe.header_offset + put );
+
+          free_slots.push_back(slot_index);
+          if(ok) ++uring_report.files;
+        }
+      }
+    }
+
+    // If something failed, close the files that were never started.
+    if(!ok)
+      for(unsigned file = next_file; file < window; ++file)
+        if(probes[file].fd >= 0) ::close(probes[file].fd);
+
+    // Files aren't timed one by one here, since their opens, reads
+    // and writes all overlap in the ring; progress is per window.
+    stepProgress(first + window, offset);
+  }
+
+  // If something failed, let the kernel finish with our buffers first,
+  // closing the files of opens and reads that finish only now.
+  int error = errno;
+
+  while(in_flight > 0 && ring.submit(1))
+    while(ring.pop(cqe))
+    {
+      --in_flight;
+
+      if((cqe.user_data >> 32) == OP_OPEN && cqe.res >= 0)
+        ::close(cqe.res);
+      else if((cqe.user_data >> 32) == OP_READ)
+        ::close(probes[slots[cqe.user_data & 0xffffffff].file].fd);
+    }
+
+  // Report why the merge failed, not how the clean up went.
+  errno = error;
+
+  uring_report.used_ring = true;
+  uring_report.submissions = ring.submissions;
+  uring_report.operations = ring.operations;
+
+  report.files = count;
+  report.bytes = offset;
+  report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  return ok;
+}
@@ -0,0 +1,61 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Uring.h
+// Date:  October 17, 2026
+//
+// Overview: Declarations for the io_uring merge. Small
+// files cost far more in open/read/close round trips
+// than in copying, so this merge hands the kernel
+// whole batches of opens, stats, reads, writes and
+// closes at once. See Uring.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef URING_H
+#define URING_H
+
+#include "Merge.h"
+
+
+namespace mtf
+{
+  // The largest ring the kernel will create (IORING_MAX_ENTRIES).
+  const unsigned URING_MAX_ENTRIES = 32768;
+
+  // Tuning for the io_uring merge.
+  struct UringOptions
+  {
+    // The number of files opened & stat'ed per submission,
+    // at most URING_MAX_ENTRIES / 2.
+    unsigned batch;
+    // The number of reads kept in flight at once, at most
+    // URING_MAX_ENTRIES / 3.
+    unsigned depth;
+    // The size of each read buffer. Larger files are copied
+    // with copyRange instead.
+    unsigned slot_size;
+  };
+
+  // Defaults for UringOptions.
+  const UringOptions URING_DEFAULTS = { 256, 64, 64 * 1024 };
+
+  // Counts gathered over an io_uring merge.
+  struct UringReport
+  {
+    // false if io_uring was unavailable and plain syscalls were used.
+    bool used_ring;
+    // The number of io_uring_enter calls made.
+    unsigned long submissions;
+    // The number of operations submitted.
+    unsigned long operations;
+    // The number of files whose sections were completely written.
+    unsigned long files;
+  };
+
+  // Merge with batched io_uring submissions.
+  bool mergeUring( const InputSet & inputs, int out_fd,
+                   const UringOptions & options,
+                   MergeReport & report, UringReport & uring_report );
+};
+#endif // URING_H
@@ -0,0 +1,706 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Writer.cpp
+// Date:  October 17, 2026
+//
+// Overview: Implementation of the Writer class declared
+// in Writer.h. In the background, a full buffer is
+// handed to a flusher thread, which writes it while
+// the Writer fills the other one; the Writer only
+// waits if it fills that one too before the write
+// finishes. With O_DIRECT, full buffers are written
+// as they are (both buffers are page aligned and, in
+// that mode, a whole number of pages long), and only
+// a short last tail goes through the page cache.
+//
+// ******************************************************/
+
+#include "Writer.h"
+#include "FileCopy.h"
+#include "Transform.h"
+#include "Gzip.h"
+#include "Stats.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+
+// The buffers kept on a thread by keepBuffers, with their sizes.
+struct KeptBuffers
+{
+  bool keeping;
+  std::vector<std::pair<char *, std::size_t> > spare;
+
+  KeptBuffers(void) : keeping(false) {}
+
+  void clear(void)
+  {
+    for(std::pair<char *, std::size_t> & kept : spare) std::free(kept.first);
+    spare.clear();
+  }
+
+  ~KeptBuffers(void) { clear(); }
+};
+
+// A mapped input is written (and read ahead) this much at a time;
+// inputs no bigger are faulted in whole when they're mapped.
+static const std::size_t MAP_WINDOW = 64 << 20;
+
+// At most one background Writer's worth is kept.
+static const std::size_t KEPT_BUFFERS = 2;
+
+static thread_local KeptBuffers kept_buffers;
+
+
+
+/* *************************************************
+// Turns buffer reuse on or off for the calling
+// thread. A thread that runs many merges one after
+// another then allocates (and faults in) its
+// buffers only once, rather than once per merge.
+//
+// @param on: false to stop, which frees whatever
+// is kept.
+//
+// *************************************************/
+void mtf::keepBuffers(bool on)
+{
+  kept_buffers.keeping = on;
+
+  if(!on) kept_buffers.clear();
+
+  return;
+}
+
+
+
+/* *************************************************
+// Sets up a Writer for fd with an empty buffer.
+//
+// @param fd: The descriptor to write to.
+//
+// @param capacity: The size of the buffer in bytes
+// (rounded up to whole pages for O_DIRECT).
+//
+// @param start: The offset fd is at, when appending
+// to an existing output.
+//
+// @param options: Whether to write in the
+// background, and whether to use O_DIRECT. O_DIRECT
+// is only tried on a regular file at an aligned
+// offset.
+//
+// *************************************************/
+mtf::Writer::Writer( int fd, std::size_t capacity, unsigned long long start,
+                     const WriteOptions & options )
+  : out_fd(fd), buffer(NULL), capacity(capacity ? capacity : 1), used(0), total(start),
+    direct(false), whole_pages(false), saved_flags(0), write_count(0), gzip(NULL), background(options.background),
+    queued(NULL), queued_len(0), stopping(false), failure(0)
+{
+  struct stat info;
+
+  // Turn on O_DIRECT if the output can take it.
+  if( options.direct && start % WRITE_ALIGNMENT == 0
+      && ::fstat(fd, &info) == 0 && S_ISREG(info.st_mode)
+      && (saved_flags = ::fcntl(fd, F_GETFL)) >= 0
+      && ::fcntl(fd, F_SETFL, saved_flags | O_DIRECT) == 0 )
+  {
+    direct = whole_pages = true;
+    this->capacity = (this->capacity + WRITE_ALIGNMENT - 1) / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+  }
+
+  // Only the background needs a second buffer.
+  for(int index = 0; index < (background ? 2 : 1); ++index)
+    buffers[index].reset(allocate());
+
+  buffer = buffers[0].get();
+
+  if(background) flusher = std::thread(&Writer::drain, this);
+}
+
+
+
+/* *************************************************
+// Stops the flusher thread and releases the
+// buffers. Anything not yet flushed is lost, since
+// a destructor has no way to report a failed
+// write.
+//
+// *************************************************/
+mtf::Writer::~Writer(void)
+{
+  if(background)
+  {
+    {
+      std::lock_guard<std::mutex> hold(lock);
+      stopping = true;
+    }
+
+    changed.notify_all();
+    flusher.join();
+  }
+
+  endDirect();
+
+  // Hand the buffers on to the next Writer on this thread.
+  for(int index = 0; index < 2 && kept_buffers.keeping; ++index)
+    if(buffers[index])
+    {
+      if(kept_buffers.spare.size() == KEPT_BUFFERS)
+      {
+        std::free(kept_buffers.spare.front().first);
+        kept_buffers.spare.erase(kept_buffers.spare.begin());
+      }
+
+      kept_buffers.spare.push_back(std::make_pair(buffers[index].release(), capacity));
+    }
+}
+
+
+
+/* *************************************************
+// Gets a page aligned buffer of capacity bytes,
+// reusing one kept on this thread if it's the
+// right size.
+//
+// @return: The buffer, which is freed with
+// std::free.
+//
+// *************************************************/
+char * mtf::Writer::allocate(void)
+{
+  for(std::size_t at = 0; at < kept_buffers.spare.size(); ++at)
+    if(kept_buffers.spare[at].second == capacity)
+    {
+      char * memory = kept_buffers.spare[at].first;
+
+      kept_buffers.spare.erase(kept_buffers.spare.begin() + at);
+      return memory;
+    }
+
+  void * memory = NULL;
+
+  if(::posix_memalign(&memory, WRITE_ALIGNMENT, capacity) != 0)
+    throw std::bad_alloc();
+
+  return static_cast<char *>(memory);
+}
+
+
+
+/* *************************************************
+// Adds len bytes to the buffer, writing the buffer
+// out whenever it fills. Blocks at least as large
+// as the whole buffer skip it entirely, unless
+// O_DIRECT needs them to go through it.
+//
+// @param data: The bytes to append.
+//
+// @param len: The number of bytes to append.
+//
+// @return: true if every write succeeded.
+//
+// *************************************************/
+bool mtf::Writer::append(const char * data, std::size_t len)
+{
+  total += len;
+
+  // If the data fits, just buffer it.
+  if(len <= capacity - used)
+  {
+    std::memcpy(buffer + used, data, len);
+    used += len;
+    return true;
+  }
+
+  // A large block can be written as it is..
+  if(len >= capacity && !whole_pages)
+    return flush() && writeOut(data, len);
+
+  // otherwise fill the buffer with it, a buffer at a time.
+  while(len > 0)
+  {
+    if(used == capacity && !submit()) return false;
+
+    std::size_t part = std::min(len, capacity - used);
+
+    std::memcpy(buffer + used, data, part);
+    used += part;
+    data += part;
+    len -= part;
+  }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Copies everything from the current offset of
+// in_fd to the output. Reads go straight into the
+// free end of the buffer, a buffer's worth at a
+// time once it has been emptied, so the input is
+// moved in large fixed size chunks no matter how
+// its lines are laid out.
+//
+// @param in_fd: The descriptor to read from.
+//
+// @param hash: If not NULL, every byte read is fed
+// to it while it is still in cache.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::Writer::copyFrom(int in_fd, Hash64 * hash)
+{
+  for(;;)
+  {
+    // If the buffer is full, send it off first.
+    if(used == capacity && !submit()) return false;
+
+    ssize_t got;
+
+    {
+      CallTimer timer(CALL_READ);
+      got = ::read(in_fd, buffer + used, capacity - used);
+    }
+
+    // If the read was interrupted, try again.
+    if(got < 0 && errno == EINTR) continue;
+
+    // Stop on errors..
+    if(got < 0) return false;
+    // and at the end of the input.
+    if(got == 0) return true;
+
+    if(hash) hash->update(buffer + used, got);
+
+    used += got;
+    total += got;
+  }
+}
+
+
+
+/* *************************************************
+// Copies everything from the current offset of
+// in_fd to the output through transform. Each block
+// is read into the Transform's staging buffer and
+// transformed straight into the free end of the
+// buffer, which is sent off first if the block
+// might not fit. A buffer too small to ever hold a block
+// goes through the Transform's spare buffer instead,
+// and so does a block that might not fit when O_DIRECT
+// is on: sending off a partly filled buffer would
+// leave a tail shorter than a page, which turns
+// O_DIRECT off, so append fills the buffer instead.
+//
+// @param in_fd: The descriptor to read from.
+//
+// @param hash: If not NULL, every byte read is fed
+// to it before it is transformed.
+//
+// @param transform: The clean up to apply; reset
+// before the call, and finished by it.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::Writer::transformFrom(int in_fd, Hash64 * hash, Transform & transform)
+{
+  char * staging = transform.staging();
+
+  for(;;)
+  {
+    ssize_t got;
+
+    {
+      CallTimer timer(CALL_READ);
+      got = ::read(in_fd, staging, Transform::BLOCK_SIZE);
+    }
+
+    // If the read was interrupted, try again.
+    if(got < 0 && errno == EINTR) continue;
+
+    // Stop on errors.
+    if(got < 0) return false;
+
+    // At the end of the input, write out a CR still held back.
+    if(got == 0)
+    {
+      char last;
+
+      return append(&last, transform.finish(&last));
+    }
+
+    if(hash) hash->update(staging, got);
+
+    std::size_t room = 2 * got + 1;
+
+    // If the buffer can't take the result without sending off less
+    // than whole pages, go through the spare..
+    if(room > capacity || (whole_pages && room > capacity - used))
+    {
+      char * spare = transform.spare();
+
+      if(!append(spare, transform.apply(staging, got, spare))) return false;
+      continue;
+    }
+
+    // otherwise make room and transform in place.
+    if(room > capacity - used && !submit()) return false;
+
+    std::size_t made = transform.apply(staging, got, buffer + used);
+
+    used += made;
+    total += made;
+  }
+}
+
+
+
+/* *************************************************
+// Copies a large regular file without reading it
+// into the buffer: the file is mapped, and each
+// window of the mapping goes out in one writev
+// together with whatever is buffered before it
+// (the section header, and any small sections
+// before that). The kernel is asked to read ahead
+// sequentially, with huge pages where the file
+// system has them, a window ahead of the writes;
+// each window is unmapped from this process once
+// it's written, so even a multi-GB input never
+// holds more than two windows of it.
+//
+// Compressed and O_DIRECT output needs the bytes
+// in the buffer, so it falls back to copyFrom, as
+// does a file that can't be mapped. An input that
+// shrinks while it's mapped raises SIGBUS, as any
+// mapped file does.
+//
+// @param in_fd: The regular file to copy, at
+// offset 0.
+//
+// @param length: Its size when it was measured.
+//
+// @param hash: If not NULL, every byte is fed to
+// it.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::Writer::mapFrom(int in_fd, unsigned long long length, Hash64 * hash)
+{
+  if(gzip || whole_pages || length == 0) return copyFrom(in_fd, hash);
+
+  void * mapped;
+
+  {
+    CallTimer timer(CALL_READ);
+    mapped = ::mmap( NULL, length, PROT_READ,
+                     MAP_PRIVATE | (length <= MAP_WINDOW ? MAP_POPULATE : 0), in_fd, 0 );
+  }
+
+  if(mapped == MAP_FAILED) return copyFrom(in_fd, hash);
+
+  char * data = static_cast<char *>(mapped);
+
+  // These are only hints, so failures don't matter.
+  ::madvise(data, length, MADV_SEQUENTIAL);
+#ifdef MADV_HUGEPAGE
+  ::madvise(data, length, MADV_HUGEPAGE);
+#endif
+
+  // The buffer is written here, so the one before it must be out first.
+  bool ok = idle();
+
+  for(unsigned long long at = 0; ok && at < length; at += MAP_WINDOW)
+  {
+    std::size_t part = std::min<unsigned long long>(MAP_WINDOW, length - at);
+
+    // Start on the next window while this one is written.
+    if(at + part < length)
+      ::madvise( data + at + part,
+                 std::min<unsigned long long>(MAP_WINDOW, length - at - part), MADV_WILLNEED );
+
+    if(hash) hash->update(data + at, part);
+
+    struct iovec vectors[2] = { { buffer, used }, { data + at, part } };
+
+    ++write_count;
+    ok = writevAll(out_fd, vectors, 2);
+    used = 0;
+
+    // Let go of the window; its pages stay in the page cache.
+    ::madvise(data + at, part, MADV_DONTNEED);
+  }
+
+  ::munmap(mapped, length);
+
+  total += length;
+
+  // Copy anything appended since the file was measured.
+  return ok && ::lseek(in_fd, length, SEEK_SET) >= 0 && copyFrom(in_fd, hash);
+}
+
+
+
+/* *************************************************
+// Moves everything from the current offset of
+// in_fd into the output, which must be a pipe,
+// with splice, so the data never enters this
+// process. The buffer is flushed first to keep the
+// output in order. If splice can't handle in_fd,
+// the copy falls back to copyFrom.
+//
+// @param in_fd: The descriptor to read from.
+//
+// @return: true if the copy reached end of file.
+//
+// *************************************************/
+bool mtf::Writer::spliceFrom(int in_fd)
+{
+  if(!flush()) return false;
+
+  for(;;)
+  {
+    ssize_t moved;
+
+    {
+      CallTimer timer(CALL_COPY);
+      moved = ::splice( in_fd, NULL, out_fd, NULL, capacity,
+                        SPLICE_F_MOVE | SPLICE_F_MORE );
+    }
+
+    if(moved > 0) { total += moved; continue; }
+    if(moved == 0) return true;
+
+    if(errno == EINTR) continue;
+
+    // If the pipe is full, wait for the reader to drain it.
+    if(errno == EAGAIN)
+    {
+      if(!waitWritable(out_fd)) return false;
+      continue;
+    }
+
+    // If splice can't read this input, copy the rest through the buffer.
+    if(errno == EINVAL) return copyFrom(in_fd);
+
+    return false;
+  }
+}
+
+
+
+/* *************************************************
+// Writes out everything in the buffer, and waits
+// for any background write to finish.
+//
+// @return: true if every write so far succeeded.
+//
+// *************************************************/
+bool mtf::Writer::flush(void)
+{
+  if(used > 0 && !submit()) return false;
+
+  return idle();
+}
+
+
+
+/* *************************************************
+// Waits for the background thread to finish the
+// buffer it was given, if any.
+//
+// @return: true if every write so far succeeded.
+//
+// *************************************************/
+bool mtf::Writer::idle(void)
+{
+  if(!background) return true;
+
+  std::unique_lock<std::mutex> hold(lock);
+
+  changed.wait(hold, [this] { return queued == NULL; });
+
+  if(failure) { errno = failure; return false; }
+
+  return true;
+}
+
+
+
+/* *************************************************
+// Marks where a section starts. When compressing,
+// the buffer is handed to the GzipStream so it can
+// start a new member right here; otherwise there's
+// nothing to do.
+//
+// @return: true if every write so far succeeded.
+//
+// *************************************************/
+bool mtf::Writer::section(void)
+{
+  if(!gzip) return true;
+
+  return submit() && gzip->boundary();
+}
+
+
+
+/* *************************************************
+// Hands the filled part of the buffer over to be
+// written. Without a background thread it is
+// written here; otherwise it is queued for the
+// flusher, once the flusher is done with the
+// buffer before, and filling goes on in the other
+// buffer.
+//
+// @return: true if every write so far succeeded.
+//
+// *************************************************/
+bool mtf::Writer::submit(void)
+{
+  if(!background)
+  {
+    bool ok = writeOut(buffer, used);
+
+    used = 0;
+    return ok;
+  }
+
+  {
+    std::unique_lock<std::mutex> hold(lock);
+
+    // Wait for the other buffer to be written.
+    changed.wait(hold, [this] { return queued == NULL; });
+
+    if(failure) { errno = failure; return false; }
+
+    queued = buffer;
+    queued_len = used;
+  }
+
+  changed.notify_all();
+
+  buffer = buffers[buffer == buffers[0].get() ? 1 : 0].get();
+  used = 0;
+
+  return true;
+}
+
+
+
+/* *************************************************
+// The flusher thread: waits for a buffer to be
+// queued, writes it and marks itself idle, until
+// the Writer is destroyed. After a failed write
+// every later buffer is dropped.
+//
+// *************************************************/
+void mtf::Writer::drain(void)
+{
+  std::unique_lock<std::mutex> hold(lock);
+
+  for(;;)
+  {
+    changed.wait(hold, [this] { return queued != NULL || stopping; });
+
+    if(!queued) return;
+
+    const char * data = queued;
+    std::size_t len = queued_len;
+    bool skip = failure != 0;
+
+    // Write without holding the lock, so the Writer can keep filling.
+    hold.unlock();
+    int error = skip || writeOut(data, len) ? 0 : errno;
+    hold.lock();
+
+    if(error && !failure) failure = error;
+    queued = NULL;
+    changed.notify_all();
+  }
+}
+
+
+
+/* *************************************************
+// Writes len bytes (or passes them to gzip, when
+// compressing). With O_DIRECT on, the whole
+// pages go out directly, and a tail shorter than a
+// page turns O_DIRECT off (the offset is no longer
+// aligned after it) and is written normally; so is
+// everything the kernel hasn't taken if it refuses
+// O_DIRECT partway.
+//
+// @param data: The bytes, page aligned for O_DIRECT.
+//
+// @param len: The number of bytes.
+//
+// @return: true if the write succeeded.
+//
+// *************************************************/
+bool mtf::Writer::writeOut(const char * data, std::size_t len)
+{
+  if(len == 0) return true;
+
+  // Compressed output is written by the GzipStream.
+  if(gzip) return gzip->add(data, len);
+
+  if(direct)
+  {
+    std::size_t pages = len / WRITE_ALIGNMENT * WRITE_ALIGNMENT;
+
+    ++write_count;
+
+    std::size_t done = 0;
+
+    if(pages > 0 && !writeAll(out_fd, data, pages, &done))
+    {
+      if(errno != EINVAL) return false;
+
+      // O_DIRECT isn't supported here, so write the rest normally.
+      endDirect();
+      return writeAll(out_fd, data + done, len - done);
+    }
+
+    data += pages;
+    len -= pages;
+
+    if(len == 0) return true;
+
+    endDirect();
+  }
+
+  ++write_count;
+
+  return writeAll(out_fd, data, len);
+}
+
+
+
+/* *************************************************
+// Turns O_DIRECT back off, if it was turned on,
+// putting back the descriptor's old flags.
+//
+// *************************************************/
+void mtf::Writer::endDirect(void)
+{
+  if(!direct) return;
+
+  ::fcntl(out_fd, F_SETFL, saved_flags);
+  direct = false;
+}
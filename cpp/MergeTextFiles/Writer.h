@@ -0,0 +1,190 @@
+/* ******************************************************
+// Name:  Nick G. Toth
+// Email: ntoth@pdx.edu
+// File:  Writer.h
+// Date:  October 17, 2026
+//
+// Overview: Declaration of the Writer class, a fixed
+// size output buffer in front of a file descriptor.
+// Input can be read straight into the free space at
+// the end of the buffer, so data is copied into this
+// process only once, and many small sections go out
+// in a single write. A Writer can keep two page
+// aligned buffers and write one from a background
+// thread while the other fills, and can write with
+// O_DIRECT. See Writer.cpp for more information.
+//
+// ******************************************************/
+
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "Hash.h"
+
+
+namespace mtf
+{
+  class Transform;
+  class GzipStream;
+
+  // The default size of a Writer buffer (and copy chunk).
+  const std::size_t DEFAULT_CHUNK_SIZE = 1 << 20;
+
+  // Buffers are aligned to (and O_DIRECT writes sized in) this many bytes.
+  const std::size_t WRITE_ALIGNMENT = 4096;
+
+  // How a Writer gets its buffers to the descriptor.
+  struct WriteOptions
+  {
+    // true to write full buffers from a background thread while
+    // the next one fills.
+    bool background;
+    // true to write around the page cache with O_DIRECT (regular
+    // files only; falls back to normal writes if refused).
+    bool direct;
+  };
+
+  // Plain synchronous writes.
+  const WriteOptions WRITE_PLAIN = { false, false };
+
+  // Double buffered writes through the page cache.
+  const WriteOptions WRITE_BACKGROUND = { true, false };
+
+  // Keep the buffers of Writers that end on this thread for the
+  // next Writer made on it (or stop, and free them).
+  void keepBuffers(bool on);
+
+
+  /* ************************************************
+  // A buffered writer over a file descriptor. The
+  // Writer never closes its descriptor, and puts
+  // back its flags if it turned on O_DIRECT.
+  //
+  // ************************************************/
+  class Writer
+  {
+    public:
+
+      // Buffer output for fd in a buffer of capacity bytes (two, in
+      // the background). Positions count from start, the offset of fd
+      // when the Writer takes it.
+      Writer( int fd, std::size_t capacity = DEFAULT_CHUNK_SIZE,
+              unsigned long long start = 0,
+              const WriteOptions & options = WRITE_PLAIN );
+
+      // Buffered data is not flushed - call flush first.
+      ~Writer(void);
+
+      // Buffer len bytes from data.
+      bool append(const char * data, std::size_t len);
+
+      // Copy everything left in in_fd through the buffer, feeding
+      // each block to hash on the way if one is given.
+      bool copyFrom(int in_fd, Hash64 * hash = NULL);
+
+      // As copyFrom, but pass every block through transform on the
+      // way; hash still sees the bytes as they were read.
+      bool transformFrom(int in_fd, Hash64 * hash, Transform & transform);
+
+      // Copy in_fd, a regular file length bytes long, from a mapping
+      // of it, writing the buffer and each part of the mapping with
+      // one writev; then copy anything added since it was measured.
+      bool mapFrom(int in_fd, unsigned long long length, Hash64 * hash = NULL);
+
+      // Splice everything left in in_fd into a pipe output.
+      bool spliceFrom(int in_fd);
+
+      // Write out everything that is buffered, and wait for it.
+      bool flush(void);
+
+      // The number of write calls issued so far (complete after flush).
+      unsigned long writes(void) const { return write_count; }
+
+      // Send everything through gzip instead of to the descriptor.
+      void compressTo(GzipStream * stream) { gzip = stream; }
+
+      // Mark the start of a section, where gzip may start a member.
+      bool section(void);
+
+      // The output offset of the next byte appended.
+      unsigned long long position(void) const { return total; }
+
+      // The descriptor being written to.
+      int fd(void) const { return out_fd; }
+
+
+    private:
+
+      // Writers own their buffer, so they can't be copied.
+      Writer(const Writer &);
+      Writer & operator=(const Writer &);
+
+      // Frees memory from posix_memalign.
+      struct Release { void operator()(char * memory) const { std::free(memory); } };
+
+      // Hand the current buffer over to be written and switch to the other.
+      bool submit(void);
+
+      // Wait until the background thread has written what it was given.
+      bool idle(void);
+
+      // Write len bytes from data, splitting off any tail O_DIRECT can't take.
+      bool writeOut(const char * data, std::size_t len);
+
+      // Stop using O_DIRECT, putting back fd's flags.
+      void endDirect(void);
+
+      // The background thread: write each buffer handed to it.
+      void drain(void);
+
+      // A buffer of capacity bytes, kept from an earlier Writer if
+      // there's one that size.
+      char * allocate(void);
+
+      // The descriptor being written to.
+      int out_fd;
+
+      // The buffers, the one being filled, and their size.
+      std::unique_ptr<char, Release> buffers[2];
+      char * buffer;
+      std::size_t capacity;
+
+      // The number of bytes in buffer.
+      std::size_t used;
+
+      // The start offset plus every byte appended since.
+      unsigned long long total;
+
+      // true while O_DIRECT is on (only the writing thread touches
+      // it), true if O_DIRECT was on at the start, so everything must
+      // go through the buffers, and fd's flags from before.
+      bool direct, whole_pages;
+      int saved_flags;
+
+      // The writes issued.
+      unsigned long write_count;
+
+      // The compressor output goes through, or NULL.
+      GzipStream * gzip;
+
+      // The background thread and what it shares with the Writer: the
+      // buffer it should write (NULL when idle), whether it should
+      // stop, and the errno of the first write that failed.
+      bool background;
+      std::thread flusher;
+      std::mutex lock;
+      std::condition_variable changed;
+      const char * queued;
+      std::size_t queued_len;
+      bool stopping;
+      int failure;
+  };
+};
+#endif // WRITER_H
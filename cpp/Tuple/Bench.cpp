@@ -0,0 +1,293 @@
+/* ****************************************************
+// File: Bench.cpp
+// Name: Nick G. Toth
+// Date: October 17th, 2026.
+//
+// Overview: This program compares the layouts of the
+// tuples in Tuple.cpp. For each layout, it fills an
+// array of tuples with the setters, counts the heap
+// allocations that took, and times reading every
+// tuple back with extract, in order and in a shuffled
+// order (where chasing a pointer to the heap costs
+// the most). It then times zipping two vectors and
+// reading the pairs once: by copying them into lists
+// for the list zip, with the generic zip straight
+// into a vector, and with a zip_view. Build it with
+// "make Bench" and run TupleBench with an optional
+// number of tuples (1000000 by default).
+//
+// ****************************************************/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <random>
+#include <vector>
+
+#include "Tuple.cpp" // Includes <list> and <iostream>
+
+
+// The number of times operator new has been called.
+static unsigned long allocations = 0;
+
+// Count every allocation made by the program.
+void * operator new(std::size_t size)
+{
+  ++allocations;
+
+  void * memory = std::malloc(size ? size : 1);
+
+  if(!memory) throw std::bad_alloc();
+
+  return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+  std::free(memory);
+}
+
+
+// Fill, count and time one tuple layout.
+template<typename Tup, typename A, typename B>
+void benchLayout( const char * name, std::size_t heap_bytes,
+                  const std::vector<unsigned> & order );
+// Time zipping two vectors of count numbers, and reading them, each way.
+void benchZip(std::size_t count);
+// Read every tuple in a container once.
+template<typename Zipped>
+long sumZipped(const Zipped & zipped);
+
+
+int main(int argc, char **argv)
+{
+  // The number of tuples in each array.
+  const unsigned MAX_TUPS = argc > 1 ? std::atoi(argv[1]) : 1000000;
+
+  // If the count makes no sense..
+  if(MAX_TUPS == 0)
+  {
+    // Print an error message.
+    std::cout << "\n  Error :: The number of tuples must be positive!"
+              << std::endl << std::endl;
+
+    // Return error code 1.
+    return 1;
+  }
+
+  // A shuffled order to read the tuples in, the same every run.
+  std::vector<unsigned> order(MAX_TUPS);
+
+  for(unsigned index = 0; index < MAX_TUPS; ++index)
+    order[index] = index;
+
+  std::shuffle(order.begin(), order.end(), std::mt19937(42));
+
+  // Print the table header.
+  std::cout << "\n  " << MAX_TUPS << " tuples\n\n"
+            << std::left << std::setw(28) << "  layout" << std::right
+            << std::setw(8) << "bytes" << std::setw(14) << "allocations"
+            << std::setw(12) << "fill ns" << std::setw(12) << "in order"
+            << std::setw(12) << "shuffled" << std::endl;
+
+  // Compare both layouts on a small and a larger pair of types.
+  benchLayout< Tuple<short, char>, short, char >
+    ("Tuple<short, char>", sizeof(short) + sizeof(char), order);
+  benchLayout< InlineTuple<short, char>, short, char >
+    ("InlineTuple<short, char>", 0, order);
+  benchLayout< Tuple<int, double>, int, double >
+    ("Tuple<int, double>", sizeof(int) + sizeof(double), order);
+  benchLayout< InlineTuple<int, double>, int, double >
+    ("InlineTuple<int, double>", 0, order);
+
+  // Explain the columns.
+  std::cout << "\n  bytes: per tuple, including its heap blocks' requested sizes."
+            << "\n  fill ns, in order, shuffled: nanoseconds per tuple to set,"
+            << "\n  and to extract both members in order and shuffled."
+            << std::endl << std::endl;
+
+  // Compare the ways of zipping two vectors.
+  benchZip(MAX_TUPS);
+
+  // Fin.
+  return 0;
+}
+
+
+
+/* ********************************************
+// benchLayout fills an array of tuples of one
+// layout with set_tup and reads them back with
+// extract, once in order and once in the
+// shuffled order, and prints a row of the
+// table: the bytes per tuple, the allocations
+// made filling the array, and the nanoseconds
+// per tuple for each pass.
+//
+// ********************************************/
+template<typename Tup, typename A, typename B>
+void benchLayout( const char * name, std::size_t heap_bytes,
+                  const std::vector<unsigned> & order )
+{
+  typedef std::chrono::steady_clock Clock;
+
+  // Where extract puts the members.
+  A fst = A();
+  B snd = B();
+
+  const std::size_t count = order.size();
+
+  // Every tuple starts out unset, so filling it is only set_tup.
+  std::vector<Tup> tups(count);
+
+  unsigned long before = allocations;
+  Clock::time_point start = Clock::now();
+
+  // Set every tuple.
+  for(std::size_t index = 0; index < count; ++index)
+    tups[index].set_tup( static_cast<A>(index), static_cast<B>(index) );
+
+  double fill = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+  unsigned long allocated = allocations - before;
+
+  // Read them all back, in order and then shuffled.
+  double passes[2] = { 0, 0 };
+  volatile long sink = 0;
+
+  for(int pass = 0; pass < 2; ++pass)
+  {
+    long sum = 0;
+
+    start = Clock::now();
+
+    for(std::size_t at = 0; at < count; ++at)
+    {
+      tups[pass ? order[at] : at].extract(fst, snd);
+
+      sum += fst + static_cast<long>(snd);
+    }
+
+    passes[pass] = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    sink = sink + sum;
+  }
+
+  // The tuple itself, plus what it asked the heap for.
+  double bytes = sizeof(Tup) + heap_bytes;
+
+  std::cout << "  " << std::left << std::setw(26) << name << std::right
+            << std::fixed << std::setprecision(0)
+            << std::setw(8) << bytes << std::setw(14) << allocated
+            << std::setprecision(2)
+            << std::setw(12) << fill / count
+            << std::setw(12) << passes[0] / count
+            << std::setw(12) << passes[1] / count << std::endl;
+
+  return;
+}
+
+
+
+/* ********************************************
+// benchZip zips two vectors of count numbers
+// and reads every pair back once, four ways -
+// copying them into lists for the list zip,
+// with the generic zip into a vector of Tuples
+// and of InlineTuples (which reserve room for
+// every pair at once), and with a zip_view,
+// which builds nothing - and prints the
+// allocations and nanoseconds per pair of each.
+//
+// ********************************************/
+void benchZip(std::size_t count)
+{
+  typedef std::chrono::steady_clock Clock;
+
+  std::vector<int> fsts(count), snds(count);
+
+  for(std::size_t index = 0; index < count; ++index)
+  {
+    fsts[index] = static_cast<int>(index);
+    snds[index] = static_cast<int>(count - index);
+  }
+
+  std::cout << "  " << std::left << std::setw(26) << "zip and read, per pair" << std::right
+            << std::setw(14) << "allocations" << std::setw(12) << "ns" << std::endl;
+
+  volatile long sink = 0;
+
+  for(int way = 0; way < 4; ++way)
+  {
+    static const char * const NAMES[4]
+      = { "lists", "vector<Tuple>", "vector<InlineTuple>", "zip_view" };
+
+    // Every way builds, reads and frees its own output, inside the timing.
+    unsigned long before = allocations;
+    Clock::time_point start = Clock::now();
+
+    if(way == 0)
+    {
+      std::list<int> fst_list(fsts.begin(), fsts.end()), snd_list(snds.begin(), snds.end());
+      std::list< Tuple<int, int> > zipped;
+
+      zip(fst_list, snd_list, zipped);
+      sink = sink + sumZipped(zipped);
+    }
+    else if(way == 1)
+    {
+      std::vector< Tuple<int, int> > zipped;
+
+      zip(fsts, snds, zipped);
+      sink = sink + sumZipped(zipped);
+    }
+    else if(way == 2)
+    {
+      std::vector< InlineTuple<int, int> > zipped;
+
+      zip(fsts, snds, zipped);
+      sink = sink + sumZipped(zipped);
+    }
+    else
+    {
+      long sum = 0;
+
+      for(auto pair : zip_view(fsts, snds))
+        sum += pair.first + pair.second;
+
+      sink = sink + sum;
+    }
+
+    double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+
+    std::cout << "  " << std::left << std::setw(26) << NAMES[way] << std::right
+              << std::fixed << std::setw(14) << allocations - before
+              << std::setprecision(2) << std::setw(12) << elapsed / count << std::endl;
+  }
+
+  std::cout << std::endl;
+
+  return;
+}
+
+
+
+/* ********************************************
+// sumZipped reads both members of every tuple
+// in a container.
+//
+// @return: The sum of them all.
+//
+// ********************************************/
+template<typename Zipped>
+long sumZipped(const Zipped & zipped)
+{
+  int fst = 0, snd = 0;
+  long sum = 0;
+
+  for(typename Zipped::const_iterator zip_iter = zipped.begin();
+      zip_iter != zipped.end(); ++zip_iter)
+    if(zip_iter->extract(fst, snd))
+      sum += fst + snd;
+
+  return sum;
+}
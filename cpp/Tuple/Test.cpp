@@ -12,6 +12,12 @@
 // ****************************************************/
 
 #include <string> // For atoi. (char[] => integer).
+#include <utility> // For move.
+#include <algorithm> // For count_if, find_if and equal.
+#include <cctype> // For toupper.
+#include <deque>
+#include <iterator> // For back_inserter and make_move_iterator.
+#include <vector>
 
 #include "Tuple.cpp" // Includes <list> and <iostream>
 
@@ -20,6 +26,16 @@
 void tupTest(const unsigned short MAX_TUPS);
 // Example of zipper functions with Tuple.
 void zipperTest(const unsigned short MAX_TUPS);
+// Example of InlineTuple, side by side with Tuple.
+void inlineTest(const unsigned short MAX_TUPS);
+// Example of moving tuples, and of building their members in place.
+void moveTest(const unsigned short MAX_TUPS);
+// Example of Tuples with any number of members.
+void variadicTest(const unsigned short MAX_TUPS);
+// Example of the generic zipper functions over other ranges.
+void rangeZipTest(const unsigned short MAX_TUPS);
+// Example of zip_view.
+void zipViewTest(const unsigned short MAX_TUPS);
 
 
 int main(int argc, char **argv)
@@ -45,6 +61,21 @@ int main(int argc, char **argv)
   // Run the Zipper test function.
   zipperTest(MAX_TUPS);
 
+  // Run the InlineTuple test function.
+  inlineTest(MAX_TUPS);
+
+  // Run the move test function.
+  moveTest(MAX_TUPS);
+
+  // Run the variadic Tuple test function.
+  variadicTest(MAX_TUPS);
+
+  // Run the range zipper test function.
+  rangeZipTest(MAX_TUPS);
+
+  // Run the zip view test function.
+  zipViewTest(MAX_TUPS);
+
   // Fin.
   return 0;
 }
@@ -229,3 +260,484 @@ void zipperTest(const unsigned short MAX_TUPS)
 
   return;
 }
+
+
+
+/* ********************************************
+// inlineTest sets up a Tuple and an InlineTuple
+// the same ways - in the constructor, with the
+// setters one at a time and partially - and
+// shows that every getter and setter answers
+// the same for both. It then fills a list of
+// MAX_TUPS InlineTuples and displays them.
+//
+// ********************************************/
+void inlineTest(const unsigned short MAX_TUPS)
+{
+  // Print header message.
+  std::cout << "\n  Starting InlineTuple Test with a List of "
+            << MAX_TUPS << " Tuples!" << std::endl;
+
+  // Tuples set up in the constructor..
+  Tuple<short, char> tup(1, 'a');
+  InlineTuple<short, char> in_tup(1, 'a');
+
+  // and tuples left unset.
+  Tuple<short, char> empty_tup;
+  InlineTuple<short, char> empty_in_tup;
+
+  // Storage for the getters.
+  short fst = 0, in_fst = 0;
+  char snd = 0, in_snd = 0;
+
+  // Setting a set tuple must fail for both.
+  std::cout << std::boolalpha
+            << "\n    Set Again => " << tup.set_fst(2)
+            << " and " << in_tup.set_fst(2) << std::endl;
+
+  // Getting from an unset tuple must fail for both.
+  std::cout << "    Get Unset => " << empty_tup.fst(fst)
+            << " and " << empty_in_tup.fst(in_fst) << std::endl;
+
+  // Set only the second member..
+  empty_tup.set_snd('z');
+  empty_in_tup.set_snd('z');
+
+  // so extract and set_tup fail, but snd succeeds.
+  std::cout << "    Extract Partial => " << empty_tup.extract(fst, snd)
+            << " and " << empty_in_tup.extract(in_fst, in_snd) << std::endl
+            << "    Set Partial => " << empty_tup.set_tup(3, 'c')
+            << " and " << empty_in_tup.set_tup(3, 'c') << std::endl
+            << "    Get Second => " << (empty_tup.snd(snd) && snd == 'z')
+            << " and " << (empty_in_tup.snd(in_snd) && in_snd == 'z') << std::endl;
+
+  // Copies keep just the members that were set.
+  InlineTuple<short, char> copy_tup(empty_in_tup);
+
+  std::cout << "    Copy Partial => " << (!copy_tup.fst(in_fst) && copy_tup.snd(in_snd))
+            << std::endl
+            << "    Size => " << sizeof(tup) << " bytes plus two allocations, and "
+            << sizeof(in_tup) << " bytes" << std::endl;
+
+  // Create a list of InlineTuples.
+  std::list< InlineTuple<short, char> > tup_lst;
+
+  // Push MAX_TUPS new InlineTuples onto the back of the list.
+  for(short g_index = 0; g_index < MAX_TUPS; ++g_index)
+    tup_lst.push_back(InlineTuple<short, char>(g_index + 1, static_cast<char>('a' + g_index)));
+
+  // Display alert that list will be printed.
+  std::cout << "\n    Printing All InlineTuples.." << std::endl;
+
+  // Call the display method on every InlineTuple in the list.
+  for(std::list< InlineTuple<short, char> >::iterator tup_iter = tup_lst.begin();
+      tup_iter != tup_lst.end(); ++tup_iter)
+    tup_iter->display();
+
+  // Print exit message.
+  std::cout << "\n\n  Ending InlineTuple Test"
+            << std::endl << std::endl;
+
+  return;
+}
+
+
+
+/* ********************************************
+// moveTest moves and copies <string, string>
+// Tuples and InlineTuples, and shows what each
+// side is left holding: a moved tuple is
+// unset, a copied one (even partially set)
+// keeps its data, and assigning over a set
+// tuple replaces it. It then builds members in
+// place with emplace_fst, zips two lists of
+// MAX_TUPS strings by moving them, and grows a
+// vector of the zipped tuples.
+//
+// ********************************************/
+void moveTest(const unsigned short MAX_TUPS)
+{
+  // Print header message.
+  std::cout << "\n  Starting Move Test with Two Lists of "
+            << MAX_TUPS << " strings!" << std::endl;
+
+  // Storage for the getters.
+  std::string fst, snd;
+
+  // Move a set tuple into a new one..
+  Tuple<std::string, std::string> tup(std::string("left"), std::string("right"));
+  Tuple<std::string, std::string> moved_tup(std::move(tup));
+
+  // so the new one has the data, and the old one is unset.
+  std::cout << std::boolalpha
+            << "\n    Move => " << (moved_tup.extract(fst, snd) && fst == "left")
+            << " and " << tup.fst(fst) << std::endl;
+
+  // Copy a tuple with only its second member set..
+  Tuple<std::string, std::string> part_tup;
+  part_tup.set_snd(std::string("only"));
+
+  Tuple<std::string, std::string> copy_tup(part_tup);
+
+  // so the copy has just that member too.
+  std::cout << "    Copy Partial => " << (!copy_tup.fst(fst) && copy_tup.snd(snd) && snd == "only")
+            << std::endl;
+
+  // Copy assign over a set tuple, and then assign it to itself..
+  copy_tup = moved_tup;
+  copy_tup = copy_tup;
+
+  // so both still have their own data.
+  std::cout << "    Copy Assign => " << (copy_tup.extract(fst, snd) && fst == "left"
+                                         && moved_tup.extract(fst, snd) && snd == "right")
+            << std::endl;
+
+  // Move assign the copy back into the moved-from tuple.
+  tup = std::move(copy_tup);
+
+  std::cout << "    Move Assign => " << (tup.fst(fst) && fst == "left" && !copy_tup.fst(fst))
+            << std::endl;
+
+  // Build members in place from a string constructor's arguments.
+  InlineTuple<std::string, std::string> in_tup;
+
+  std::cout << "    Emplace => " << (part_tup.emplace_fst(3, 'x') && in_tup.emplace_fst(3, 'y'))
+            << " and again => " << part_tup.emplace_fst(3, 'x') << std::endl;
+
+  // Move the InlineTuple, whose members move with it.
+  in_tup.set_snd(std::string("inline"));
+
+  InlineTuple<std::string, std::string> moved_in_tup(std::move(in_tup));
+
+  std::cout << "    Move Inline => " << (moved_in_tup.extract(fst, snd) && fst == "yyy")
+            << " and " << in_tup.snd(snd) << std::endl;
+
+  // Create two lists of strings.
+  std::list<std::string> names, values;
+
+  for(unsigned short index = 0; index < MAX_TUPS; ++index)
+  {
+    names.push_back("name " + std::to_string(index + 1));
+    values.push_back("value " + std::to_string(MAX_TUPS - index));
+  }
+
+  // Zip them by moving the strings into the tuples.
+  std::list< Tuple<std::string, std::string> > zipped_list;
+
+  bool did_zip = zip( std::move(names), std::move(values), zipped_list );
+
+  std::cout << "\n    Did Zip => " << did_zip << std::endl;
+
+  // Move the zipped tuples into a vector, which moves them again as it grows.
+  std::vector< Tuple<std::string, std::string> > tup_vec;
+
+  for(std::list< Tuple<std::string, std::string> >::iterator zip_iter = zipped_list.begin();
+      zip_iter != zipped_list.end(); ++zip_iter)
+    tup_vec.push_back(std::move(*zip_iter));
+
+  // Display alert that the vector will be printed.
+  std::cout << "\n    Printing Moved Tuples.." << std::endl;
+
+  // Call the display method on every Tuple in the vector.
+  for(std::size_t index = 0; index < tup_vec.size(); ++index)
+    tup_vec[index].display();
+
+  // Print exit message.
+  std::cout << "\n\n  Ending Move Test"
+            << std::endl << std::endl;
+
+  return;
+}
+
+
+
+// A member type with no data, which a Tuple should store in no space.
+struct Tag {};
+
+// A record with the same fields as Tuple<char, double, short, int>, in that order.
+struct Record { char c; double d; short s; int i; };
+
+
+
+/* ********************************************
+// variadicTest builds Tuples of three and four
+// members, reads and changes them with get<I>
+// and get<T>, and compares their sizes with a
+// struct of the same fields, with the nested
+// two member Tuples they replace, and with an
+// empty member added. It then fills a list of
+// MAX_TUPS records and displays them.
+//
+// ********************************************/
+void variadicTest(const unsigned short MAX_TUPS)
+{
+  // Print header message.
+  std::cout << "\n  Starting Variadic Tuple Test with a List of "
+            << MAX_TUPS << " Tuples!" << std::endl;
+
+  // A record set up in the constructor, and one left at zero.
+  Tuple<char, double, short, int> rec('r', 2.5, 7, 42);
+  Tuple<char, double, short, int> zero_rec;
+
+  // Members come back by index and by type, in the order given.
+  std::cout << std::boolalpha
+            << "\n    Get => " << (rec.get<0>() == 'r' && rec.get<1>() == 2.5
+                                   && rec.get<short>() == 7 && rec.get<int>() == 42)
+            << std::endl
+            << "    Default => " << (zero_rec.get<1>() == 0 && zero_rec.get<3>() == 0)
+            << std::endl;
+
+  // Members can be changed through get, and copies are independent.
+  zero_rec = rec;
+  zero_rec.get<int>() += 1;
+
+  std::cout << "    Change => " << (zero_rec.get<3>() == 43 && rec.get<3>() == 42)
+            << std::endl;
+
+  // The two member form has get too.
+  Tuple<short, char> pair_tup(1, 'a');
+
+  std::cout << "    Pair Get => " << (pair_tup.get<0>() == 1 && pair_tup.get<char>() == 'a')
+            << std::endl;
+
+  // Compare the sizes.
+  std::cout << "\n    Size => " << sizeof(rec) << " bytes, against "
+            << sizeof(Record) << " for the struct" << std::endl
+            << "    Nested Size => " << sizeof(Tuple<char, Tuple<double, Tuple<short, int> > >)
+            << " bytes plus six allocations" << std::endl
+            << "    Empty Member => " << sizeof(Tuple<Tag, int, int>) << " bytes, against "
+            << sizeof(Tuple<char, int, int>) << " with a char instead" << std::endl;
+
+  // Create a list of records.
+  std::list< Tuple<short, char, std::string> > rec_lst;
+
+  // Push MAX_TUPS new records onto the back of the list.
+  for(short g_index = 0; g_index < MAX_TUPS; ++g_index)
+    rec_lst.push_back( Tuple<short, char, std::string>( g_index + 1,
+                         static_cast<char>('a' + g_index), std::string(g_index + 1, '*') ) );
+
+  // Display alert that list will be printed.
+  std::cout << "\n    Printing All Records.." << std::endl;
+
+  // Call the display method on every record in the list.
+  for(std::list< Tuple<short, char, std::string> >::iterator rec_iter = rec_lst.begin();
+      rec_iter != rec_lst.end(); ++rec_iter)
+    rec_iter->display();
+
+  // Print exit message.
+  std::cout << "\n\n  Ending Variadic Tuple Test"
+            << std::endl << std::endl;
+
+  return;
+}
+
+
+
+/* ********************************************
+// rangeZipTest zips a vector of MAX_TUPS shorts
+// with an array of chars - into a vector, an
+// array and a list - and checks that all three
+// keep the order of the inputs. It checks that
+// ranges of different lengths fail, that a
+// list (which can't be measured up front) is
+// zipped too, and that strings can be moved in.
+// It then unzips the vector back into a vector
+// and a deque, and displays the zipped Tuples.
+//
+// ********************************************/
+void rangeZipTest(const unsigned short MAX_TUPS)
+{
+  // Print header message.
+  std::cout << "\n  Starting Range Zipper Test with a Vector of "
+            << MAX_TUPS << " shorts!" << std::endl;
+
+  // A vector of shorts, 1 through MAX_TUPS..
+  std::vector<short> shorts;
+  // and an array of chars, 'a' onwards.
+  char chars[26];
+
+  for(short g_index = 0; g_index < MAX_TUPS; ++g_index)
+    shorts.push_back(g_index + 1);
+
+  for(short g_index = 0; g_index < 26; ++g_index)
+    chars[g_index] = static_cast<char>('a' + g_index);
+
+  // Only zip as many chars as there are shorts (at most 26).
+  const std::size_t count = shorts.size() < 26 ? shorts.size() : 26;
+  shorts.resize(count);
+
+  // Zip them into a vector, which reserves room for them all at once..
+  std::vector< Tuple<short, char> > zipped_vec;
+  bool did_zip = zip( shorts, std::vector<char>(chars, chars + count), zipped_vec );
+
+  // into an array, through its pointer..
+  std::vector< Tuple<short, char> > zipped_arr(count);
+  did_zip = zip( shorts.begin(), shorts.end(), chars, chars + count, zipped_arr.data() )
+            && did_zip;
+
+  // and into a list, from a list.
+  std::list<short> short_lst(shorts.begin(), shorts.end());
+  std::list< InlineTuple<short, char> > zipped_lst;
+  did_zip = zip( short_lst, std::vector<char>(chars, chars + count), zipped_lst ) && did_zip;
+
+  std::cout << std::boolalpha << "\n    Did Zip => " << did_zip << std::endl;
+
+  // Check that all three are in the order of the inputs.
+  bool in_order = zipped_vec.size() == count && zipped_lst.size() == count;
+  short fst = 0;
+  char snd = 0;
+
+  std::list< InlineTuple<short, char> >::iterator lst_iter = zipped_lst.begin();
+
+  for(std::size_t index = 0; in_order && index < count; ++index, ++lst_iter)
+    in_order = zipped_vec[index].extract(fst, snd) && fst == shorts[index] && snd == chars[index]
+               && zipped_arr[index].get<0>() == fst && zipped_arr[index].get<1>() == snd
+               && lst_iter->extract(fst, snd) && fst == shorts[index] && snd == chars[index];
+
+  std::cout << "    In Order => " << in_order << std::endl;
+
+  // Ranges of different lengths fail, and a vector gets nothing added.
+  std::vector< Tuple<short, char> > mismatched_vec;
+
+  std::cout << "    Different Lengths => " << zip(shorts, std::vector<char>(count + 1, 'x'), mismatched_vec)
+            << " and " << mismatched_vec.size() << " added" << std::endl;
+
+  // Move strings in, rather than copying them.
+  std::vector<std::string> names(2, std::string(32, 'n'));
+  std::vector< Tuple<std::string, short> > named;
+
+  zip( std::make_move_iterator(names.begin()), std::make_move_iterator(names.end()),
+       shorts.begin(), shorts.begin() + (count < 2 ? count : 2), std::back_inserter(named) );
+
+  std::cout << "    Move In => " << (count < 2 || (names[0].empty() && named.size() == 2))
+            << std::endl;
+
+  // Unzip the vector into a vector and a deque.
+  std::vector<short> fst_vec;
+  std::deque<char> snd_deq;
+
+  bool did_unzip = unzip(zipped_vec, fst_vec, snd_deq);
+
+  std::cout << "    Did Unzip => " << (did_unzip && fst_vec == shorts
+                                       && std::equal(snd_deq.begin(), snd_deq.end(), chars))
+            << std::endl;
+
+  // Display alert that the vector will be printed.
+  std::cout << "\n    Printing Zipped Vector.." << std::endl;
+
+  // Call the display method on every Tuple in the vector.
+  for(std::size_t index = 0; index < zipped_vec.size(); ++index)
+    zipped_vec[index].display();
+
+  // Print exit message.
+  std::cout << "\n\n  Ending Range Zipper Test"
+            << std::endl << std::endl;
+
+  return;
+}
+
+
+
+/* ********************************************
+// zipViewTest views a vector of MAX_TUPS shorts
+// beside a list of chars, one longer, without
+// copying either. It walks the view with
+// range-for, changing the chars through it,
+// searches and counts it with the standard
+// algorithms, and checks that it stops at the
+// shorter range, that a const view reads the
+// same, and that its iterator is no bigger
+// than the two it holds. It then displays the
+// pairs, as Tuples.
+//
+// ********************************************/
+void zipViewTest(const unsigned short MAX_TUPS)
+{
+  // Print header message.
+  std::cout << "\n  Starting Zip View Test with a Vector of "
+            << MAX_TUPS << " shorts!" << std::endl;
+
+  // A vector of shorts, 1 through MAX_TUPS, and a list of one more char.
+  std::vector<short> shorts;
+  std::list<char> chars;
+
+  for(short g_index = 0; g_index < MAX_TUPS; ++g_index)
+  {
+    shorts.push_back(g_index + 1);
+    chars.push_back(static_cast<char>('a' + g_index % 26));
+  }
+
+  chars.push_back('!');
+
+  // View them side by side.
+  auto view = zip_view(shorts, chars);
+
+  // Upper case every char beside an even short, through the view.
+  std::size_t steps = 0;
+
+  for(auto pair : view)
+  {
+    if(pair.first % 2 == 0)
+      pair.second = static_cast<char>(std::toupper(pair.second));
+
+    ++steps;
+  }
+
+  // The view stops with the shorter range, and the list was changed.
+  std::cout << std::boolalpha
+            << "\n    Shorter Range => " << (steps == shorts.size())
+            << std::endl
+            << "    Changed => " << (MAX_TUPS < 2 || *std::next(chars.begin()) == 'B')
+            << std::endl;
+
+  // Count the upper case chars, and find the pair whose short is 2.
+  typedef decltype(view)::iterator::value_type Pair;
+
+  long upper = std::count_if(view.begin(), view.end(), [](Pair pair)
+  {
+    return std::isupper(pair.second) != 0;
+  });
+
+  auto found = std::find_if(view.begin(), view.end(), [](Pair pair)
+  {
+    return pair.first == 2;
+  });
+
+  std::cout << "    Count => " << (upper == MAX_TUPS / 2)
+            << std::endl
+            << "    Find => " << (MAX_TUPS < 2 ? found == view.end() : (*found).second == 'B')
+            << std::endl;
+
+  // A view of const ranges reads the same.
+  const std::vector<short> & const_shorts = shorts;
+  const std::list<char> & const_chars = chars;
+
+  auto const_view = zip_view(const_shorts, const_chars);
+
+  std::cout << "    Const => " << std::equal(view.begin(), view.end(), const_view.begin(),
+                                             [](Pair pair, decltype(*const_view.begin()) const_pair)
+  {
+    return &pair.first == &const_pair.first && &pair.second == &const_pair.second;
+  }) << std::endl;
+
+  // The iterator is just the two source iterators.
+  std::cout << "    Size => " << sizeof(view.begin()) << " bytes, against "
+            << sizeof(shorts.begin()) + sizeof(chars.begin()) << std::endl;
+
+  // Display alert that the view will be printed.
+  std::cout << "\n    Printing The View As Tuples.." << std::endl;
+
+  // Copy each pair into a Tuple and display it.
+  for(auto pair : view)
+  {
+    Tuple<short, char> tup = pair;
+
+    tup.display();
+  }
+
+  // Print exit message.
+  std::cout << "\n\n  Ending Zip View Test"
+            << std::endl << std::endl;
+
+  return;
+}
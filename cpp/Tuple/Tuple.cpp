@@ -20,10 +20,36 @@
 // the tuple stores pointers to its data, if you haven't initialized
 // the data, fst and snd will not set the variable arguments.
 //
+// Tuples can also be moved. Moving a Tuple hands its data pointers
+// to the new one and leaves the old one unset, so passing tuples
+// around (or growing a container of them) never copies their data.
+// The setters and the constructor take rvalues too, moving their
+// arguments in, and emplace_fst and emplace_snd build a member in
+// place from the arguments of one of its constructors.
+//
+// InlineTuple has the same interface, but keeps both members inside
+// the tuple itself rather than in two separate heap allocations, and
+// tracks which of them have been set in a small bitmask. It never
+// allocates, and reading a member doesn't chase a pointer.
+//
+// Tuple also takes any other number of members, e.g. a
+// Tuple<char, double, short, int> record. Those Tuples hold their
+// members in place, packed by alignment, and get<I> and get<T>
+// pick a member out at compile time. The two member form keeps
+// the interface above, and gains get too.
+//
+// Besides zip and unzip, which build new containers, zip_view walks
+// two ranges side by side without copying anything, handing out
+// references to each pair of elements.
+//
 // ****************************************************************/
 
 #include <iostream>
+#include <iterator> // For the generic zip & unzip functions.
 #include <list> // For zip & unzip functions - See bottom of file.
+#include <new>  // For placement new - See InlineTuple.
+#include <type_traits> // For aligned_storage - See InlineTuple.
+#include <utility> // For move and forward.
 
 // If nullptr has not already been defined..
 #ifndef nullptr
@@ -37,6 +63,184 @@
 #define TUPLE
 
 
+// The tuple's compile time machinery, used by both forms of Tuple.
+namespace tuple_detail
+{
+  // A list of member indices (C++11 has no std::index_sequence).
+  template<std::size_t... Is> struct indices {};
+
+  // indices<0, 1, .. N - 1>.
+  template<std::size_t N, std::size_t... Is>
+  struct make_indices : make_indices<N - 1, N - 1, Is...> {};
+
+  template<std::size_t... Is>
+  struct make_indices<0, Is...> { typedef indices<Is...> type; };
+
+  // The type of member I of Ts (no type if there isn't one).
+  template<std::size_t I, typename... Ts>
+  struct type_at {};
+
+  template<typename T, typename... Ts>
+  struct type_at<0, T, Ts...> { typedef T type; };
+
+  template<std::size_t I, typename T, typename... Ts>
+  struct type_at<I, T, Ts...> : type_at<I - 1, Ts...> {};
+
+  // Where T first appears in Ts, and how many times.
+  template<typename T, typename... Ts>
+  struct find_type
+  {
+    static const std::size_t index = 0;
+    static const std::size_t count = 0;
+  };
+
+  template<typename T, typename U, typename... Ts>
+  struct find_type<T, U, Ts...>
+  {
+    static const std::size_t index = std::is_same<T, U>::value ? 0 : 1 + find_type<T, Ts...>::index;
+    static const std::size_t count = std::is_same<T, U>::value + find_type<T, Ts...>::count;
+  };
+
+  // true if every one of Bs is.
+  template<bool... Bs>
+  struct all_of : std::true_type {};
+
+  template<bool B, bool... Bs>
+  struct all_of<B, Bs...> : std::integral_constant<bool, B && all_of<Bs...>::value> {};
+
+
+
+  /* ************************************************
+  // The order members are laid out in: by alignment,
+  // largest first, and otherwise in the order they
+  // were given. Since every size is a multiple of its
+  // alignment, each member then starts right where
+  // the last one ended, and the only padding left is
+  // at the end. Sorting is an insertion sort over the
+  // indices, run by the compiler.
+  //
+  // ************************************************/
+
+  // Put index I in front of Is.
+  template<std::size_t I, typename Is>
+  struct prepend;
+
+  template<std::size_t I, std::size_t... Is>
+  struct prepend< I, indices<Is...> > { typedef indices<I, Is...> type; };
+
+  // Insert member I into Sorted, after every member aligned at least as strictly.
+  template<std::size_t I, typename Sorted, typename... Ts>
+  struct insert_index;
+
+  template<std::size_t I, typename... Ts>
+  struct insert_index<I, indices<>, Ts...> { typedef indices<I> type; };
+
+  template<std::size_t I, std::size_t J, std::size_t... Js, typename... Ts>
+  struct insert_index<I, indices<J, Js...>, Ts...>
+  {
+    typedef typename std::conditional<
+      ( alignof(typename type_at<I, Ts...>::type) > alignof(typename type_at<J, Ts...>::type) ),
+      indices<I, J, Js...>,
+      typename prepend<J, typename insert_index<I, indices<Js...>, Ts...>::type>::type
+    >::type type;
+  };
+
+  // Insert each of Is, in turn, into Sorted.
+  template<typename Sorted, typename Is, typename... Ts>
+  struct sort_indices { typedef Sorted type; };
+
+  template<typename Sorted, std::size_t I, std::size_t... Is, typename... Ts>
+  struct sort_indices<Sorted, indices<I, Is...>, Ts...>
+    : sort_indices<typename insert_index<I, Sorted, Ts...>::type, indices<Is...>, Ts...> {};
+
+  // The layout of a Tuple of Ts.
+  template<typename... Ts>
+  struct layout_of
+    : sort_indices< indices<>, typename make_indices<sizeof...(Ts)>::type, Ts... > {};
+
+
+
+  /* ************************************************
+  // Holds member I, of type T. An empty T is a base
+  // class rather than a data member, so it takes no
+  // space (the empty base optimization - C++11 has
+  // no [[no_unique_address]]). Final classes can't
+  // be bases, so they're stored like any other.
+  //
+  // ************************************************/
+  template< std::size_t I, typename T,
+            bool Empty = std::is_empty<T>::value && !__is_final(T) >
+  struct leaf
+  {
+    leaf(void) : value() {}
+
+    template<typename U>
+    explicit leaf(U && arg) : value(std::forward<U>(arg)) {}
+
+    T & get(void) { return value; }
+    const T & get(void) const { return value; }
+
+    T value;
+  };
+
+  template<std::size_t I, typename T>
+  struct leaf<I, T, true> : T
+  {
+    leaf(void) : T() {}
+
+    template<typename U>
+    explicit leaf(U && arg) : T(std::forward<U>(arg)) {}
+
+    T & get(void) { return *this; }
+    const T & get(void) const { return *this; }
+  };
+
+  // Argument I of a call, forwarded on.
+  template<std::size_t I>
+  struct pick
+  {
+    template<typename U, typename... Us>
+    static typename type_at<I - 1, Us &&...>::type from(U &&, Us &&... args)
+    { return pick<I - 1>::from(std::forward<Us>(args)...); }
+  };
+
+  template<>
+  struct pick<0>
+  {
+    template<typename U, typename... Us>
+    static U && from(U && arg, Us &&...)
+    { return std::forward<U>(arg); }
+  };
+
+  // Marks the storage constructor that takes a value for every member.
+  struct from_args {};
+
+  // A leaf for every member, in the order of Sorted.
+  template<typename Sorted, typename... Ts>
+  struct storage;
+
+  template<std::size_t... Ss, typename... Ts>
+  struct storage< indices<Ss...>, Ts... >
+    : leaf< Ss, typename type_at<Ss, Ts...>::type >...
+  {
+    storage(void) : leaf< Ss, typename type_at<Ss, Ts...>::type >()... {}
+
+    // args are in member order; each leaf picks out its own.
+    template<typename... Us>
+    storage(from_args, Us &&... args)
+      : leaf< Ss, typename type_at<Ss, Ts...>::type >
+          ( pick<Ss>::from(std::forward<Us>(args)...) )... {}
+  };
+};
+
+
+// Declare the generic Tuple of any number of members (see below),
+// so the two member form can be defined first.
+template<typename... Ts>
+class Tuple;
+
+
+
 /* ************************************************
 // This is a generic and functional Tuple ADT. The
 // Tuple has two pointers to data members of
@@ -45,13 +249,21 @@
 // the initializing constructor, or the Tuple setter
 // methods. Each of the data members has a getter
 // method for retrieving their contents.
+//
+// This is the two member form of Tuple, which keeps
+// the interface it had before Tuple took any number
+// of members.
 // 
 // ************************************************/
 template<typename A, typename B>
-class Tuple
+class Tuple<A, B>
 {
   public:
 
+    // The member types, as std::pair names them.
+    typedef A first_type;
+    typedef B second_type;
+
     /* ************************************************
     // Sets data pointers to null. Not that creation of
     // a Tuple with this constructor will require the
@@ -87,25 +299,125 @@ class Tuple
 
 
 
+    /* ************************************************
+    // As above, but moves the parameters into the
+    // newly allocated data members.
+    //
+    // @param fst: The value to move into the memory
+    // pointed to by first.
+    //
+    // @param snd: The value to move into the memory
+    // pointed to by second.
+    //
+    // ************************************************/
+    Tuple(A && fst, B && snd) : first( new A(std::move(fst)) ),
+                                second( new B(std::move(snd)) )
+    { return; }
+
+
+
     /* ************************************************
     // Allocates, initializes Tuple members with the
-    // data contained in an existing Tuple.
+    // data contained in an existing Tuple. Members
+    // that aren't set in the given Tuple are left
+    // unset in this one too.
     //
     // @param tup: The Tuple to be copied.
     //
     // ************************************************/
-    Tuple(const Tuple & tup)
+    Tuple(const Tuple & tup) : first(nullptr),
+                               second(nullptr)
+    {
+      // If the given tuple's first element is set, copy it.
+      if(tup.first)
+        first = new A( * tup.first );
+
+      // If the given tuple's second element is set, copy it.
+      if(tup.second)
+        second = new B( * tup.second );
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Takes the data members of an existing Tuple,
+    // leaving it unset (as if it had been created
+    // with the default constructor). Nothing is
+    // allocated or copied.
+    //
+    // @param tup: The Tuple to be moved.
+    //
+    // ************************************************/
+    Tuple(Tuple && tup) noexcept : first(tup.first),
+                                   second(tup.second)
     {
-      // Set first to the first element in the given tuple.
-      first = new A( * tup.first );
-      // Set second to the second element in the given tuple.
-      second = new B( * tup.second );
+      // The given tuple no longer owns the data.
+      tup.first = nullptr;
+      tup.second = nullptr;
 
       return;
     }
 
 
 
+    /* ************************************************
+    // Replaces this Tuple's data with copies of
+    // another's. Unlike the setters, this works on a
+    // Tuple that is already set, since the whole
+    // Tuple is being replaced. If a copy throws, this
+    // Tuple is left as it was.
+    //
+    // @param tup: The Tuple to be copied.
+    //
+    // @return: This Tuple.
+    //
+    // ************************************************/
+    Tuple & operator=(const Tuple & tup)
+    {
+      // Copy the other tuple first, then move the copy in.
+      if(this != &tup)
+        *this = Tuple(tup);
+
+      return *this;
+    }
+
+
+
+    /* ************************************************
+    // Deallocates this Tuple's data and takes the
+    // data members of another Tuple instead, leaving
+    // that one unset.
+    //
+    // @param tup: The Tuple to be moved.
+    //
+    // @return: This Tuple.
+    //
+    // ************************************************/
+    Tuple & operator=(Tuple && tup) noexcept
+    {
+      // If this is a self assignment, there's nothing to do.
+      if(this == &tup)
+        return *this;
+
+      // Deallocate the current data..
+      delete first;
+      delete second;
+
+      // take the other tuple's..
+      first = tup.first;
+      second = tup.second;
+
+      // and leave it unset.
+      tup.first = nullptr;
+      tup.second = nullptr;
+
+      return *this;
+    }
+
+
+
     /* ************************************************
     // Deallocate all data.
     //
@@ -323,6 +635,168 @@ class Tuple
 
 
 
+    /* ************************************************
+    // As set_tup above, but moves the parameters into
+    // the newly allocated data members.
+    //
+    // @param fst: The value to move into the memory
+    // pointed to by first.
+    //
+    // @param snd: The value to move into the memory
+    // pointed to by second.
+    //
+    // @return: true if Tuple setup is successful.
+    //
+    // ************************************************/
+    bool set_tup(A && fst, B && snd)
+    {
+      // If either first or second are not null..
+      if(first || second)
+        // Return false - indicating the assignment failure.
+        return false;
+
+      // Otherwise, move both values in.
+      first = new A(std::move(fst));
+      second = new B(std::move(snd));
+
+      // Return true - indicating the assignment success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // As set_fst above, but moves the parameter into
+    // the newly allocated first data member.
+    //
+    // @param fst: The value to move into the memory
+    // pointed to by first.
+    //
+    // @return: true if the first member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_fst(A && fst)
+    {
+      // Move the value into a new first, if first isn't set.
+      return emplace_fst(std::move(fst));
+    }
+
+
+
+    /* ************************************************
+    // As set_snd above, but moves the parameter into
+    // the newly allocated second data member.
+    //
+    // @param snd: The value to move into the memory
+    // pointed to by second.
+    //
+    // @return: true if the second member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_snd(B && snd)
+    {
+      // Move the value into a new second, if second isn't set.
+      return emplace_snd(std::move(snd));
+    }
+
+
+
+    /* ************************************************
+    // Allocates the first data member and constructs
+    // it in place from the given arguments, e.g.
+    // emplace_fst(3, 'x') on a Tuple<std::string, B>
+    // sets first to "xxx" without building a
+    // temporary string to copy. As with set_fst, this
+    // only works if first hasn't been set.
+    //
+    // @param args: The arguments for A's constructor.
+    //
+    // @return: true if the first member setup is
+    // successful.
+    //
+    // ************************************************/
+    template<typename... Args>
+    bool emplace_fst(Args &&... args)
+    {
+      // If first is not null, report the failure.
+      if(first)
+        return false;
+
+      // Otherwise, construct first from the arguments.
+      first = new A(std::forward<Args>(args)...);
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Allocates the second data member and constructs
+    // it in place from the given arguments. See
+    // emplace_fst for more information.
+    //
+    // @param args: The arguments for B's constructor.
+    //
+    // @return: true if the second member setup is
+    // successful.
+    //
+    // ************************************************/
+    template<typename... Args>
+    bool emplace_snd(Args &&... args)
+    {
+      // If second is not null, report the failure.
+      if(second)
+        return false;
+
+      // Otherwise, construct second from the arguments.
+      second = new B(std::forward<Args>(args)...);
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Gets member I (0 for first, 1 for second), with
+    // the index checked at compile time. Unlike fst and
+    // snd, this returns the data itself, so only call
+    // it on a member that has been set.
+    //
+    // @return: The data pointed to by first or second.
+    //
+    // ************************************************/
+    template<std::size_t I>
+    const typename tuple_detail::type_at<I, A, B>::type & get(void) const
+    {
+      // Pick the member at compile time.
+      return member( std::integral_constant<std::size_t, I>() );
+    }
+
+
+
+    /* ************************************************
+    // Gets the member of type T, which must be the
+    // type of exactly one member. See get<I> above.
+    //
+    // @return: The data pointed to by first or second.
+    //
+    // ************************************************/
+    template<typename T>
+    const T & get(void) const
+    {
+      // T must name exactly one member.
+      static_assert( tuple_detail::find_type<T, A, B>::count == 1,
+                     "get<T> needs exactly one member of type T" );
+
+      return get< tuple_detail::find_type<T, A, B>::index >();
+    }
+
+
+
     /* ************************************************
     // displays the data pointed to by first and second.
     // Note that this method simply prints out the
@@ -355,6 +829,10 @@ class Tuple
 
   private:
 
+    // The members, by index, for get.
+    const A & member(std::integral_constant<std::size_t, 0>) const { return * first; }
+    const B & member(std::integral_constant<std::size_t, 1>) const { return * second; }
+
     // Intuitively, first is the first data member.
     const A * first;
 
@@ -362,67 +840,829 @@ class Tuple
     const B * second;
 
 };
-#endif // TUPLE
 
 
 
-/* ****************************************************
-// Zips up the data from a list of type A data and a
-// list of type B data into a single list of type
-// Tuple<A,B>.
-//
-// @param fst_list: The list of type A from which data
-// will be copied into the first data member of the
-// Tuple at the corresponding index of zip_list.
-// 
-// @param snd_list: The list of type B from which data
-// will be copied into the second data member of the
-// Tuple at the corresponding index of zip_list.
-//
-// @param zip_list: The list to be filled with Tuples
-// of data from fst_list and snd_list.
-//
-// @return: true if zip is successful.
+/* ************************************************
+// A Tuple that stores its data members in place.
+// Each member lives in raw storage of the right
+// size and alignment inside the InlineTuple, and
+// is only constructed (with placement new) when
+// it's set. The presence bitmask records which
+// members have been constructed, standing in for
+// the null pointers of Tuple, so every method
+// behaves exactly as Tuple's does - including the
+// setters, which still only work once.
 //
-// ****************************************************/
+// ************************************************/
 template<typename A, typename B>
-bool zip(std::list<A> & fst_list, std::list<B> & snd_list, std::list< Tuple<A,B> > & zip_list)
+class InlineTuple
 {
-  // Store the size of the first list.
-  unsigned int fst_size = fst_list.size();
+  public:
 
-  // If the lists are not the same size..
-  if(fst_size == 0 || fst_size != snd_list.size() )
-    // Report the failure.
-    return false;
+    // The member types, as std::pair names them.
+    typedef A first_type;
+    typedef B second_type;
 
-  // Create iterator for the first list.
-  typename std::list<A>::iterator fst_iter = fst_list.begin();
-  // Create iterator for the second list.
-  typename std::list<B>::iterator snd_iter = snd_list.begin();
+    /* ************************************************
+    // Leaves both members unset. As with Tuple, use
+    // set_fst and set_snd or set_tup to initialize
+    // them later.
+    //
+    // ************************************************/
+    InlineTuple(void) : present(0)
+    { return; }
 
-  // While the first iterator has not reached the end of the first list..
-  // implying that neither iterator has hit the end of its list..
-  while(fst_iter != fst_list.end())
-  {
-    // Push a new Tuple with the data pointed to by the first
-    // and second list iterators to the front of the zip_list.
-    zip_list.push_front( Tuple<A,B>( *fst_iter , *snd_iter ) );
 
-    // Advance the first and second list iterators.
-    std::advance(fst_iter, 1);
-    std::advance(snd_iter, 1);
-  }
 
-  // Report success.
-  return true;
-}
+    /* ************************************************
+    // Constructs both members in place from the
+    // function parameters. As with Tuple, they are
+    // then permanently set.
+    //
+    // @param fst: The value to copy into first.
+    //
+    // @param snd: The value to copy into second.
+    //
+    // ************************************************/
+    InlineTuple(const A & fst, const B & snd) : present(0)
+    {
+      // Construct both members.
+      set_tup(fst, snd);
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // As above, but moves the parameters into the
+    // members.
+    //
+    // @param fst: The value to move into first.
+    //
+    // @param snd: The value to move into second.
+    //
+    // ************************************************/
+    InlineTuple(A && fst, B && snd) : present(0)
+    {
+      // Move both members in.
+      set_tup(std::move(fst), std::move(snd));
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Copies whichever members of an existing
+    // InlineTuple have been set.
+    //
+    // @param tup: The InlineTuple to be copied.
+    //
+    // ************************************************/
+    InlineTuple(const InlineTuple & tup) : present(0)
+    {
+      // Copy first, if it's there.
+      if(tup.present & FIRST)
+        set_fst( * tup.first() );
+
+      // Copy second, if it's there.
+      if(tup.present & SECOND)
+        set_snd( * tup.second() );
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Replaces this InlineTuple's members with copies
+    // of another's. Unlike the setters, this works on
+    // a tuple that is already set, since the whole
+    // tuple is being replaced.
+    //
+    // @param tup: The InlineTuple to be copied.
+    //
+    // @return: This InlineTuple.
+    //
+    // ************************************************/
+    InlineTuple & operator=(const InlineTuple & tup)
+    {
+      // If this is a self assignment, there's nothing to do.
+      if(this == &tup)
+        return *this;
+
+      // Destroy the current members..
+      clear();
+
+      // and copy the other tuple's.
+      if(tup.present & FIRST)
+        set_fst( * tup.first() );
+
+      if(tup.present & SECOND)
+        set_snd( * tup.second() );
+
+      return *this;
+    }
+
+
+
+    /* ************************************************
+    // Moves whichever members of an existing
+    // InlineTuple have been set, leaving it unset
+    // as a moved Tuple is.
+    //
+    // @param tup: The InlineTuple to be moved.
+    //
+    // ************************************************/
+    InlineTuple(InlineTuple && tup)
+      noexcept(std::is_nothrow_move_constructible<A>::value
+               && std::is_nothrow_move_constructible<B>::value)
+      : present(0)
+    {
+      // Move the other tuple's members in..
+      take(tup);
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Replaces this InlineTuple's members with those
+    // moved out of another, leaving it unset.
+    //
+    // @param tup: The InlineTuple to be moved.
+    //
+    // @return: This InlineTuple.
+    //
+    // ************************************************/
+    InlineTuple & operator=(InlineTuple && tup)
+      noexcept(std::is_nothrow_move_constructible<A>::value
+               && std::is_nothrow_move_constructible<B>::value)
+    {
+      // If this is a self assignment, there's nothing to do.
+      if(this == &tup)
+        return *this;
+
+      // Destroy the current members..
+      clear();
+
+      // and move the other tuple's in.
+      take(tup);
+
+      return *this;
+    }
+
+
+
+    /* ************************************************
+    // Destroys whichever members have been set.
+    //
+    // ************************************************/
+    ~InlineTuple(void)
+    {
+      // Destroy the members.
+      clear();
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Retrieves first, if it has been set. See
+    // Tuple::fst for more information.
+    //
+    // @param fst: Location where the contents of first
+    // will be copied.
+    //
+    // @return: true if the first member is set.
+    //
+    // ************************************************/
+    bool fst(A & fst) const
+    {
+      // If first has been set..
+      if(present & FIRST)
+      {
+        // Store first into fst.
+        fst = * first();
+        // Report success.
+        return true;
+      }
+
+      // Otherwise, report failure.
+      return false;
+    }
+
+
+
+    /* ************************************************
+    // Retrieves second, if it has been set. See
+    // Tuple::snd for more information.
+    //
+    // @param snd: Location where the contents of
+    // second will be copied.
+    //
+    // @return: true if the second member is set.
+    //
+    // ************************************************/
+    bool snd(B & snd) const
+    {
+      // If second has been set..
+      if(present & SECOND)
+      {
+        // Store second into snd.
+        snd = * second();
+        // Report success.
+        return true;
+      }
+
+      // Otherwise, report failure.
+      return false;
+    }
+
+
+
+    /* ************************************************
+    // Retrieves both members, if both have been set.
+    // See Tuple::extract for more information.
+    //
+    // @param fst: Location where the contents of
+    // first will be copied.
+    //
+    // @param snd: Location where the contents of
+    // second will be copied.
+    //
+    // @return: true if both members are set.
+    //
+    // ************************************************/
+    bool extract(A & fst, B & snd) const
+    {
+      // If both members have been set..
+      if(present == (FIRST | SECOND))
+      {
+        // Store first into fst.
+        fst = * first();
+        // Store second into snd.
+        snd = * second();
+        // Report success.
+        return true;
+      }
+
+      // Otherwise, report failure.
+      return false;
+    }
+
+
+
+    /* ************************************************
+    // Sets both members, as long as neither has been
+    // set yet. See Tuple::set_tup for more
+    // information.
+    //
+    // @param fst: The value to copy into first.
+    //
+    // @param snd: The value to copy into second.
+    //
+    // @return: true if Tuple setup is successful.
+    //
+    // ************************************************/
+    bool set_tup(const A & fst, const B & snd)
+    {
+      // If either member has been set, report the failure.
+      if(present)
+        return false;
+
+      // Otherwise, construct both members in place.
+      return set_fst(fst) && set_snd(snd);
+    }
+
+
+
+    /* ************************************************
+    // Sets first, as long as it hasn't been set yet.
+    //
+    // @param fst: The value to copy into first.
+    //
+    // @return: true if the first member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_fst(const A & fst)
+    {
+      // If first has been set, report the failure.
+      if(present & FIRST)
+        return false;
+
+      // Otherwise, construct it in its storage..
+      new (&first_storage) A(fst);
+      // and mark it present.
+      present |= FIRST;
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Sets second, as long as it hasn't been set yet.
+    //
+    // @param snd: The value to copy into second.
+    //
+    // @return: true if the second member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_snd(const B & snd)
+    {
+      // If second has been set, report the failure.
+      if(present & SECOND)
+        return false;
+
+      // Otherwise, construct it in its storage..
+      new (&second_storage) B(snd);
+      // and mark it present.
+      present |= SECOND;
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // As set_tup above, but moves the parameters into
+    // the members.
+    //
+    // @param fst: The value to move into first.
+    //
+    // @param snd: The value to move into second.
+    //
+    // @return: true if Tuple setup is successful.
+    //
+    // ************************************************/
+    bool set_tup(A && fst, B && snd)
+    {
+      // If either member has been set, report the failure.
+      if(present)
+        return false;
+
+      // Otherwise, move both members in.
+      return emplace_fst(std::move(fst)) && emplace_snd(std::move(snd));
+    }
+
+
+
+    /* ************************************************
+    // As set_fst above, but moves the parameter into
+    // first.
+    //
+    // @param fst: The value to move into first.
+    //
+    // @return: true if the first member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_fst(A && fst)
+    {
+      // Move the value into first, if first isn't set.
+      return emplace_fst(std::move(fst));
+    }
+
+
+
+    /* ************************************************
+    // As set_snd above, but moves the parameter into
+    // second.
+    //
+    // @param snd: The value to move into second.
+    //
+    // @return: true if the second member setup is
+    // successful.
+    //
+    // ************************************************/
+    bool set_snd(B && snd)
+    {
+      // Move the value into second, if second isn't set.
+      return emplace_snd(std::move(snd));
+    }
+
+
+
+    /* ************************************************
+    // Constructs first in its storage from the given
+    // arguments, as long as it hasn't been set yet.
+    // See Tuple::emplace_fst for more information.
+    //
+    // @param args: The arguments for A's constructor.
+    //
+    // @return: true if the first member setup is
+    // successful.
+    //
+    // ************************************************/
+    template<typename... Args>
+    bool emplace_fst(Args &&... args)
+    {
+      // If first has been set, report the failure.
+      if(present & FIRST)
+        return false;
+
+      // Otherwise, construct it from the arguments..
+      new (&first_storage) A(std::forward<Args>(args)...);
+      // and mark it present.
+      present |= FIRST;
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Constructs second in its storage from the given
+    // arguments, as long as it hasn't been set yet.
+    //
+    // @param args: The arguments for B's constructor.
+    //
+    // @return: true if the second member setup is
+    // successful.
+    //
+    // ************************************************/
+    template<typename... Args>
+    bool emplace_snd(Args &&... args)
+    {
+      // If second has been set, report the failure.
+      if(present & SECOND)
+        return false;
+
+      // Otherwise, construct it from the arguments..
+      new (&second_storage) B(std::forward<Args>(args)...);
+      // and mark it present.
+      present |= SECOND;
+
+      // Report success.
+      return true;
+    }
+
+
+
+    /* ************************************************
+    // Displays first and second. See Tuple::display
+    // for more information.
+    //
+    // @return: true if both members are set.
+    //
+    // ************************************************/
+    bool display(void)
+    {
+      // If either member is unset, report failure.
+      if(present != (FIRST | SECOND))
+        return false;
+
+      // Print out first and second.
+      std::cout << std::boolalpha
+          << "\n\tTuple Data :: "
+          << * first() << " and "
+          << * second() << std::endl;
+
+      // Report success.
+      return true;
+    }
+
+
+  private:
+
+    // The bits of present for each member.
+    enum { FIRST = 1, SECOND = 2 };
+
+    // The members, once they've been constructed.
+    const A * first(void) const { return reinterpret_cast<const A *>(&first_storage); }
+    const B * second(void) const { return reinterpret_cast<const B *>(&second_storage); }
+
+    // The members, for moving them out.
+    A * first(void) { return reinterpret_cast<A *>(&first_storage); }
+    B * second(void) { return reinterpret_cast<B *>(&second_storage); }
+
+
+
+    /* ************************************************
+    // Moves whichever members of another InlineTuple
+    // are present into this one, which must be unset,
+    // and leaves the other unset.
+    //
+    // @param tup: The InlineTuple to be moved.
+    //
+    // ************************************************/
+    void take(InlineTuple & tup)
+    {
+      // Move first, if it's there.
+      if(tup.present & FIRST)
+        emplace_fst( std::move( * tup.first() ) );
+
+      // Move second, if it's there.
+      if(tup.present & SECOND)
+        emplace_snd( std::move( * tup.second() ) );
+
+      // Destroy what's left of the other tuple's members.
+      tup.clear();
+
+      return;
+    }
+
+
+
+    /* ************************************************
+    // Destroys whichever members are present, leaving
+    // the tuple unset.
+    //
+    // ************************************************/
+    void clear(void)
+    {
+      // Destroy first if it's there.
+      if(present & FIRST)
+        first()->~A();
+
+      // Destroy second if it's there.
+      if(present & SECOND)
+        second()->~B();
+
+      // Nothing is set now.
+      present = 0;
+
+      return;
+    }
+
+    // Raw storage for the first data member..
+    typename std::aligned_storage<sizeof(A), alignof(A)>::type first_storage;
+
+    // and for the second.
+    typename std::aligned_storage<sizeof(B), alignof(B)>::type second_storage;
+
+    // Which members have been constructed (FIRST and SECOND bits).
+    unsigned char present;
+
+};
+
+
+
+/* ************************************************
+// A Tuple of any number of members (other than
+// two, which is the Tuple above). The members are
+// all held inside the Tuple itself, so a record of
+// several fields is one block of memory rather than
+// nested Tuples each pointing off to the heap. Get
+// a member by its index or its type with get<I> or
+// get<T>; both are worked out at compile time.
+//
+// The members are laid out by alignment, largest
+// first, rather than in the order given, so that
+// there's no padding between them - a Tuple<char,
+// double, short, int> takes 16 bytes, not the 24 of
+// a struct with those fields in that order. Empty
+// members take no space at all. None of this shows
+// through get, which always uses the given order.
+//
+// Every member is constructed along with the Tuple,
+// either from the constructor's arguments or with
+// its default constructor, and unlike the two
+// member form, a member can be changed through get.
+//
+// ************************************************/
+template<typename... Ts>
+class Tuple
+{
+  public:
+
+    /* ************************************************
+    // Value initializes every member (so numbers are
+    // zero).
+    //
+    // ************************************************/
+    Tuple(void) : members()
+    { return; }
+
+
+
+    /* ************************************************
+    // Constructs every member from the argument in the
+    // same position, copying lvalues and moving
+    // rvalues.
+    //
+    // @param args: A value for each member, in order.
+    //
+    // ************************************************/
+    template< typename... Us,
+              typename = typename std::enable_if<
+                sizeof...(Us) == sizeof...(Ts) && (sizeof...(Us) > 0)
+                && tuple_detail::all_of< std::is_constructible<Ts, Us &&>::value... >::value
+              >::type >
+    Tuple(Us &&... args) : members( tuple_detail::from_args(), std::forward<Us>(args)... )
+    { return; }
+
+
+
+    /* ************************************************
+    // Gets member I.
+    //
+    // @return: A reference to member I.
+    //
+    // ************************************************/
+    template<std::size_t I>
+    typename tuple_detail::type_at<I, Ts...>::type & get(void)
+    {
+      // Member I lives in its own leaf, wherever that was laid out.
+      return static_cast< tuple_detail::leaf< I, typename tuple_detail::type_at<I, Ts...>::type > & >
+               (members).get();
+    }
+
+    template<std::size_t I>
+    const typename tuple_detail::type_at<I, Ts...>::type & get(void) const
+    {
+      return static_cast< const tuple_detail::leaf< I, typename tuple_detail::type_at<I, Ts...>::type > & >
+               (members).get();
+    }
+
+
+
+    /* ************************************************
+    // Gets the member of type T, which must be the
+    // type of exactly one member.
+    //
+    // @return: A reference to the member of type T.
+    //
+    // ************************************************/
+    template<typename T>
+    T & get(void)
+    {
+      // T must name exactly one member.
+      static_assert( tuple_detail::find_type<T, Ts...>::count == 1,
+                     "get<T> needs exactly one member of type T" );
+
+      return get< tuple_detail::find_type<T, Ts...>::index >();
+    }
+
+    template<typename T>
+    const T & get(void) const
+    {
+      static_assert( tuple_detail::find_type<T, Ts...>::count == 1,
+                     "get<T> needs exactly one member of type T" );
+
+      return get< tuple_detail::find_type<T, Ts...>::index >();
+    }
+
+
+
+    /* ************************************************
+    // Displays every member, in order. As with the two
+    // member display, this is mostly here for testing.
+    //
+    // @return: true, since every member is set.
+    //
+    // ************************************************/
+    bool display(void) const
+    {
+      // Print out the members.
+      std::cout << std::boolalpha << "\n\tTuple Data :: ";
+
+      print( typename tuple_detail::make_indices<sizeof...(Ts)>::type() );
+
+      std::cout << std::endl;
+
+      // Report success.
+      return true;
+    }
+
+
+  private:
+
+    // Print members Is, separated by "and".
+    template<std::size_t... Is>
+    void print(tuple_detail::indices<Is...>) const
+    {
+      // Stream each member in turn (the array just gives the expansion somewhere to go).
+      int streamed[] = { 0, ( std::cout << (Is ? " and " : "") << get<Is>(), 0 )... };
+
+      (void) streamed;
+
+      return;
+    }
+
+    // Every member, in its leaf, laid out by alignment.
+    tuple_detail::storage< typename tuple_detail::layout_of<Ts...>::type, Ts... > members;
+
+};
+#endif // TUPLE
+
+
+
+/* ****************************************************
+// Zips up the data from a list of type A data and a
+// list of type B data into a single list of type
+// Tuple<A,B>. The Tuples are added to the end of
+// zip_list, in the order of the lists. See the
+// generic zip functions below for other ranges.
+//
+// @param fst_list: The list of type A from which data
+// will be copied into the first data member of the
+// Tuple at the corresponding index of zip_list.
+// 
+// @param snd_list: The list of type B from which data
+// will be copied into the second data member of the
+// Tuple at the corresponding index of zip_list.
+//
+// @param zip_list: The list to be filled with Tuples
+// of data from fst_list and snd_list.
+//
+// @return: true if zip is successful.
+//
+// ****************************************************/
+template<typename A, typename B>
+bool zip(std::list<A> & fst_list, std::list<B> & snd_list, std::list< Tuple<A,B> > & zip_list)
+{
+  // Store the size of the first list.
+  unsigned int fst_size = fst_list.size();
+
+  // If the lists are not the same size..
+  if(fst_size == 0 || fst_size != snd_list.size() )
+    // Report the failure.
+    return false;
+
+  // Create iterator for the first list.
+  typename std::list<A>::iterator fst_iter = fst_list.begin();
+  // Create iterator for the second list.
+  typename std::list<B>::iterator snd_iter = snd_list.begin();
+
+  // While the first iterator has not reached the end of the first list..
+  // implying that neither iterator has hit the end of its list..
+  while(fst_iter != fst_list.end())
+  {
+    // Construct a new Tuple with the data pointed to by the first and
+    // second list iterators right in the back node of the zip_list,
+    // rather than copying a temporary Tuple into it.
+    zip_list.emplace_back( *fst_iter , *snd_iter );
+
+    // Advance the first and second list iterators.
+    std::advance(fst_iter, 1);
+    std::advance(snd_iter, 1);
+  }
+
+  // Report success.
+  return true;
+}
+
+
+
+/* ****************************************************
+// As zip above, but for lists that are about to be
+// thrown away: each element is moved into its Tuple
+// rather than copied, so zipping lists of strings or
+// other large data only hands over their buffers.
+// The elements left in fst_list and snd_list are
+// moved-from.
+//
+// @param fst_list: The list of type A from which data
+// will be moved into the first data members.
+//
+// @param snd_list: The list of type B from which data
+// will be moved into the second data members.
+//
+// @param zip_list: The list to be filled with Tuples
+// of data from fst_list and snd_list.
+//
+// @return: true if zip is successful.
+//
+// ****************************************************/
+template<typename A, typename B>
+bool zip(std::list<A> && fst_list, std::list<B> && snd_list, std::list< Tuple<A,B> > & zip_list)
+{
+  // If the lists are empty or not the same size..
+  if(fst_list.empty() || fst_list.size() != snd_list.size())
+    // Report the failure.
+    return false;
+
+  // Create iterators for the first and second lists.
+  typename std::list<A>::iterator fst_iter = fst_list.begin();
+  typename std::list<B>::iterator snd_iter = snd_list.begin();
+
+  // While neither iterator has hit the end of its list..
+  for(; fst_iter != fst_list.end(); ++fst_iter, ++snd_iter)
+    // Move the data pointed to by the iterators into a new
+    // Tuple at the back of the zip_list.
+    zip_list.emplace_back( std::move(*fst_iter) , std::move(*snd_iter) );
+
+  // Report success.
+  return true;
+}
 
 
 
 /* ************************************************
 // Unzips the data from a list of type Tuple<A,B>
-// into two lists of type A and type B.
+// into two lists of type A and type B, adding the
+// data to the end of each, in order.
 //
 // @param zip_list: The list containing Tuples from
 // which the first data members will be copied into
@@ -457,10 +1697,10 @@ bool unzip( std::list< Tuple<A,B> > & zip_list, std::list<A> & fst_list, std::li
     // into the fst and snd temp objects. If the transfer is successful..
     if( zip_iter->fst(fst) && zip_iter->snd(snd))
     {
-      // Push a new A with the data in fst into the front of the fst_list.
-      fst_list.push_front( A(fst) );
-      // Push a new B with the data in snd into the front of the snd_list.
-      snd_list.push_front( B(snd) );
+      // Push a new A with the data in fst onto the back of the fst_list.
+      fst_list.push_back( A(fst) );
+      // Push a new B with the data in snd onto the back of the snd_list.
+      snd_list.push_back( B(snd) );
     }
     // If the transfer fails, report the failure.
     else return false;
@@ -473,3 +1713,479 @@ bool unzip( std::list< Tuple<A,B> > & zip_list, std::list<A> & fst_list, std::li
   // in the Tuple list into the fst and snd lists.
   return true;
 }
+
+
+
+// Helpers for the generic zip & unzip functions below.
+namespace tuple_detail
+{
+  // true if Iter is a random access iterator, whose ranges can be
+  // measured without walking them.
+  template<typename Iter>
+  struct is_random_access
+    : std::is_base_of< std::random_access_iterator_tag,
+                       typename std::iterator_traits<Iter>::iterator_category > {};
+
+  // Makes room for count more elements in a container that can
+  // reserve it (such as a std::vector)..
+  template<typename Container>
+  auto reserve_more(Container & container, std::size_t count, int)
+    -> decltype(container.reserve(count), void())
+  { container.reserve(container.size() + count); }
+
+  // and does nothing for one that can't.
+  template<typename Container>
+  void reserve_more(Container &, std::size_t, long) {}
+};
+
+
+
+/* ****************************************************
+// Zips up the data in two ranges, of any iterator
+// types, writing a Tuple of each pair of elements to
+// an output iterator, in order. The output can be a
+// std::back_inserter, a plain array of Tuples, or
+// anything else a Tuple can be written through. To
+// move the data into the Tuples instead of copying
+// it, pass std::make_move_iterator iterators.
+//
+// If both ranges are random access, their lengths
+// are checked before anything is written, and the
+// loop only has one end to check. Otherwise they're
+// zipped until the shorter one ends.
+//
+// @param fst_iter, fst_end: The range from which data
+// will be copied into the first data members.
+//
+// @param snd_iter, snd_end: The range from which data
+// will be copied into the second data members.
+//
+// @param zip_out: Where the Tuples are written.
+//
+// @return: true if the ranges were the same length.
+//
+// ****************************************************/
+template<typename FstIter, typename SndIter, typename OutIter>
+bool zip( FstIter fst_iter, FstIter fst_end, SndIter snd_iter, SndIter snd_end,
+          OutIter zip_out )
+{
+  // The Tuples to write.
+  typedef Tuple< typename std::iterator_traits<FstIter>::value_type,
+                 typename std::iterator_traits<SndIter>::value_type > Zipped;
+
+  // If both ranges can be measured up front..
+  if( tuple_detail::is_random_access<FstIter>::value
+      && tuple_detail::is_random_access<SndIter>::value )
+  {
+    // and they aren't the same length, report the failure.
+    if(std::distance(fst_iter, fst_end) != std::distance(snd_iter, snd_end))
+      return false;
+
+    // Otherwise, the first range ending means both have.
+    for(; fst_iter != fst_end; ++fst_iter, ++snd_iter, ++zip_out)
+    {
+      // Build each member from its element as it is, so moved
+      // elements are moved in even if the other member is copied.
+      Zipped tup;
+      tup.emplace_fst(*fst_iter);
+      tup.emplace_snd(*snd_iter);
+
+      *zip_out = std::move(tup);
+    }
+
+    // Report success.
+    return true;
+  }
+
+  // While neither range has ended, write a Tuple of their elements.
+  for(; fst_iter != fst_end && snd_iter != snd_end; ++fst_iter, ++snd_iter, ++zip_out)
+  {
+    Zipped tup;
+    tup.emplace_fst(*fst_iter);
+    tup.emplace_snd(*snd_iter);
+
+    *zip_out = std::move(tup);
+  }
+
+  // Report whether they ended together.
+  return fst_iter == fst_end && snd_iter == snd_end;
+}
+
+
+
+/* ****************************************************
+// Zips up the data in two ranges - containers,
+// arrays or anything else with begin and end - into
+// the end of a container, in order. The Tuples are
+// constructed in place in the container, so it can
+// hold Tuples, InlineTuples or anything else built
+// from a pair of elements. If both ranges are random
+// access, their lengths are checked before anything
+// is added, and a container that can reserve space
+// (such as a std::vector) reserves it all at once.
+//
+// @param fst_range: The range from which data will be
+// copied into the first data members.
+//
+// @param snd_range: The range from which data will be
+// copied into the second data members.
+//
+// @param zip_out: The container the Tuples are added
+// to.
+//
+// @return: true if the ranges were the same length.
+//
+// ****************************************************/
+template<typename FstRange, typename SndRange, typename Container>
+bool zip(const FstRange & fst_range, const SndRange & snd_range, Container & zip_out)
+{
+  // Create iterators for both ranges.
+  auto fst_iter = std::begin(fst_range), fst_end = std::end(fst_range);
+  auto snd_iter = std::begin(snd_range), snd_end = std::end(snd_range);
+
+  // If both ranges can be measured up front..
+  if( tuple_detail::is_random_access<decltype(fst_iter)>::value
+      && tuple_detail::is_random_access<decltype(snd_iter)>::value )
+  {
+    // Measure them.
+    std::size_t fst_size = std::distance(fst_iter, fst_end);
+
+    // If they aren't the same length, report the failure.
+    if(fst_size != static_cast<std::size_t>(std::distance(snd_iter, snd_end)))
+      return false;
+
+    // Otherwise, make room for every Tuple at once..
+    tuple_detail::reserve_more(zip_out, fst_size, 0);
+
+    // and add them, checking only the first range's end.
+    for(; fst_iter != fst_end; ++fst_iter, ++snd_iter)
+      zip_out.emplace_back( *fst_iter , *snd_iter );
+
+    // Report success.
+    return true;
+  }
+
+  // While neither range has ended, add a Tuple of their elements.
+  for(; fst_iter != fst_end && snd_iter != snd_end; ++fst_iter, ++snd_iter)
+    zip_out.emplace_back( *fst_iter , *snd_iter );
+
+  // Report whether they ended together.
+  return fst_iter == fst_end && snd_iter == snd_end;
+}
+
+
+
+/* ****************************************************
+// Unzips a range of Tuples (or InlineTuples) of any
+// iterator type, writing their first data members to
+// one output iterator and their second to another,
+// in order. As with the list unzip, it stops at the
+// first Tuple that isn't fully set.
+//
+// @param zip_iter, zip_end: The range of Tuples.
+//
+// @param fst_out: Where the first data members are
+// written.
+//
+// @param snd_out: Where the second data members are
+// written.
+//
+// @return: true if unzip is successful.
+//
+// ****************************************************/
+template<typename ZipIter, typename FstOut, typename SndOut>
+bool unzip(ZipIter zip_iter, ZipIter zip_end, FstOut fst_out, SndOut snd_out)
+{
+  // The type of Tuple being unzipped.
+  typedef typename std::iterator_traits<ZipIter>::value_type Zipped;
+
+  // Temporary storage for the data members.
+  typename Zipped::first_type fst = typename Zipped::first_type();
+  typename Zipped::second_type snd = typename Zipped::second_type();
+
+  // For every Tuple in the range..
+  for(; zip_iter != zip_end; ++zip_iter, ++fst_out, ++snd_out)
+  {
+    // If it isn't fully set, report the failure.
+    if(!zip_iter->extract(fst, snd))
+      return false;
+
+    // Otherwise, write its data members out.
+    *fst_out = std::move(fst);
+    *snd_out = std::move(snd);
+  }
+
+  // Report success.
+  return true;
+}
+
+
+
+/* ****************************************************
+// Unzips a range of Tuples (or InlineTuples) into the
+// ends of two containers, in order. If the range is
+// random access, containers that can reserve space
+// reserve it all at once.
+//
+// @param zip_range: The range of Tuples.
+//
+// @param fst_out: The container the first data
+// members are added to.
+//
+// @param snd_out: The container the second data
+// members are added to.
+//
+// @return: true if unzip is successful.
+//
+// ****************************************************/
+template<typename ZipRange, typename FstContainer, typename SndContainer>
+bool unzip(const ZipRange & zip_range, FstContainer & fst_out, SndContainer & snd_out)
+{
+  // Create iterators for the range.
+  auto zip_iter = std::begin(zip_range), zip_end = std::end(zip_range);
+
+  // If the range can be measured up front, make room for all of it.
+  if(tuple_detail::is_random_access<decltype(zip_iter)>::value)
+  {
+    std::size_t zip_size = std::distance(zip_iter, zip_end);
+
+    tuple_detail::reserve_more(fst_out, zip_size, 0);
+    tuple_detail::reserve_more(snd_out, zip_size, 0);
+  }
+
+  // Unzip onto the ends of the containers.
+  return unzip( zip_iter, zip_end, std::back_inserter(fst_out), std::back_inserter(snd_out) );
+}
+
+
+
+/* ****************************************************
+// What a ZipView's iterator points at: a reference to
+// an element of each range, named first and second as
+// in std::pair. Nothing is copied, so changing first
+// or second changes the element in its range. A
+// ZipRef converts to a Tuple, which does copy them.
+//
+// ****************************************************/
+template<typename FstRef, typename SndRef>
+struct ZipRef
+{
+  // Refers to the given elements.
+  ZipRef(FstRef fst, SndRef snd) : first( static_cast<FstRef>(fst) ),
+                                   second( static_cast<SndRef>(snd) )
+  { return; }
+
+  // Copies the elements into a new Tuple.
+  template<typename A, typename B>
+  operator Tuple<A, B>(void) const { return Tuple<A, B>(first, second); }
+
+  // The element of the first range..
+  FstRef first;
+
+  // and of the second.
+  SndRef second;
+};
+
+
+
+/* ****************************************************
+// Steps through two ranges together. Dereferencing it
+// gives a ZipRef to the current element of each. It
+// holds only the two ranges' iterators, and reaches
+// the end as soon as either one does, so a ZipView of
+// ranges of different lengths stops at the shorter.
+// Like vector<bool>'s, its reference is a proxy (a
+// ZipRef returned by value, not a value_type&), so
+// it only claims to be an input iterator, even though
+// a copy can walk the ranges again if they allow it.
+//
+// ****************************************************/
+template<typename FstIter, typename SndIter>
+class ZipIterator
+{
+  public:
+
+    // The iterator's traits, for the standard algorithms.
+    typedef std::input_iterator_tag iterator_category;
+
+    typedef ZipRef< typename std::iterator_traits<FstIter>::reference,
+                    typename std::iterator_traits<SndIter>::reference > value_type;
+    typedef value_type reference;
+    typedef void pointer;
+    typedef typename std::iterator_traits<FstIter>::difference_type difference_type;
+
+
+
+    /* ************************************************
+    // Creates an iterator at the given elements (or,
+    // by default, at none).
+    //
+    // @param fst: An iterator into the first range.
+    //
+    // @param snd: An iterator into the second range.
+    //
+    // ************************************************/
+    ZipIterator(void) : fst_iter(), snd_iter()
+    { return; }
+
+    ZipIterator(FstIter fst, SndIter snd) : fst_iter(fst), snd_iter(snd)
+    { return; }
+
+
+
+    /* ************************************************
+    // @return: A ZipRef to the current elements.
+    //
+    // ************************************************/
+    reference operator*(void) const
+    {
+      return reference(*fst_iter, *snd_iter);
+    }
+
+
+
+    /* ************************************************
+    // Advances both iterators.
+    //
+    // @return: This iterator (before advancing, for
+    // the postfix form).
+    //
+    // ************************************************/
+    ZipIterator & operator++(void)
+    {
+      ++fst_iter;
+      ++snd_iter;
+
+      return *this;
+    }
+
+    ZipIterator operator++(int)
+    {
+      ZipIterator was(*this);
+
+      ++*this;
+
+      return was;
+    }
+
+
+
+    /* ************************************************
+    // Iterators are equal if either of their ranges'
+    // iterators are. Two iterators of the same view
+    // are always the same distance into both ranges,
+    // so this only differs from requiring both when
+    // one of them is the end of the shorter range.
+    //
+    // @param other: The iterator to compare with.
+    //
+    // @return: true if they are equal.
+    //
+    // ************************************************/
+    bool operator==(const ZipIterator & other) const
+    {
+      return fst_iter == other.fst_iter || snd_iter == other.snd_iter;
+    }
+
+    bool operator!=(const ZipIterator & other) const
+    {
+      return !(*this == other);
+    }
+
+
+  private:
+
+    // The current element of the first range..
+    FstIter fst_iter;
+
+    // and of the second.
+    SndIter snd_iter;
+
+};
+
+
+
+/* ****************************************************
+// A lazy zip of two ranges. Unlike zip, it doesn't
+// build anything: it only holds the ranges' begin and
+// end iterators, and each step hands out references
+// to the next pair of elements (see ZipRef). It works
+// with range-for and with the standard algorithms
+// that read through iterators, such as std::find_if
+// and std::count_if. Algorithms that swap elements,
+// such as std::sort, need real references and won't
+// work.
+//
+// A ZipView doesn't own its ranges, so it must not
+// outlive them. Make one with zip_view.
+//
+// ****************************************************/
+template<typename FstIter, typename SndIter>
+class ZipView
+{
+  public:
+
+    // The view's iterators.
+    typedef ZipIterator<FstIter, SndIter> iterator;
+    typedef iterator const_iterator;
+
+
+
+    /* ************************************************
+    // Views the given ranges.
+    //
+    // @param fst_from, fst_to: The first range.
+    //
+    // @param snd_from, snd_to: The second range.
+    //
+    // ************************************************/
+    ZipView( FstIter fst_from, FstIter fst_to,
+             SndIter snd_from, SndIter snd_to ) : fst_begin(fst_from),
+                                                  fst_end(fst_to),
+                                                  snd_begin(snd_from),
+                                                  snd_end(snd_to)
+    { return; }
+
+
+
+    // The first pair of elements, and the end of the shorter range.
+    iterator begin(void) const { return iterator(fst_begin, snd_begin); }
+    iterator end(void) const { return iterator(fst_end, snd_end); }
+
+    // true if either range is empty.
+    bool empty(void) const { return begin() == end(); }
+
+
+  private:
+
+    // The ranges.
+    FstIter fst_begin, fst_end;
+    SndIter snd_begin, snd_end;
+
+};
+
+
+
+/* ****************************************************
+// Makes a ZipView of two ranges - containers, arrays
+// or anything else with begin and end. Only ranges
+// that will outlive the view can be passed, so a
+// temporary container won't compile. Iterating a
+// view of const ranges gives const references.
+//
+// @param fst_range: The range of first elements.
+//
+// @param snd_range: The range of second elements.
+//
+// @return: A view of both ranges.
+//
+// ****************************************************/
+template<typename FstRange, typename SndRange>
+ZipView< decltype( std::begin(std::declval<FstRange &>()) ),
+         decltype( std::begin(std::declval<SndRange &>()) ) >
+zip_view(FstRange & fst_range, SndRange & snd_range)
+{
+  return ZipView< decltype( std::begin(fst_range) ), decltype( std::begin(snd_range) ) >
+           ( std::begin(fst_range), std::end(fst_range),
+             std::begin(snd_range), std::end(snd_range) );
+}